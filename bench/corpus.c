@@ -0,0 +1,235 @@
+/**
+ * @file corpus.c
+ * Generates synthetic syslog message corpora for the benchmarks.
+ *
+ * The messages look like what a syslog relay sees in practice: a
+ * format-specific header (RFC3164, RFC5424 with structured data, or a
+ * JSON object), followed by message text made of random words. A few
+ * words carry escape sequences and each message has one numeric field
+ * ("bytes=...") of varying magnitude.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libestr.h"
+#include "corpus.h"
+
+static const char *monthNames[12] = {
+	"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+	"Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+static const char *hosts[] = {
+	"mymachine", "web01", "web02.example.com", "db-primary", "fw-edge-3",
+	"10.0.4.17", "mailrelay.corp.example.net", "k8s-node-0042" };
+
+static const char *programs[] = {
+	"su", "sshd", "CRON", "postfix/smtpd", "kernel", "nginx", "systemd",
+	"haproxy", "rsyslogd", "named" };
+
+static const char *severities[] = {
+	"emerg", "alert", "crit", "err", "warning", "notice", "info", "debug" };
+
+static const char *words[] = {
+	"session", "opened", "closed", "for", "user", "root", "by", "uid=0",
+	"Accepted", "publickey", "from", "port", "ssh2", "connection", "reset",
+	"peer", "timeout", "after", "seconds", "while", "reading", "response",
+	"header", "upstream", "client:", "server:", "request:", "GET", "POST",
+	"/index.html", "HTTP/1.1", "status=200", "status=404", "queued",
+	"as", "delivered", "to", "mailbox", "failed", "password", "invalid",
+	"Started", "Stopped", "unit", "job", "done", "the", "a", "of", "and",
+	"disk", "usage", "above", "threshold", "on", "/var/log", "retrying",
+	"in", "5s", "DHCPACK", "lease", "renewed", "interface", "eth0", "up" };
+
+/* these are valid C and JSON escape sequences alike */
+static const char *escWords[] = {
+	"\\\"quoted\\\"", "C:\\\\temp\\\\x.log", "col1\\tcol2", "line\\nbreak",
+	"back\\\\slash" };
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static unsigned rngState;
+
+/* xorshift32, good enough and the same on all platforms */
+static unsigned
+rnd(unsigned range)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState % range;
+}
+
+static int
+addWord(es_str_t **ps, int bJSON)
+{
+	const char *w;
+	int r;
+
+	if(rnd(16) == 0)
+		w = escWords[rnd(ARRAY_SIZE(escWords))];
+	else
+		w = words[rnd(ARRAY_SIZE(words))];
+	if((r = es_addChar(ps, ' ')) != 0)
+		return r;
+	if(!bJSON && rnd(64) == 0) /* a little upper case for the case tests */
+		return es_addUpper(ps, w, strlen(w));
+	return es_addBuf(ps, w, strlen(w));
+}
+
+static int
+genHeader(es_str_t **ps, corpusFormat_t fmt)
+{
+	char buf[512];
+	int len;
+	const char *host = hosts[rnd(ARRAY_SIZE(hosts))];
+	const char *prog = programs[rnd(ARRAY_SIZE(programs))];
+	const unsigned pri = rnd(192);
+	const unsigned mon = rnd(12), day = 1 + rnd(28);
+	const unsigned hh = rnd(24), mm = rnd(60), ss = rnd(60);
+	const unsigned pid = 1 + rnd(rnd(2) ? 99999 : 999);
+
+	switch(fmt) {
+	case CORPUS_RFC3164:
+		len = snprintf(buf, sizeof(buf), "<%u>%s %2u %02u:%02u:%02u %s %s[%u]:",
+			       pri, monthNames[mon], day, hh, mm, ss, host, prog, pid);
+		break;
+	case CORPUS_RFC5424:
+		len = snprintf(buf, sizeof(buf), "<%u>1 2026-%02u-%02uT%02u:%02u:%02u.%06uZ "
+			       "%s %s %u ID%u [exampleSDID@32473 iut=\"%u\" "
+			       "eventSource=\"Application\" eventID=\"%u\"]",
+			       pri, mon + 1, day, hh, mm, ss, rnd(1000000), host,
+			       prog, pid, rnd(100), rnd(10), 1000 + rnd(100));
+		break;
+	case CORPUS_JSON:
+	default:
+		len = snprintf(buf, sizeof(buf), "{\"@timestamp\":\"2026-%02u-%02uT%02u:%02u:%02uZ\","
+			       "\"host\":\"%s\",\"program\":\"%s\",\"pid\":%u,"
+			       "\"severity\":\"%s\",\"msg\":\"",
+			       mon + 1, day, hh, mm, ss, host, prog, pid,
+			       severities[rnd(ARRAY_SIZE(severities))]);
+		break;
+	}
+	return es_addBuf(ps, buf, len);
+}
+
+/* generate one message, *pNum receives its numeric field */
+static es_str_t *
+genMsg(corpusFormat_t fmt, es_size_t minSize, es_str_t **pNum)
+{
+	es_str_t *s;
+	unsigned long long num;
+	unsigned nWords, posNum, i;
+	unsigned mag;
+	int r;
+
+	if((s = es_newStr(256)) == NULL)
+		return NULL;
+	r = genHeader(&s, fmt);
+	nWords = 6 + rnd(9);
+	posNum = rnd(nWords);
+	for(i = 0 ; r == 0 && (i < nWords || es_strlen(s) < minSize) ; ++i) {
+		if(i == posNum) {
+			num = rnd(10);
+			for(mag = rnd(13) ; mag > 0 ; --mag)
+				num = num * 10 + rnd(10);
+			if((*pNum = es_newStrFromNumber((long long) num)) == NULL)
+				r = ENOMEM;
+			else if((r = es_addBufConstcstr(&s, " bytes=")) == 0)
+				r = es_addStr(&s, *pNum);
+		} else {
+			r = addWord(&s, fmt == CORPUS_JSON);
+		}
+	}
+	if(r == 0 && fmt == CORPUS_JSON)
+		r = es_addBufConstcstr(&s, "\"}");
+	if(r != 0) {
+		es_deleteStr(s);
+		s = NULL;
+	}
+	return s;
+}
+
+
+int
+corpusGenerate(corpus_t *c, corpusFormat_t fmt, const char *sizeName,
+	       es_size_t minSize, int nMsgs)
+{
+	static const char *fmtNames[] = { "rfc3164", "rfc5424", "json" };
+	es_str_t *s;
+	int i;
+	int r = 0;
+
+	memset(c, 0, sizeof(corpus_t));
+	snprintf(c->name, sizeof(c->name), "%s-%s", fmtNames[fmt], sizeName);
+	c->msgs = calloc(nMsgs, sizeof(char*));
+	c->lens = calloc(nMsgs, sizeof(es_size_t));
+	c->strs = calloc(nMsgs, sizeof(es_str_t*));
+	c->nums = calloc(nMsgs, sizeof(es_str_t*));
+	if(c->msgs == NULL || c->lens == NULL || c->strs == NULL || c->nums == NULL) {
+		r = ENOMEM;
+		goto done;
+	}
+	c->nMsgs = nMsgs;
+
+	rngState = 0x9e3779b9u ^ ((unsigned) fmt << 24) ^ minSize;
+	for(i = 0 ; i < nMsgs ; ++i) {
+		if((s = genMsg(fmt, minSize, &c->nums[i])) == NULL) {
+			r = ENOMEM;
+			goto done;
+		}
+		c->strs[i] = s;
+		c->lens[i] = es_strlen(s);
+		c->totalBytes += es_strlen(s);
+		if((c->msgs[i] = es_str2cstr(s, NULL)) == NULL) {
+			r = ENOMEM;
+			goto done;
+		}
+	}
+
+done:
+	if(r != 0)
+		corpusFree(c);
+	return r;
+}
+
+
+void
+corpusFree(corpus_t *c)
+{
+	int i;
+
+	for(i = 0 ; i < c->nMsgs ; ++i) {
+		free(c->msgs[i]);
+		es_deleteStr(c->strs[i]);
+		es_deleteStr(c->nums[i]);
+	}
+	free(c->msgs);
+	free(c->lens);
+	free(c->strs);
+	free(c->nums);
+	memset(c, 0, sizeof(corpus_t));
+}
@@ -0,0 +1,72 @@
+/**
+ * @file corpus.h
+ * Synthetic syslog message corpora for the benchmarks.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef BENCH_CORPUS_H_INCLUDED
+#define	BENCH_CORPUS_H_INCLUDED
+
+/** message formats */
+typedef enum {
+	CORPUS_RFC3164 = 0,	/**< traditional BSD syslog */
+	CORPUS_RFC5424 = 1,	/**< IETF syslog with structured data */
+	CORPUS_JSON = 2		/**< JSON ("CEE-like") payloads */
+} corpusFormat_t;
+
+/**
+ * A corpus, that is a set of messages of one format.
+ * The messages are generated from a fixed seed, so all runs (and all
+ * library versions) see exactly the same data.
+ */
+typedef struct {
+	char name[32];		/**< e.g. "rfc5424-medium" */
+	int nMsgs;		/**< number of messages */
+	char **msgs;		/**< the messages, NUL-terminated */
+	es_size_t *lens;	/**< message lengths (without NUL) */
+	es_str_t **strs;	/**< the messages as string objects */
+	es_str_t **nums;	/**< first number inside each message */
+	size_t totalBytes;	/**< sum of all message lengths */
+} corpus_t;
+
+/**
+ * Generate a corpus.
+ * Messages are at least minSize bytes long, as random words are added
+ * to the message text until this is reached. Some words contain
+ * C-style escape sequences.
+ *
+ * @param[out] c corpus to fill
+ * @param[in] fmt message format
+ * @param[in] sizeName name of the size class, used for the corpus name
+ * @param[in] minSize minimum message size, 0 for "natural" size
+ * @param[in] nMsgs number of messages to generate
+ * @returns 0 on success, something else otherwise
+ */
+int corpusGenerate(corpus_t *c, corpusFormat_t fmt, const char *sizeName,
+		   es_size_t minSize, int nMsgs);
+
+/**
+ * Free all memory used by a corpus.
+ */
+void corpusFree(corpus_t *c);
+
+#endif /* #ifndef BENCH_CORPUS_H_INCLUDED */
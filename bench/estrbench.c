@@ -0,0 +1,1057 @@
+/**
+ * @file estrbench.c
+ * Microbenchmarks for the libestr string functions.
+ *
+ * Each benchmark makes one pass over a corpus, calling the function
+ * under test once per message (one "op"). Passes are repeated until a
+ * minimum time has elapsed. Results are written one line per benchmark
+ * and corpus, either as CSV (the default) or as JSON lines (-j), so
+ * that runs of different library versions can be compared by scripts.
+ *
+ * Bytes per second are based on the data each op actually processes:
+ * the message, the numeric field or a part of the message. For ops
+ * that are not proportional to any data (like creating an empty
+ * string), no rate is reported. The string pool is disabled, except
+ * for the es_newStr_pool benchmark, so that the results do not depend
+ * on the --enable-pool configure switch.
+ *
+ * Allocations per op are taken from es_getStats() and thus only
+ * reported if libestr was configured with --enable-stats. They include
+ * string creations and buffer resizes, but not the malloc() done for
+ * C strings (e.g. by es_str2cstr()).
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "libestr.h"
+#include "corpus.h"
+
+/* per-corpus data the benchmarks work on */
+typedef struct {
+	const corpus_t *c;
+	es_str_t **copies;	/**< equal copies of the messages */
+	es_str_t **upper;	/**< upper case copies of the messages */
+	es_str_t **work;	/**< scratch strings for in-place functions */
+	long long *numVals;	/**< values of the numeric fields */
+	es_str_t *needle;
+	es_str_t *caseNeedle;
+	es_needle_t *compiledNeedle;
+	es_str_t *out;		/**< reused output string */
+	es_tokenizer_t *words;	/**< splits at runs of spaces */
+	es_tokenizer_t *spaces;	/**< splits at each space */
+	es_glob_t *glob;
+	es_strview_t *keys;	/**< field 3 of the messages, for es_kwtabLookup() */
+	es_kwtab_t *kwtab;
+	es_mpm_t *mpm;
+	es_arena_t *arena;
+	es_internTable_t *intern;
+	es_rope_t *rope;
+	es_iobatch_t *iobatch;
+	int fdNull;		/**< /dev/null, for es_iobatchFlush() */
+	unsigned long long bytes[5]; /**< bytes per pass, by benchBytes_t */
+} benchData_t;
+
+/* what an op processes, for the bytes/sec rate */
+typedef enum {
+	BYTES_NONE,	/**< nothing proportional to data, no rate */
+	BYTES_MSG,	/**< the whole message */
+	BYTES_NUM,	/**< the numeric field */
+	BYTES_HALF,	/**< half of the message */
+	BYTES_KEY	/**< the lookup key */
+} benchBytes_t;
+
+/* one pass over the corpus, returns something derived from the results
+ * so that the compiler can not optimize the calls away
+ */
+typedef unsigned long long (*benchFunc_t)(benchData_t *d);
+
+static volatile unsigned long long sink;
+
+
+static unsigned long long
+bench_newStr(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_newStr(d->c->lens[i]);
+		r += (s != NULL);
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_newStrFromCStr(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_newStrFromCStr(d->c->msgs[i], d->c->lens[i]);
+		r += es_strlen(s);
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_newStrFromBuf(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_newStrFromBuf(d->c->msgs[i], d->c->lens[i]);
+		r += es_strlen(s);
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_newStrFromSubStr(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_newStrFromSubStr(d->c->strs[i], d->c->lens[i] / 4, d->c->lens[i] / 2);
+		r += es_strlen(s);
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_newStrFromNumber(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_newStrFromNumber(d->numVals[i]);
+		r += es_strlen(s);
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_strdup(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_strdup(d->c->strs[i]);
+		r += es_strlen(s);
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+/* build each message from 16 byte pieces, starting with a small buffer */
+static unsigned long long
+bench_addBufGrow(benchData_t *d)
+{
+	es_str_t *s;
+	es_size_t j, n;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_newStr(16);
+		for(j = 0 ; j < d->c->lens[i] ; j += n) {
+			n = d->c->lens[i] - j < 16 ? d->c->lens[i] - j : 16;
+			es_addBuf(&s, d->c->msgs[i] + j, n);
+		}
+		r += es_strlen(s);
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_addCharGrow(benchData_t *d)
+{
+	es_str_t *s;
+	es_size_t j;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_newStr(16);
+		for(j = 0 ; j < d->c->lens[i] ; ++j)
+			es_addChar(&s, d->c->msgs[i][j]);
+		r += es_strlen(s);
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_strcmp(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_strcmp(d->c->strs[i], d->copies[i]) == 0;
+	return r;
+}
+
+static unsigned long long
+bench_strcasecmp(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_strcasecmp(d->c->strs[i], d->upper[i]) == 0;
+	return r;
+}
+
+static unsigned long long
+bench_strncmp(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_strncmp(d->c->strs[i], d->copies[i], d->c->lens[i]) == 0;
+	return r;
+}
+
+static unsigned long long
+bench_strncasecmp(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_strncasecmp(d->c->strs[i], d->upper[i], d->c->lens[i]) == 0;
+	return r;
+}
+
+static unsigned long long
+bench_strequal(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_strequal(d->c->strs[i], d->copies[i]);
+	return r;
+}
+
+static unsigned long long
+bench_strbufcmp(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_strbufcmp(d->c->strs[i], (unsigned char*) d->c->msgs[i],
+				  d->c->lens[i]) == 0;
+	return r;
+}
+
+static unsigned long long
+bench_strContains(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_strContains(d->c->strs[i], d->needle);
+	return r;
+}
+
+static unsigned long long
+bench_strCaseContains(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_strCaseContains(d->c->strs[i], d->caseNeedle);
+	return r;
+}
+
+static unsigned long long
+bench_strContainsNeedle(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_strContainsNeedle(d->c->strs[i], d->compiledNeedle);
+	return r;
+}
+
+static unsigned long long
+bench_str2num(benchData_t *d)
+{
+	int i, bSuccess;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_str2num(d->c->nums[i], &bSuccess);
+	return r;
+}
+
+static unsigned long long
+bench_str2unum(benchData_t *d)
+{
+	int i, bSuccess;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_str2unum(d->c->nums[i], &bSuccess);
+	return r;
+}
+
+static unsigned long long
+bench_str2cstr(benchData_t *d)
+{
+	char *cstr;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		cstr = es_str2cstr(d->c->strs[i], NULL);
+		r += (unsigned char) cstr[0];
+		free(cstr);
+	}
+	return r;
+}
+
+/* the escaped message is restored with a plain memcpy() before each call */
+static unsigned long long
+bench_unescapeStr(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = d->work[i];
+		memcpy(es_getBufAddr(s), d->c->msgs[i], d->c->lens[i]);
+		s->lenStr = d->c->lens[i];
+		es_strInvalidateHash(s);
+		es_unescapeStr(s);
+		r += es_strlen(s);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_tolower(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_tolower(d->work[i]);
+		r += es_getBufAddr(d->work[i])[0];
+	}
+	return r;
+}
+
+static unsigned long long
+bench_toupper(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_toupper(d->work[i]);
+		r += es_getBufAddr(d->work[i])[0];
+	}
+	return r;
+}
+
+static unsigned long long
+bench_strhash(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_hashBuf(es_getBufAddr(d->c->strs[i]), d->c->lens[i], 0);
+	return r;
+}
+
+static unsigned long long
+bench_addJSONEscaped(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_emptyStr(d->out);
+		es_addJSONEscaped(&d->out, d->c->msgs[i], d->c->lens[i]);
+		r += es_strlen(d->out);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_fieldNext(benchData_t *d)
+{
+	es_fielditer_t it;
+	es_size_t offs, len;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_fieldIterInit(&it, d->words, es_viewFromStr(d->c->strs[i]));
+		while(es_fieldNext(&it, &offs, &len))
+			r += len;
+	}
+	return r;
+}
+
+/* field 5 is the MSGID for RFC5424 */
+static unsigned long long
+bench_fieldGet(benchData_t *d)
+{
+	es_size_t offs, len;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		if(es_fieldGet(d->spaces, es_viewFromStr(d->c->strs[i]), 5, &offs, &len) == 0)
+			r += len;
+	}
+	return r;
+}
+
+static unsigned long long
+bench_globMatch(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_globMatch(d->glob, d->c->strs[i]);
+	return r;
+}
+
+static unsigned long long
+bench_addNumber(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_emptyStr(d->out);
+		es_addNumber(&d->out, d->numVals[i]);
+		r += es_strlen(d->out);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_addUNumber(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_emptyStr(d->out);
+		es_addUNumber(&d->out, (unsigned long long) d->numVals[i]);
+		r += es_strlen(d->out);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_addHexNumber(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_emptyStr(d->out);
+		es_addHexNumber(&d->out, (unsigned long long) d->numVals[i]);
+		r += es_strlen(d->out);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_str2double(benchData_t *d)
+{
+	int i, bSuccess;
+	double r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_str2double(d->c->nums[i], &bSuccess);
+	return (unsigned long long) r;
+}
+
+static unsigned long long
+bench_addStr(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_emptyStr(d->out);
+		es_addStr(&d->out, d->c->strs[i]);
+		r += es_strlen(d->out);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_addUnescaped(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_emptyStr(d->out);
+		es_addUnescaped(&d->out, d->c->msgs[i], d->c->lens[i]);
+		r += es_strlen(d->out);
+	}
+	return r;
+}
+
+static unsigned long long
+bench_addLower(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_emptyStr(d->out);
+		es_addLower(&d->out, d->c->msgs[i], d->c->lens[i]);
+		r += es_getBufAddr(d->out)[0];
+	}
+	return r;
+}
+
+static unsigned long long
+bench_addUpper(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_emptyStr(d->out);
+		es_addUpper(&d->out, d->c->msgs[i], d->c->lens[i]);
+		r += es_getBufAddr(d->out)[0];
+	}
+	return r;
+}
+
+/* reserve the message size in a small string, as done before appending */
+static unsigned long long
+bench_reserve(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		if((s = es_newStr(16)) == NULL)
+			continue;
+		es_reserve(&s, d->c->lens[i]);
+		r += s->lenBuf;
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+/* shrink strings created with twice the needed buffer size */
+static unsigned long long
+bench_shrinkToFit(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		if((s = es_newStr(2 * d->c->lens[i] + 16)) == NULL)
+			continue;
+		memcpy(es_getBufAddr(s), d->c->msgs[i], d->c->lens[i]);
+		s->lenStr = d->c->lens[i];
+		es_shrinkToFit(&s);
+		r += s->lenBuf;
+		es_deleteStr(s);
+	}
+	return r;
+}
+
+/* like bench_newStr, but with the per-thread string pool enabled */
+static unsigned long long
+bench_newStrPool(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	if(es_initPool() != 0)
+		return 0;
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_newStr(d->c->lens[i]);
+		r += (s != NULL);
+		es_deleteStr(s);
+	}
+	es_exitPool();
+	return r;
+}
+
+static unsigned long long
+bench_newStrInArena(benchData_t *d)
+{
+	es_str_t *s;
+	int i;
+	unsigned long long r = 0;
+
+	es_resetArena(d->arena);
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		s = es_newStrFromBufInArena(d->arena, d->c->msgs[i], d->c->lens[i]);
+		r += es_strlen(s);
+	}
+	return r;
+}
+
+static int
+countMatch(void *usrptr, unsigned id, es_size_t offset)
+{
+	(void) offset;
+	*(unsigned long long*) usrptr += id + 1;
+	return 0;
+}
+
+static unsigned long long
+bench_mpmSearch(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		es_mpmSearch(d->mpm, d->c->strs[i], countMatch, &r);
+	return r;
+}
+
+static unsigned long long
+bench_kwtabLookup(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_kwtabLookupBuf(d->kwtab, d->keys[i].buf, d->keys[i].len) + 1;
+	return r;
+}
+
+/* all messages are already interned by the warm-up pass, so this
+ * measures lookups of existing strings
+ */
+static unsigned long long
+bench_internBuf(benchData_t *d)
+{
+	int i;
+	unsigned long long r = 0;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i)
+		r += es_internBuf(d->intern, (const unsigned char*) d->c->msgs[i],
+				  d->c->lens[i]) != NULL;
+	return r;
+}
+
+static unsigned long long
+bench_ropeAddBuf(benchData_t *d)
+{
+	int i;
+
+	es_resetRope(d->rope);
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_ropeAddBuf(d->rope, d->c->msgs[i], d->c->lens[i]);
+		es_ropeAddBufConstcstr(d->rope, "\n");
+	}
+	return es_ropeLen(d->rope);
+}
+
+static unsigned long long
+bench_iobatchFlush(benchData_t *d)
+{
+	int i;
+
+	for(i = 0 ; i < d->c->nMsgs ; ++i) {
+		es_iobatchAddStr(d->iobatch, d->c->strs[i]);
+		es_iobatchAddBufConstcstr(d->iobatch, "\n");
+	}
+	return es_iobatchFlush(d->iobatch, d->fdNull) == 0;
+}
+
+
+static const struct {
+	const char *name;
+	benchFunc_t fn;
+	benchBytes_t bytes;
+} benchmarks[] = {
+	{ "es_newStr", bench_newStr, BYTES_NONE },
+	{ "es_newStrFromCStr", bench_newStrFromCStr, BYTES_MSG },
+	{ "es_newStrFromBuf", bench_newStrFromBuf, BYTES_MSG },
+	{ "es_newStrFromSubStr", bench_newStrFromSubStr, BYTES_HALF },
+	{ "es_newStrFromNumber", bench_newStrFromNumber, BYTES_NUM },
+	{ "es_newStr_pool", bench_newStrPool, BYTES_NONE },
+	{ "es_newStrFromBufInArena", bench_newStrInArena, BYTES_MSG },
+	{ "es_strdup", bench_strdup, BYTES_MSG },
+	{ "es_addBuf_grow", bench_addBufGrow, BYTES_MSG },
+	{ "es_addChar_grow", bench_addCharGrow, BYTES_MSG },
+	{ "es_addStr", bench_addStr, BYTES_MSG },
+	{ "es_addNumber", bench_addNumber, BYTES_NUM },
+	{ "es_addUNumber", bench_addUNumber, BYTES_NUM },
+	{ "es_addHexNumber", bench_addHexNumber, BYTES_NONE },
+	{ "es_reserve", bench_reserve, BYTES_NONE },
+	{ "es_shrinkToFit", bench_shrinkToFit, BYTES_NONE },
+	{ "es_strcmp", bench_strcmp, BYTES_MSG },
+	{ "es_strcasecmp", bench_strcasecmp, BYTES_MSG },
+	{ "es_strncmp", bench_strncmp, BYTES_MSG },
+	{ "es_strncasecmp", bench_strncasecmp, BYTES_MSG },
+	{ "es_strequal", bench_strequal, BYTES_MSG },
+	{ "es_strbufcmp", bench_strbufcmp, BYTES_MSG },
+	{ "es_strContains", bench_strContains, BYTES_MSG },
+	{ "es_strCaseContains", bench_strCaseContains, BYTES_MSG },
+	{ "es_strContainsNeedle", bench_strContainsNeedle, BYTES_MSG },
+	{ "es_mpmSearch", bench_mpmSearch, BYTES_MSG },
+	{ "es_kwtabLookupBuf", bench_kwtabLookup, BYTES_KEY },
+	{ "es_str2num", bench_str2num, BYTES_NUM },
+	{ "es_str2unum", bench_str2unum, BYTES_NUM },
+	{ "es_str2double", bench_str2double, BYTES_NUM },
+	{ "es_str2cstr", bench_str2cstr, BYTES_MSG },
+	{ "es_unescapeStr", bench_unescapeStr, BYTES_MSG },
+	{ "es_addUnescaped", bench_addUnescaped, BYTES_MSG },
+	{ "es_tolower", bench_tolower, BYTES_MSG },
+	{ "es_toupper", bench_toupper, BYTES_MSG },
+	{ "es_addLower", bench_addLower, BYTES_MSG },
+	{ "es_addUpper", bench_addUpper, BYTES_MSG },
+	{ "es_hashBuf", bench_strhash, BYTES_MSG },
+	{ "es_internBuf", bench_internBuf, BYTES_MSG },
+	{ "es_addJSONEscaped", bench_addJSONEscaped, BYTES_MSG },
+	{ "es_fieldNext", bench_fieldNext, BYTES_MSG },
+	{ "es_fieldGet", bench_fieldGet, BYTES_NONE },
+	{ "es_globMatch", bench_globMatch, BYTES_MSG },
+	{ "es_ropeAddBuf", bench_ropeAddBuf, BYTES_MSG },
+	{ "es_iobatchFlush", bench_iobatchFlush, BYTES_MSG },
+};
+
+#define NBENCHMARKS ((int) (sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+/* the corpora: three formats times three sizes */
+static const struct {
+	const char *name;
+	es_size_t minSize;
+	int nMsgs;
+} sizes[] = {
+	{ "small", 0, 2000 },
+	{ "medium", 512, 1000 },
+	{ "large", 4096, 250 }
+};
+
+#define NSIZES ((int) (sizeof(sizes) / sizeof(sizes[0])))
+
+
+/* needles for es_mpmSearch() */
+static const char *mpmNeedles[] = {
+	"failed", "session", "port", "status=", "timeout", "/var/log",
+	"DHCPACK", "eth0", "upstream", "password" };
+
+/* keywords for es_kwtabLookupBuf(); field 3 is the host for RFC3164 */
+static const char *keywords[] = {
+	"mymachine", "web01", "web02.example.com", "db-primary", "fw-edge-3",
+	"10.0.4.17", "mailrelay.corp.example.net", "k8s-node-0042", "localhost" };
+
+#define ARRAY_SIZE(a) ((int) (sizeof(a) / sizeof((a)[0])))
+
+static int
+setupData(benchData_t *d, const corpus_t *c)
+{
+	es_size_t offs, len;
+	int i, bSuccess;
+
+	memset(d, 0, sizeof(benchData_t));
+	d->c = c;
+	d->copies = calloc(c->nMsgs, sizeof(es_str_t*));
+	d->upper = calloc(c->nMsgs, sizeof(es_str_t*));
+	d->work = calloc(c->nMsgs, sizeof(es_str_t*));
+	d->numVals = calloc(c->nMsgs, sizeof(long long));
+	d->keys = calloc(c->nMsgs, sizeof(es_strview_t));
+	d->fdNull = -1;
+	if(d->copies == NULL || d->upper == NULL || d->work == NULL || d->numVals == NULL
+	   || d->keys == NULL)
+		return -1;
+	for(i = 0 ; i < c->nMsgs ; ++i) {
+		if((d->copies[i] = es_strdup(c->strs[i])) == NULL
+		   || (d->upper[i] = es_strdup(c->strs[i])) == NULL
+		   || (d->work[i] = es_strdup(c->strs[i])) == NULL)
+			return -1;
+		es_toupper(d->upper[i]);
+		d->numVals[i] = es_str2num(c->nums[i], &bSuccess);
+	}
+	d->needle = es_newStrFromCStr("disk usage above", sizeof("disk usage above") - 1);
+	d->caseNeedle = es_newStrFromCStr("FAILED PASSWORD", sizeof("FAILED PASSWORD") - 1);
+	d->out = es_newStr(1024);
+	if(d->needle == NULL || d->caseNeedle == NULL || d->out == NULL)
+		return -1;
+	if((d->compiledNeedle = es_newNeedle(d->needle, 0)) == NULL)
+		return -1;
+	d->words = es_newTokenizer((const unsigned char*) " ", 1, ES_TOK_MERGE_DELIMS);
+	d->spaces = es_newTokenizer((const unsigned char*) " ", 1, 0);
+	if(d->words == NULL || d->spaces == NULL)
+		return -1;
+	d->glob = es_newGlobFromBuf((const unsigned char*) "*[Ss]ession*user*", 17, 1);
+	if(d->glob == NULL)
+		return -1;
+
+	if((d->mpm = es_newMPM(0)) == NULL)
+		return -1;
+	for(i = 0 ; i < ARRAY_SIZE(mpmNeedles) ; ++i)
+		if(es_mpmAddBuf(d->mpm, (const unsigned char*) mpmNeedles[i],
+				strlen(mpmNeedles[i]), i) != 0)
+			return -1;
+	if(es_mpmCompile(d->mpm) != 0)
+		return -1;
+	if((d->kwtab = es_newKwTab(0)) == NULL)
+		return -1;
+	for(i = 0 ; i < ARRAY_SIZE(keywords) ; ++i)
+		if(es_kwtabAddBuf(d->kwtab, (const unsigned char*) keywords[i],
+				  strlen(keywords[i])) != 0)
+			return -1;
+	if(es_kwtabCompile(d->kwtab) != 0)
+		return -1;
+	if((d->arena = es_newArena(0)) == NULL
+	   || (d->intern = es_newInternTable(c->nMsgs)) == NULL
+	   || (d->rope = es_newRope(0)) == NULL
+	   || (d->iobatch = es_newIOBatch(2 * c->nMsgs)) == NULL)
+		return -1;
+	if((d->fdNull = open("/dev/null", O_WRONLY)) == -1)
+		return -1;
+
+	for(i = 0 ; i < c->nMsgs ; ++i) {
+		d->keys[i] = es_viewFromStr(c->strs[i]);
+		if(es_fieldGet(d->words, d->keys[i], 3, &offs, &len) == 0)
+			d->keys[i] = es_viewFromBuf(d->keys[i].buf + offs, len);
+		else
+			d->keys[i].len = 0;
+		d->bytes[BYTES_MSG] += c->lens[i];
+		d->bytes[BYTES_NUM] += es_strlen(c->nums[i]);
+		d->bytes[BYTES_HALF] += c->lens[i] / 2;
+		d->bytes[BYTES_KEY] += d->keys[i].len;
+	}
+	return 0;
+}
+
+static void
+freeData(benchData_t *d)
+{
+	int i;
+
+	for(i = 0 ; d->copies != NULL && d->upper != NULL && d->work != NULL
+		    && i < d->c->nMsgs ; ++i) {
+		es_deleteStr(d->copies[i]);
+		es_deleteStr(d->upper[i]);
+		es_deleteStr(d->work[i]);
+	}
+	free(d->copies);
+	free(d->upper);
+	free(d->work);
+	free(d->numVals);
+	free(d->keys);
+	es_deleteStr(d->needle);
+	es_deleteStr(d->caseNeedle);
+	es_deleteStr(d->out);
+	if(d->compiledNeedle != NULL)
+		es_deleteNeedle(d->compiledNeedle);
+	es_deleteTokenizer(d->words);
+	es_deleteTokenizer(d->spaces);
+	es_deleteGlob(d->glob);
+	es_deleteMPM(d->mpm);
+	es_deleteKwTab(d->kwtab);
+	es_deleteArena(d->arena);
+	es_deleteInternTable(d->intern);
+	es_deleteRope(d->rope);
+	es_deleteIOBatch(d->iobatch);
+	if(d->fdNull != -1)
+		close(d->fdNull);
+}
+
+
+static double
+nowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+runBench(int idx, benchData_t *d, double minTimeNs, int bJSON)
+{
+	es_stats_t st0, st1;
+	double t0, elapsed;
+	double ops, allocs, bytes;
+	unsigned long long passes = 0;
+	int bHaveStats;
+
+	sink += benchmarks[idx].fn(d); /* warm-up */
+	bHaveStats = (es_getStats(&st0) == 0);
+	t0 = nowNs();
+	do {
+		sink += benchmarks[idx].fn(d);
+		++passes;
+		elapsed = nowNs() - t0;
+	} while(elapsed < minTimeNs);
+	es_getStats(&st1);
+
+	ops = (double) passes * d->c->nMsgs;
+	allocs = (double) ((st1.nAlloc - st0.nAlloc) + (st1.nRealloc - st0.nRealloc)) / ops;
+	bytes = (double) d->bytes[benchmarks[idx].bytes];
+	if(bJSON) {
+		printf("{\"benchmark\":\"%s\",\"corpus\":\"%s\",\"msgs\":%d,"
+		       "\"passes\":%llu,\"ns_per_op\":%.2f,",
+		       benchmarks[idx].name, d->c->name, d->c->nMsgs, passes, elapsed / ops);
+		if(bytes > 0)
+			printf("\"bytes_per_sec\":%.0f,", passes * bytes * 1e9 / elapsed);
+		else
+			printf("\"bytes_per_sec\":null,");
+		if(bHaveStats)
+			printf("\"allocs_per_op\":%.3f}\n", allocs);
+		else
+			printf("\"allocs_per_op\":null}\n");
+	} else {
+		printf("%s,%s,%d,%llu,%.2f,", benchmarks[idx].name, d->c->name,
+		       d->c->nMsgs, passes, elapsed / ops);
+		if(bytes > 0)
+			printf("%.0f,", passes * bytes * 1e9 / elapsed);
+		else
+			printf(",");
+		if(bHaveStats)
+			printf("%.3f\n", allocs);
+		else
+			printf("\n");
+	}
+	fflush(stdout);
+}
+
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: estrbench [-j] [-t msec] [-b benchmark] [-c corpus] [-l]\n"
+		"  -j  write JSON lines instead of CSV\n"
+		"  -t  minimum run time per benchmark and corpus (default 100ms)\n"
+		"  -b  run only benchmarks whose name contains this string\n"
+		"  -c  use only corpora whose name contains this string\n"
+		"  -l  list benchmarks and exit\n");
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	corpus_t c;
+	benchData_t d;
+	const char *benchFilter = NULL;
+	const char *corpusFilter = NULL;
+	double minTimeNs = 100e6;
+	int bJSON = 0;
+	int fmt, sz, i, opt;
+	int r = 0;
+
+	while((opt = getopt(argc, argv, "jt:b:c:l")) != -1) {
+		switch(opt) {
+		case 'j':
+			bJSON = 1;
+			break;
+		case 't':
+			minTimeNs = atof(optarg) * 1e6;
+			break;
+		case 'b':
+			benchFilter = optarg;
+			break;
+		case 'c':
+			corpusFilter = optarg;
+			break;
+		case 'l':
+			for(i = 0 ; i < NBENCHMARKS ; ++i)
+				printf("%s\n", benchmarks[i].name);
+			exit(0);
+		default:
+			usage();
+		}
+	}
+
+	es_exitPool(); /* only es_newStr_pool uses it */
+	if(!bJSON)
+		printf("# libestr %s\n"
+		       "benchmark,corpus,msgs,passes,ns_per_op,bytes_per_sec,allocs_per_op\n",
+		       es_version());
+	for(fmt = CORPUS_RFC3164 ; fmt <= CORPUS_JSON ; ++fmt) {
+		for(sz = 0 ; sz < NSIZES ; ++sz) {
+			if(corpusGenerate(&c, fmt, sizes[sz].name, sizes[sz].minSize,
+					  sizes[sz].nMsgs) != 0) {
+				fprintf(stderr, "estrbench: out of memory\n");
+				return 1;
+			}
+			if(corpusFilter != NULL && strstr(c.name, corpusFilter) == NULL) {
+				corpusFree(&c);
+				continue;
+			}
+			if(setupData(&d, &c) != 0) {
+				fprintf(stderr, "estrbench: out of memory\n");
+				r = 1;
+			} else {
+				for(i = 0 ; i < NBENCHMARKS ; ++i)
+					if(benchFilter == NULL || strstr(benchmarks[i].name, benchFilter) != NULL)
+						runBench(i, &d, minTimeNs, bJSON);
+			}
+			freeData(&d);
+			corpusFree(&c);
+			if(r != 0)
+				return r;
+		}
+	}
+	return r;
+}
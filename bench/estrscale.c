@@ -0,0 +1,360 @@
+/**
+ * @file estrscale.c
+ * Multi-threaded scaling benchmark for string allocation.
+ *
+ * Each worker thread runs typical message lifecycles: a string is
+ * created, built by several appends, extended for a trailer and a
+ * second, small property string is created. Strings are kept for a
+ * batch of messages and then deleted, like a syslog worker processing
+ * a batch of messages does. Nothing is shared between the threads
+ * except the (read-only) corpus, so any loss of per-thread throughput
+ * with more threads is caused by the allocator.
+ *
+ * This is done for a number of thread counts and memory modes: plain
+ * malloc, the per-thread string pool and per-thread arenas. For each
+ * run, throughput, scaling efficiency (per-thread throughput relative
+ * to the first thread count of the same mode), CPU time and context
+ * switches are reported. High system time and many context switches
+ * indicate allocator lock contention. Efficiency naturally drops once
+ * there are more threads than CPUs.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "libestr.h"
+#include "corpus.h"
+
+typedef enum {
+	MODE_MALLOC = 0,
+	MODE_POOL = 1,
+	MODE_ARENA = 2
+} memMode_t;
+
+static const char *modeNames[] = { "malloc", "pool", "arena" };
+
+#define MAX_THREADS 1024
+#define MAX_BATCH 4096
+
+static corpus_t corpus;
+static int batchSize = 64;
+static memMode_t mode;
+static volatile int bStop;
+
+/* start gate, so that all threads begin at the same time */
+static pthread_mutex_t mutStart = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t condStart = PTHREAD_COND_INITIALIZER;
+static int bGo;
+
+typedef struct {
+	int idx;
+	unsigned long long ops;
+	int bFailed;
+	char pad[64];	/* keep the counters of different threads apart */
+} worker_t;
+
+
+static es_str_t *
+newStr(es_arena_t *a, es_size_t lenhint)
+{
+	return (a == NULL) ? es_newStr(lenhint) : es_newStrInArena(a, lenhint);
+}
+
+/* one message lifecycle, except for the delete */
+static int
+buildMsg(es_arena_t *a, int m, es_str_t **pMsg, es_str_t **pProp)
+{
+	static const char trailer[] = " relay=\"central01\" queue=\"main\"";
+	const char *msg = corpus.msgs[m];
+	const es_size_t len = corpus.lens[m];
+	const es_size_t piece = len / 5 + 1;
+	es_size_t i, n;
+	es_str_t *s;
+	int r = 0;
+
+	if((s = newStr(a, 32)) == NULL)
+		return -1;
+	for(i = 0 ; r == 0 && i < len ; i += n) {
+		n = (len - i < piece) ? len - i : piece;
+		r = es_addBuf(&s, msg + i, n);
+	}
+	if(r == 0)
+		r = es_extendBuf(&s, sizeof(trailer) - 1);
+	if(r == 0)
+		r = es_addBuf(&s, trailer, sizeof(trailer) - 1);
+	*pMsg = s;
+	if(r != 0)
+		return r;
+
+	/* a small property, e.g. the hostname */
+	if((s = newStr(a, 16)) == NULL)
+		return -1;
+	r = es_addBuf(&s, msg + len / 3, (len > 36) ? 12 : len / 3);
+	*pProp = s;
+	return r;
+}
+
+static void *
+workerMain(void *arg)
+{
+	worker_t *w = (worker_t*) arg;
+	es_str_t *msgs[MAX_BATCH];
+	es_str_t *props[MAX_BATCH];
+	es_arena_t *a = NULL;
+	unsigned long long ops = 0;
+	int m = (w->idx * 7919) % corpus.nMsgs; /* threads must not run in lockstep */
+	int i, n;
+
+	if(mode == MODE_ARENA && (a = es_newArena(0)) == NULL) {
+		w->bFailed = 1;
+		return NULL;
+	}
+	pthread_mutex_lock(&mutStart);
+	while(!bGo)
+		pthread_cond_wait(&condStart, &mutStart);
+	pthread_mutex_unlock(&mutStart);
+
+	while(!bStop) {
+		for(n = 0 ; n < batchSize ; ++n) {
+			msgs[n] = props[n] = NULL;
+			if(buildMsg(a, m, &msgs[n], &props[n]) != 0)
+				w->bFailed = 1;
+			if(++m == corpus.nMsgs)
+				m = 0;
+		}
+		for(i = 0 ; i < n ; ++i) {
+			es_deleteStr(msgs[i]);
+			es_deleteStr(props[i]);
+		}
+		if(a != NULL)
+			es_resetArena(a);
+		ops += n;
+	}
+
+	es_deleteArena(a);
+	w->ops = ops;
+	return NULL;
+}
+
+
+static double
+tv2sec(struct timeval tv)
+{
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double
+nowSec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* run one mode with one thread count, *pBase is the per-thread
+ * throughput of the first run of the mode (set by that run)
+ */
+static int
+runScale(int nThreads, double seconds, double *pBase, int bJSON)
+{
+	static worker_t workers[MAX_THREADS];
+	pthread_t tids[MAX_THREADS];
+	struct rusage ru0, ru1;
+	es_stats_t st0, st1;
+	struct timespec ts;
+	double t0, elapsed, opsPerSec, perThread, cpuUser, cpuSys;
+	double allocs;
+	unsigned long long ops = 0;
+	long ctxsw;
+	int bHaveStats;
+	int i, nStarted;
+	int r = 0;
+
+	bStop = 0;
+	bGo = 0;
+	for(nStarted = 0 ; nStarted < nThreads ; ++nStarted) {
+		memset(&workers[nStarted], 0, sizeof(worker_t));
+		workers[nStarted].idx = nStarted;
+		if(pthread_create(&tids[nStarted], NULL, workerMain, &workers[nStarted]) != 0) {
+			fprintf(stderr, "estrscale: could not create thread %d\n", nStarted);
+			r = 1;
+			break;
+		}
+	}
+
+	bHaveStats = (es_getStats(&st0) == 0);
+	getrusage(RUSAGE_SELF, &ru0);
+	t0 = nowSec();
+	pthread_mutex_lock(&mutStart);
+	bGo = 1;
+	pthread_cond_broadcast(&condStart);
+	pthread_mutex_unlock(&mutStart);
+
+	ts.tv_sec = (time_t) seconds;
+	ts.tv_nsec = (long) ((seconds - ts.tv_sec) * 1e9);
+	if(r == 0)
+		nanosleep(&ts, NULL);
+	bStop = 1;
+	for(i = 0 ; i < nStarted ; ++i) {
+		pthread_join(tids[i], NULL);
+		ops += workers[i].ops;
+		if(workers[i].bFailed)
+			r = 1;
+	}
+	elapsed = nowSec() - t0;
+	getrusage(RUSAGE_SELF, &ru1);
+	es_getStats(&st1);
+	if(r != 0)
+		return r;
+
+	opsPerSec = ops / elapsed;
+	perThread = opsPerSec / nThreads;
+	if(*pBase == 0.0)
+		*pBase = perThread;
+	cpuUser = tv2sec(ru1.ru_utime) - tv2sec(ru0.ru_utime);
+	cpuSys = tv2sec(ru1.ru_stime) - tv2sec(ru0.ru_stime);
+	ctxsw = (ru1.ru_nvcsw - ru0.ru_nvcsw) + (ru1.ru_nivcsw - ru0.ru_nivcsw);
+	allocs = (double) ((st1.nAlloc - st0.nAlloc) + (st1.nRealloc - st0.nRealloc)) / ops;
+
+	if(bJSON) {
+		printf("{\"mode\":\"%s\",\"threads\":%d,\"cpus\":%ld,\"ops\":%llu,\"seconds\":%.3f,"
+		       "\"ops_per_sec\":%.0f,\"ops_per_sec_per_thread\":%.0f,"
+		       "\"efficiency\":%.3f,\"cpu_user\":%.3f,\"cpu_sys\":%.3f,"
+		       "\"ctxsw_per_mop\":%.1f,",
+		       modeNames[mode], nThreads, sysconf(_SC_NPROCESSORS_ONLN), ops,
+		       elapsed, opsPerSec, perThread, perThread / *pBase, cpuUser,
+		       cpuSys, ctxsw * 1e6 / ops);
+		if(bHaveStats)
+			printf("\"allocs_per_op\":%.3f}\n", allocs);
+		else
+			printf("\"allocs_per_op\":null}\n");
+	} else {
+		printf("%s,%d,%llu,%.3f,%.0f,%.0f,%.3f,%.3f,%.3f,%.1f,",
+		       modeNames[mode], nThreads, ops, elapsed, opsPerSec, perThread,
+		       perThread / *pBase, cpuUser, cpuSys, ctxsw * 1e6 / ops);
+		if(bHaveStats)
+			printf("%.3f\n", allocs);
+		else
+			printf("\n");
+	}
+	fflush(stdout);
+	return 0;
+}
+
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: estrscale [-j] [-t msec] [-T threads] [-m modes] [-B batch] [-s size]\n"
+		"  -j  write JSON lines instead of CSV\n"
+		"  -t  run time per mode and thread count (default 500ms)\n"
+		"  -T  comma-separated thread counts (default 1,2,4,8,16,32)\n"
+		"  -m  comma-separated modes out of malloc,pool,arena (default all)\n"
+		"  -B  messages per batch (default 64)\n"
+		"  -s  minimum message size (default: natural RFC5424 size)\n");
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *threadList = "1,2,4,8,16,32";
+	const char *modeList = "malloc,pool,arena";
+	const char *p;
+	char *end;
+	double seconds = 0.5;
+	double base;
+	es_size_t minSize = 0;
+	int bJSON = 0;
+	int nThreads, opt;
+	int r = 0;
+
+	while((opt = getopt(argc, argv, "jt:T:m:B:s:")) != -1) {
+		switch(opt) {
+		case 'j':
+			bJSON = 1;
+			break;
+		case 't':
+			seconds = atof(optarg) / 1000.0;
+			break;
+		case 'T':
+			threadList = optarg;
+			break;
+		case 'm':
+			modeList = optarg;
+			break;
+		case 'B':
+			batchSize = atoi(optarg);
+			if(batchSize < 1 || batchSize > MAX_BATCH)
+				usage();
+			break;
+		case 's':
+			minSize = (es_size_t) atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if(corpusGenerate(&corpus, CORPUS_RFC5424, "scale", minSize, 1024) != 0) {
+		fprintf(stderr, "estrscale: out of memory\n");
+		return 1;
+	}
+	if(!bJSON)
+		printf("# libestr %s, batch size %d, %ld CPUs online\n"
+		       "mode,threads,ops,seconds,ops_per_sec,ops_per_sec_per_thread,"
+		       "efficiency,cpu_user,cpu_sys,ctxsw_per_mop,allocs_per_op\n",
+		       es_version(), batchSize, sysconf(_SC_NPROCESSORS_ONLN));
+
+	for(mode = MODE_MALLOC ; r == 0 && mode <= MODE_ARENA ; ++mode) {
+		if(strstr(modeList, modeNames[mode]) == NULL)
+			continue;
+		if(mode == MODE_POOL) {
+			if(es_initPool() != 0) {
+				fprintf(stderr, "estrscale: no string pool on this platform\n");
+				continue;
+			}
+		} else {
+			es_exitPool();
+		}
+		base = 0.0;
+		for(p = threadList ; r == 0 && *p != '\0' ; p = (*end == ',') ? end + 1 : end) {
+			nThreads = (int) strtol(p, &end, 10);
+			if(end == p || nThreads < 1 || nThreads > MAX_THREADS)
+				usage();
+			r = runScale(nThreads, seconds, &base, bJSON);
+		}
+	}
+	es_exitPool();
+
+	corpusFree(&corpus);
+	return r;
+}
@@ -31,6 +31,8 @@
 #ifndef LIBESTR_H_INCLUDED
 #define	LIBESTR_H_INCLUDED
 
+struct iovec; /* <sys/uio.h>, only needed by users of es_ropeIovec() */
+
 
 /**
  * Data type for string sizes.
@@ -78,6 +80,9 @@ char *es_version(void);
  * library calls. This is only guaranteed for read-only methods. For example,
  * the methods used to grow the string may be forced to reallocate the buffer
  * on a new address with sufficiently free space.
+ * Callers that nevertheless write into the buffer or change lenStr
+ * directly must make sure the string is not shared (es_unshareStr())
+ * and call es_strInvalidateHash() afterwards.
  *
  * @param[in] s string object
  * @returns address of buffer <b>Note: this is NOT a zero-terminated C string!</b>
@@ -110,6 +115,177 @@ es_str_t* es_newStr(es_size_t lenhint);
 void es_deleteStr(es_str_t *str);
 
 
+/**
+ * A growth policy.
+ * It controls how much memory is allocated when a string needs to grow
+ * (e.g. inside es_addBuf()). More generous growth means fewer reallocs
+ * and copies, but more unused memory.
+ */
+typedef struct {
+	unsigned factor;	/**< new buffer size in percent of the old one,
+				     100..1000 (200 doubles the buffer) */
+	es_size_t maxIncrement;	/**< max number of bytes added in one step
+				     (unless more are needed), before rounding;
+				     0 = no limit */
+	int bRoundToBins;	/**< if set, allocation sizes are rounded up to
+				     typical malloc size classes (16 byte steps
+				     for small blocks, then four steps per power
+				     of two), else to a multiple of 8 */
+} es_growthPolicy_t;
+
+/**
+ * Set the process-wide growth policy.
+ * The default is { 200, 0, 0 }, that is the buffer is doubled (or grown
+ * by the amount needed, if that is more) and sizes are rounded to a
+ * multiple of 8. Arenas may override the policy, see
+ * es_arenaSetGrowthPolicy(). This is a process-wide setting and should
+ * be set before other threads use the library.
+ *
+ * @param[in] p policy to use, NULL to restore the default
+ * @returns 0 on success, EINVAL if the policy is invalid
+ */
+int es_setGrowthPolicy(const es_growthPolicy_t *p);
+
+/**
+ * Get the current process-wide growth policy.
+ * @param[out] p receives the policy
+ */
+void es_getGrowthPolicy(es_growthPolicy_t *p);
+
+
+/** number of buckets in the es_stats_t histograms */
+#define ES_STATS_NBUCKETS 8
+
+/**
+ * Allocation statistics, see es_getStats().
+ * Only strings on the heap are counted, strings inside an arena are not.
+ */
+typedef struct {
+	unsigned long long nAlloc;	/**< number of strings created */
+	unsigned long long nFree;	/**< number of strings deleted */
+	long long bytesLive;		/**< buffer bytes of all live strings */
+	unsigned long long nRealloc;	/**< number of buffer resizes */
+	unsigned long long bytesCopied;	/**< bytes copied because a resized
+					     buffer had to move */
+	unsigned long long slackHist[ES_STATS_NBUCKETS];
+		/**< unused buffer space of deleted strings, bucket i counts
+		     strings with i/8 .. (i+1)/8 of their buffer unused */
+	unsigned long long growthHist[ES_STATS_NBUCKETS];
+		/**< number of times deleted strings had to grow, the
+		     last bucket also counts everything above */
+} es_stats_t;
+
+/**
+ * Obtain allocation statistics.
+ * The counters are summed up over all threads, including terminated
+ * ones. Each thread counts without synchronization, so the snapshot is
+ * only approximate while other threads work. This is meant to tune the
+ * growth policy and initial size hints for a real workload.
+ *
+ * Statistics are only kept if libestr was configured with
+ * --enable-stats, as counting has a (small) cost on every allocation.
+ *
+ * @param[out] st receives the statistics (zeroed if not available)
+ * @returns 0 on success, ENOTSUP if statistics are not kept
+ */
+int es_getStats(es_stats_t *st);
+
+
+/**
+ * Enable the per-thread string pool.
+ * If enabled, es_deleteStr() does not free small string objects but
+ * keeps them in a cache private to the calling thread. es_newStr() and
+ * es_extendBuf() then reuse these objects instead of calling the
+ * system allocator. This avoids allocator contention if many threads
+ * create and delete strings at a high rate. Buffer sizes are rounded up
+ * to size classes, so strings may have slightly more free space than
+ * without the pool. The pool is transparent to all other functions.
+ * Each thread's cache is freed when the thread terminates.
+ *
+ * The pool can also be enabled by default via the --enable-pool
+ * configure switch.
+ *
+ * @returns 0 on success, ENOTSUP if the platform does not support
+ *          the pool (missing thread-local storage).
+ */
+int es_initPool(void);
+
+/**
+ * Disable the per-thread string pool.
+ * The calling thread's cache is freed immediately, caches of other
+ * threads are freed when they terminate.
+ */
+void es_exitPool(void);
+
+/**
+ * An arena (memory region) for string objects.
+ * Strings created inside an arena are allocated from larger memory
+ * chunks and are all freed at once when the arena is reset or deleted.
+ * This is much faster than individual allocations if many strings
+ * share the same lifetime, e.g. all strings belonging to a message.
+ * Arena strings can be used with all regular string functions,
+ * including those that grow the string. If the string is the most
+ * recent allocation inside the arena, it is grown in place.
+ * Calling es_deleteStr() on an arena string is permitted, but usually
+ * does not free memory.
+ * @note
+ * An arena is \b not thread-safe. It is meant to be used by one thread
+ * at a time (e.g. the one currently processing the message).
+ */
+typedef struct es_arena_s es_arena_t;
+
+/**
+ * Create a new arena.
+ * @param[in] chunkSize size of the memory chunks strings are allocated
+ *            from. Use 0 for the default (16KiB). Strings larger than
+ *            half the chunk size get a dedicated chunk.
+ * @returns pointer to new object or NULL on error
+ */
+es_arena_t *es_newArena(es_size_t chunkSize);
+
+/**
+ * Delete an arena, including all strings inside it.
+ * @param[in] a arena to be deleted, may be NULL.
+ */
+void es_deleteArena(es_arena_t *a);
+
+/**
+ * Reset an arena. All strings inside it are freed, but the arena
+ * keeps one chunk of memory for future use. This is the fastest way
+ * to reuse an arena, e.g. for the next message.
+ * @param[in] a arena to be reset
+ */
+void es_resetArena(es_arena_t *a);
+
+/**
+ * Create a new string object inside an arena.
+ * @param[in] a arena to use
+ * @param[in] lenhint expected max length of string.
+ * @returns pointer to new object or NULL on error
+ */
+es_str_t* es_newStrInArena(es_arena_t *a, es_size_t lenhint);
+
+/**
+ * Create a new string object from a buffer inside an arena.
+ * This involves copying the buffer.
+ *
+ * @param[in] a arena to use
+ * @param[in] buf buffer begin
+ * @param[in] len length of buffer
+ * @returns pointer to new object or NULL on error
+ */
+es_str_t* es_newStrFromBufInArena(es_arena_t *a, const char *buf, es_size_t len);
+
+/**
+ * Set the growth policy for all strings inside an arena.
+ * See es_setGrowthPolicy() for details.
+ * @param[in] a arena
+ * @param[in] p policy to use, NULL to use the process-wide policy
+ * @returns 0 on success, EINVAL if the policy is invalid
+ */
+int es_arenaSetGrowthPolicy(es_arena_t *a, const es_growthPolicy_t *p);
+
+
 /**
  * Create a new string object based on a "traditional" C string.
  * @param[in] cstr traditional, '\0'-terminated C string
@@ -165,29 +341,67 @@ es_str_t* es_newStrFromNumber(long long num);
  * is preserved, the string in most cases needs to grow only very
  * few times. This is considered the fastest method to repeatedly
  * work with temporary strings.
+ * The string must not be shared (see es_strshare()), otherwise the
+ * program is aborted.
  *
  * @param[in] str the string to empty
  */
-static inline void
-es_emptyStr(es_str_t *str)
-{
-	str->lenStr = 0;
-}
+void es_emptyStr(es_str_t *str);
 
 
 /**
  * Duplicate a str.
- * Currently, the string is actually duplicated. May be changed to
- * copy-on-write in later releases.
+ * By default, the string is actually duplicated. If copy-on-write mode
+ * is enabled via es_setCOWMode(), this is the same as es_strshare().
  *
  * @param[in] str original string
  * @returns pointer to new object or NULL on error
  */
-static inline es_str_t*
-es_strdup(es_str_t *str)
-{
-	return es_newStrFromSubStr(str, 0, es_strlen(str));
-}
+es_str_t* es_strdup(es_str_t *str);
+
+/**
+ * Share a string (copy-on-write).
+ * Instead of copying the string, its reference count is incremented and
+ * the same object is returned. Each owner must call es_deleteStr() as
+ * usual, the string is freed when the last owner deletes it.
+ * All functions that modify a string via an updatable pointer
+ * (es_addBuf(), es_addChar(), es_extendBuf() and everything built on
+ * them) transparently create a private copy first, if the string is
+ * still shared. Functions that modify a string in place can not do
+ * that, as all owners hold the same object: use es_tolowerCOW(),
+ * es_toupperCOW() and es_unescapeStrCOW() instead of es_tolower(),
+ * es_toupper() and es_unescapeStr(), which abort the program if the
+ * string is still shared. Before calling es_emptyStr() or writing the
+ * buffer directly, call es_unshareStr(). Reference counting is
+ * thread-safe.
+ *
+ * Strings that live inside an arena are always copied.
+ *
+ * @param[in] s string to share
+ * @returns pointer to shared object (usually s) or NULL on error
+ */
+es_str_t* es_strshare(es_str_t *s);
+
+/**
+ * Make sure the caller is the only owner of a string.
+ * If the string is shared, a private copy is created and the caller's
+ * reference to the shared one is dropped. Does nothing if the string
+ * is not shared.
+ *
+ * @param[in/out] ps updatable pointer to string
+ * @returns 0 on success, something else otherwise
+ */
+int es_unshareStr(es_str_t **ps);
+
+/**
+ * Enable or disable copy-on-write mode for es_strdup() and
+ * es_ropeAddStr().
+ * This is a process-wide setting. Only enable it if all users of
+ * these functions follow the rules given for es_strshare().
+ *
+ * @param[in] bEnable 1 to enable, 0 to disable (the default)
+ */
+void es_setCOWMode(int bEnable);
 
 
 /**
@@ -211,13 +425,53 @@ int es_strcasebufcmp(es_str_t *s, const unsigned char *b, es_size_t len);
 
 /**
  * Convert a string to lower case. Once converted, this can not be
- * undone. If the caller needs the original string, it must create
- * a copy before calling tolower.
+ * undone. If the caller needs the original string, it should use
+ * es_addLower() instead. The string must not be shared
+ * (see es_strshare()), otherwise the program is aborted. Use
+ * es_tolowerCOW() if the string may be shared.
+ * Only the ASCII letters A-Z are converted, independent of the locale;
+ * all other bytes are left unchanged.
  *
  * @param[in] s string object to be converted
  */
 void es_tolower(es_str_t *s);
 
+/**
+ * Convert a string to upper case.
+ * This is the counterpart to es_tolower(), with the same restrictions.
+ */
+void es_toupper(es_str_t *s);
+
+/**
+ * Convert a string to lower case, even if it is shared.
+ * A shared string is first replaced by a private copy (see
+ * es_unshareStr()), so other owners keep seeing the original.
+ *
+ * @param[in/out] ps updatable pointer to string
+ * @returns 0 on success, something else otherwise
+ */
+int es_tolowerCOW(es_str_t **ps);
+
+/** Upper case version of es_tolowerCOW().
+ */
+int es_toupperCOW(es_str_t **ps);
+
+/**
+ * Append a buffer converted to lower case to a string.
+ * This is the out-of-place version of es_tolower(): the source is not
+ * modified and the data is converted while it is copied.
+ *
+ * @param[in/out] ps updateable pointer to to-be-appended-to string
+ * @param[in] buf buffer to convert, must not be part of *ps
+ * @param[in] lenBuf length of buffer
+ * @returns 0 on success, something else otherwise
+ */
+int es_addLower(es_str_t **ps, const char *buf, es_size_t lenBuf);
+
+/** Upper case version of es_addLower().
+ */
+int es_addUpper(es_str_t **ps, const char *buf, es_size_t lenBuf);
+
 /**
  * Compare two string objects.
  * Semantics are the same as strcmp().
@@ -233,6 +487,8 @@ es_strcmp(es_str_t *s1, es_str_t *s2)
 }
 
 /** Case-insensitive version of es_strcmp.
+ * Only ASCII letters are compared case-insensitively, independent of
+ * the locale.
  */
 static inline int
 es_strcasecmp(es_str_t *s1, es_str_t *s2)
@@ -260,6 +516,20 @@ int es_strncmp(es_str_t *s1, es_str_t *s2, es_size_t len);
 int es_strncasecmp(es_str_t *s1, es_str_t *s2, es_size_t len);
 
 
+/**
+ * Check if two strings are equal.
+ * This is faster than es_strcmp() if only equality is of interest,
+ * because strings of different length are rejected without looking
+ * at their contents. So are strings whose cached hashes (see
+ * es_strhash()) differ.
+ *
+ * @param[in] s1 frist string
+ * @param[in] s2 second string
+ * @returns 1 if equal, 0 otherwise
+*/
+int es_strequal(es_str_t *s1, es_str_t *s2);
+
+
 /**
  * Check if the second string is contained within the first string.
  *
@@ -275,11 +545,302 @@ int es_strContains(es_str_t *s1, es_str_t *s2);
 
 /**
  * This is the case-insensitive version of es_strContains. See there
- * for further information.
+ * for further information. Only ASCII letters are considered for
+ * case-insensitivity, the result does not depend on the current locale.
 */
 int es_strCaseContains(es_str_t *s1, es_str_t *s2);
 
 
+/**
+ * A precompiled needle for substring searches.
+ * If the same needle is searched for many times, all preprocessing
+ * can be done once when the needle is created. Long needles are then
+ * searched with a sublinear (on average) algorithm, short needles with
+ * the same engine as es_strContains(). The object is opaque, it is
+ * read-only while searching and so may be used by multiple threads
+ * concurrently.
+ */
+typedef struct es_needle_s es_needle_t;
+
+/**
+ * Create a precompiled needle from a string object.
+ * The needle contains a copy of the string, so the string may be
+ * deleted or modified after this call.
+ *
+ * @param[in] str string to search for
+ * @param[in] bCaseInsensitive 1 if searches shall ignore (ASCII) case,
+ *            0 otherwise
+ * @returns pointer to new object or NULL on error
+ */
+es_needle_t *es_newNeedle(es_str_t *str, int bCaseInsensitive);
+
+/**
+ * Create a precompiled needle from a buffer.
+ * See es_newNeedle() for details.
+ *
+ * @param[in] buf buffer begin
+ * @param[in] len length of buffer
+ * @param[in] bCaseInsensitive 1 if searches shall ignore (ASCII) case
+ * @returns pointer to new object or NULL on error
+ */
+es_needle_t *es_newNeedleFromBuf(const unsigned char *buf, es_size_t len,
+	int bCaseInsensitive);
+
+/**
+ * Delete a precompiled needle.
+ * @param[in] n needle to be deleted, may be NULL.
+ */
+void es_deleteNeedle(es_needle_t *n);
+
+/**
+ * Check if a precompiled needle is contained within a string.
+ * Semantics are the same as for es_strContains() (or es_strCaseContains()
+ * if the needle was created case-insensitive).
+ *
+ * @param[in] s string to search in
+ * @param[in] n needle to search for
+ * @returns -1 if n is not contained in s, otherwise the zero-based offset
+ *          of the first location where it is contained.
+ */
+int es_strContainsNeedle(es_str_t *s, es_needle_t *n);
+
+/**
+ * Check if a precompiled needle is contained within a buffer.
+ * This is the same as es_strContainsNeedle(), but works on any memory
+ * buffer. As a side-effect, it permits to search starting at an offset.
+ *
+ * @param[in] buf buffer to search in
+ * @param[in] len length of buffer
+ * @param[in] n needle to search for
+ * @returns -1 if not contained, otherwise the offset of the first match
+ */
+int es_bufContainsNeedle(const unsigned char *buf, es_size_t len, es_needle_t *n);
+
+/**
+ * A compiled shell-style wildcard pattern.
+ * The pattern syntax is that of fnmatch() without flags:
+ * - '*' matches any sequence of bytes (including '/' and none at all)
+ * - '?' matches any single byte
+ * - "[...]" matches one byte out of a set; ranges like "a-z" may be
+ *   used and a leading '!' or '^' negates the set. A ']' directly after
+ *   the (negated) opening bracket is part of the set. Named classes
+ *   like "[:alpha:]" are not supported. An unterminated '[' is a
+ *   literal.
+ * - a backslash makes the next character a literal (a trailing
+ *   backslash matches itself)
+ *
+ * Matching does not backtrack and takes time linear in the subject
+ * length, even for patterns with many stars (segments between stars
+ * with wildcards are only linear up to 64 positions). Patterns are
+ * compiled once and then may be used by multiple threads concurrently.
+ */
+typedef struct es_glob_s es_glob_t;
+
+/**
+ * Compile a wildcard pattern from a string object.
+ * The pattern is not needed after this call.
+ *
+ * If bCaseInsensitive is set, matching is the same as with fnmatch()
+ * and FNM_CASEFOLD in the C locale: subject bytes, set members and range
+ * ends are all converted to lower case before they are compared. So
+ * "[A-a]" only matches 'a' and 'A', and "[?-[]" matches no letter, even
+ * though it contains 'A' to 'Z'.
+ *
+ * @param[in] pattern the pattern
+ * @param[in] bCaseInsensitive 1 if matching shall ignore (ASCII) case
+ * @returns pointer to new object or NULL on error
+ */
+es_glob_t *es_newGlob(es_str_t *pattern, int bCaseInsensitive);
+
+/**
+ * Compile a wildcard pattern from a buffer.
+ * See es_newGlob() for details.
+ */
+es_glob_t *es_newGlobFromBuf(const unsigned char *buf, es_size_t len,
+	int bCaseInsensitive);
+
+/**
+ * Delete a compiled wildcard pattern.
+ * @param[in] g pattern to be deleted, may be NULL.
+ */
+void es_deleteGlob(es_glob_t *g);
+
+/**
+ * Check if a string matches a compiled wildcard pattern.
+ * The pattern must match the whole string.
+ *
+ * @param[in] g compiled pattern
+ * @param[in] s string to check
+ * @returns 1 if s matches, 0 otherwise
+ */
+int es_globMatch(es_glob_t *g, es_str_t *s);
+
+/**
+ * Check if a buffer matches a compiled wildcard pattern.
+ * See es_globMatch() for details.
+ */
+int es_globMatchBuf(es_glob_t *g, const unsigned char *buf, es_size_t len);
+
+
+/**
+ * A multi-pattern matcher.
+ * This finds all occurences of a set of needles within a haystack in a
+ * single pass (it is an Aho-Corasick automaton). Use it instead of
+ * multiple es_strContains() calls if a haystack must be checked against
+ * many needles. The object is opaque. Usage is as follows:
+ * - create it via es_newMPM()
+ * - add needles via es_mpmAdd() or es_mpmAddBuf()
+ * - call es_mpmCompile()
+ * - search as often as desired via es_mpmSearch(); searching does not
+ *   modify the matcher, so multiple threads may search concurrently
+ * - destruct it via es_deleteMPM()
+ */
+typedef struct es_mpm_s es_mpm_t;
+
+/**
+ * Callback to report a match found by the multi-pattern matcher.
+ *
+ * @param[in] usrptr pointer provided by the caller of es_mpmSearch()
+ * @param[in] id id of the needle found, as given to es_mpmAdd()
+ * @param[in] offset zero-based offset of the needle inside the haystack
+ * @returns 0 to continue searching, anything else to stop the search
+ */
+typedef int (*es_mpmCallback_t)(void *usrptr, unsigned id, es_size_t offset);
+
+/**
+ * Create a new (empty) multi-pattern matcher.
+ *
+ * @param[in] bCaseInsensitive 1 if matching shall ignore (ASCII) case
+ * @returns pointer to new object or NULL on error
+ */
+es_mpm_t *es_newMPM(int bCaseInsensitive);
+
+/**
+ * Delete a multi-pattern matcher.
+ * @param[in] m matcher to be deleted, may be NULL.
+ */
+void es_deleteMPM(es_mpm_t *m);
+
+/**
+ * Add a needle to the matcher.
+ * The needle is copied. Any previously compiled automaton becomes
+ * invalid and es_mpmCompile() must be called again before searching.
+ *
+ * @param[in] m matcher
+ * @param[in] needle needle to add, must not be empty
+ * @param[in] id caller-defined id, reported on match. Multiple needles
+ *            may share the same id.
+ * @returns 0 on success, something else otherwise
+ */
+int es_mpmAdd(es_mpm_t *m, es_str_t *needle, unsigned id);
+
+/**
+ * Add a needle from a buffer to the matcher.
+ * See es_mpmAdd() for details.
+ */
+int es_mpmAddBuf(es_mpm_t *m, const unsigned char *buf, es_size_t len, unsigned id);
+
+/**
+ * Compile the matcher after all needles have been added.
+ * @returns 0 on success, something else otherwise
+ */
+int es_mpmCompile(es_mpm_t *m);
+
+/**
+ * Search a string for all needles of the matcher.
+ * Matches are reported in the order of their end position inside the
+ * haystack. If multiple needles end at the same position, the longer
+ * ones are reported first. Overlapping matches are all reported.
+ *
+ * @param[in] m compiled matcher
+ * @param[in] s string to search in
+ * @param[in] cb callback to call for each match. If NULL, the search
+ *            stops at the first match found.
+ * @param[in] usrptr passed to the callback
+ * @returns number of matches reported, -1 if the matcher is not compiled
+ */
+int es_mpmSearch(es_mpm_t *m, es_str_t *s, es_mpmCallback_t cb, void *usrptr);
+
+/**
+ * Search a buffer for all needles of the matcher.
+ * See es_mpmSearch() for details.
+ */
+int es_mpmSearchBuf(es_mpm_t *m, const unsigned char *buf, es_size_t len,
+	es_mpmCallback_t cb, void *usrptr);
+
+/**
+ * A keyword table.
+ * This finds out which of a fixed set of keywords (e.g. facility or
+ * severity names) a string is equal to. Use it instead of a chain of
+ * es_strbufcmp() calls. A perfect hash function is computed for the
+ * keywords, so a lookup takes the same (short) time independent of the
+ * number of keywords. The object is opaque. Usage is as follows:
+ * - create it via es_newKwTab()
+ * - add keywords via es_kwtabAdd() or es_kwtabAddBuf()
+ * - call es_kwtabCompile()
+ * - look up strings as often as desired via es_kwtabLookup(); lookups
+ *   do not modify the table, so multiple threads may look up concurrently
+ * - destruct it via es_deleteKwTab()
+ */
+typedef struct es_kwtab_s es_kwtab_t;
+
+/**
+ * Create a new (empty) keyword table.
+ *
+ * @param[in] bCaseInsensitive 1 if lookups shall ignore (ASCII) case
+ * @returns pointer to new object or NULL on error
+ */
+es_kwtab_t *es_newKwTab(int bCaseInsensitive);
+
+/**
+ * Delete a keyword table.
+ * @param[in] t table to be deleted, may be NULL.
+ */
+void es_deleteKwTab(es_kwtab_t *t);
+
+/**
+ * Add a keyword to the table.
+ * The keyword is copied. Keywords are numbered in the order they are
+ * added, starting at 0. Any previously compiled table becomes invalid
+ * and es_kwtabCompile() must be called again before lookups.
+ *
+ * @param[in] t table
+ * @param[in] keyword keyword to add
+ * @returns 0 on success, something else otherwise
+ */
+int es_kwtabAdd(es_kwtab_t *t, es_str_t *keyword);
+
+/**
+ * Add a keyword from a buffer to the table.
+ * See es_kwtabAdd() for details.
+ */
+int es_kwtabAddBuf(es_kwtab_t *t, const unsigned char *buf, es_size_t len);
+
+/**
+ * Compile the table after all keywords have been added.
+ * @returns 0 on success, EEXIST if a keyword was added more than once
+ *          (ignoring case for case-insensitive tables), something else
+ *          otherwise
+ */
+int es_kwtabCompile(es_kwtab_t *t);
+
+/**
+ * Look up a string in a keyword table.
+ *
+ * @param[in] t compiled table
+ * @param[in] s string to look up
+ * @returns number of the keyword equal to s, -1 if there is none or
+ *          the table is not compiled
+ */
+int es_kwtabLookup(es_kwtab_t *t, es_str_t *s);
+
+/**
+ * Look up a buffer in a keyword table.
+ * See es_kwtabLookup() for details.
+ */
+int es_kwtabLookupBuf(es_kwtab_t *t, const unsigned char *buf, es_size_t len);
+
+
 /**
  * A macro to compare a string against a constant C string
  */
@@ -298,6 +859,31 @@ int es_strCaseContains(es_str_t *s1, es_str_t *s2);
  */
 int es_extendBuf(es_str_t **ps, es_size_t minNeeded);
 
+/**
+ * Make sure a string can grow by at least need bytes without further
+ * reallocation. In contrast to es_extendBuf(), the growth policy's
+ * factor is not applied, only its rounding. Does nothing if there is
+ * already enough free space.
+ *
+ * @param[in/out] ps updateable pointer to string
+ * @param[in] need number of bytes to reserve beyond the current length
+ * @returns 0 on success, something else otherwise
+ */
+int es_reserve(es_str_t **ps, es_size_t need);
+
+/**
+ * Give back unused buffer space of a string.
+ * The buffer is shrunk to the string length (rounded according to the
+ * growth policy). This is useful for strings that are kept for a long
+ * time after they have been built. Shared strings are not modified, and
+ * strings inside an arena can only be shrunk if they are the arena's
+ * most recent allocation.
+ *
+ * @param[in/out] ps updateable pointer to string
+ * @returns 0 on success, something else otherwise
+ */
+int es_shrinkToFit(es_str_t **ps);
+
 /**
  * Append a character to the current string object.
  * Note that the pointer to the string object may change. This
@@ -326,6 +912,43 @@ int es_addBuf(es_str_t **ps1, const char *buf, const es_size_t lenBuf);
 #define es_addBufConstcstr(str, constcstr) \
 	es_addBuf(str, constcstr, sizeof(constcstr) - 1)
 
+/**
+ * Append the decimal representation of a number to a string.
+ * The digits are written directly into the string's buffer.
+ *
+ * @param[in/out] ps updateable pointer to to-be-appended-to string
+ * @param[in] num number to append
+ * @returns 0 on success, something else otherwise
+ */
+int es_addNumber(es_str_t **ps, long long num);
+
+/**
+ * Unsigned version of es_addNumber().
+ */
+int es_addUNumber(es_str_t **ps, unsigned long long num);
+
+/**
+ * Append the hexadecimal representation of a number to a string.
+ * Lower case digits are used and no "0x" prefix is added.
+ *
+ * @param[in/out] ps updateable pointer to to-be-appended-to string
+ * @param[in] num number to append
+ * @returns 0 on success, something else otherwise
+ */
+int es_addHexNumber(es_str_t **ps, unsigned long long num);
+
+/**
+ * Zero-padded version of es_addNumber().
+ * Leading zeros are added until at least minDigits digits are written,
+ * not counting the minus sign (like printf's "%.*lld").
+ *
+ * @param[in/out] ps updateable pointer to to-be-appended-to string
+ * @param[in] num number to append
+ * @param[in] minDigits minimum number of digits
+ * @returns 0 on success, something else otherwise
+ */
+int es_addNumberPadded(es_str_t **ps, long long num, es_size_t minDigits);
+
 /**
  * Append a second string to the first one.
  *
@@ -390,6 +1013,30 @@ char *es_str2cstr(es_str_t *s, const char *nulEsc);
  */
 long long es_str2num(es_str_t *s, int *bSuccess);
 
+/**
+ * Unsigned version of es_str2num().
+ * Decimal, octal and hex numbers are accepted like with es_str2num(),
+ * but a leading minus sign is not. The full unsigned 64 bit range can
+ * be represented; on overflow, ULLONG_MAX is returned.
+ */
+unsigned long long es_str2unum(es_str_t *s, int *bSuccess);
+
+/**
+ * Obtain a floating point number from a string.
+ * The accepted format is an optional minus sign, digits with an optional
+ * decimal point (at least one digit is required) and an optional exponent
+ * ("e" or "E", optionally followed by a sign, and digits). The decimal
+ * point is always ".", independent of the locale. Hex floats, infinity
+ * and NaN are not supported. bSuccess has the same meaning as in
+ * es_str2num().
+ *
+ * @param[in] s string object
+ * @param[out] bSucccess set to 1 if the whole string was a valid number,
+ *             else 0; may be NULL
+ * @returns number value, or +/-HUGE_VAL on overflow
+ */
+double es_str2double(es_str_t *s, int *bSuccess);
+
 /**
  * Unescape a string.
  * The escape seqences defined below will be unescaped and replaced
@@ -420,8 +1067,622 @@ long long es_str2num(es_str_t *s, int *bSuccess);
  * guaranteed. Most importantly, a special meaning may be assigned
  * to any of the currently-unassigned characters in the future.
  *
+ * The string must not be shared (see es_strshare()), otherwise the
+ * program is aborted. Use es_unescapeStrCOW() if the string may be
+ * shared.
+ *
  * @param[in/out] s string object to unescape.
  */
 void es_unescapeStr(es_str_t *s);
 
+/**
+ * Unescape a string, even if it is shared.
+ * This is es_unescapeStr() for strings that may be shared: a shared
+ * string is first replaced by a private copy (see es_unshareStr()).
+ *
+ * @param[in/out] ps updatable pointer to string
+ * @returns 0 on success, something else otherwise
+ */
+int es_unescapeStrCOW(es_str_t **ps);
+
+/**
+ * Unescape a buffer and append the result to a string.
+ * This is the out-of-place version of es_unescapeStr(), with the same
+ * escape sequences. The destination is grown at most once, as unescaped
+ * data is never longer than the original.
+ *
+ * @param[in/out] ps updateable pointer to to-be-appended-to string
+ * @param[in] buf buffer to unescape, must not be part of *ps
+ * @param[in] lenBuf length of buffer
+ * @returns 0 on success, something else otherwise
+ */
+int es_addUnescaped(es_str_t **ps, const char *buf, es_size_t lenBuf);
+
+/**
+ * Escape a buffer for use inside a JSON string and append the result.
+ * Quotation marks, backslashes and control characters are escaped as
+ * required by RFC 8259; all other bytes are copied unchanged. The
+ * surrounding quotation marks are \b not added. Runs that need no
+ * escaping are detected with SIMD instructions (where available) and
+ * copied in bulk.
+ *
+ * @param[in/out] ps updateable pointer to to-be-appended-to string
+ * @param[in] buf buffer to escape, must not be part of *ps
+ * @param[in] lenBuf length of buffer
+ * @returns 0 on success, something else otherwise
+ */
+int es_addJSONEscaped(es_str_t **ps, const char *buf, es_size_t lenBuf);
+
+/**
+ * Same as es_addJSONEscaped(), but also validates UTF-8. Each byte that
+ * is not part of a valid UTF-8 sequence is replaced by \\ufffd (the
+ * Unicode replacement character), so the result is always valid JSON.
+ * This is somewhat slower for non-ASCII data.
+ */
+int es_addJSONEscapedUTF8(es_str_t **ps, const char *buf, es_size_t lenBuf);
+
+
+/**
+ * A string view.
+ * This is a non-owning reference to a part of a string object (or any
+ * other buffer). Views are intended to be passed by value. Creating a
+ * view does not copy any data, so it is very cheap, e.g. to reference
+ * individual fields of a message. However, a view is only valid as long
+ * as the underlying buffer is unchanged; especially, any function that
+ * may grow the string (like es_addBuf()) invalidates views on it. If the
+ * data must outlive the buffer, create a string from the view via
+ * es_newStrFromView().
+ */
+typedef struct
+{
+	const unsigned char *buf;	/**< start of viewed data */
+	es_size_t len;			/**< length of viewed data */
+} es_strview_t;
+
+/**
+ * Create a view on a buffer.
+ */
+static inline es_strview_t
+es_viewFromBuf(const unsigned char *buf, es_size_t len)
+{
+	es_strview_t v;
+	v.buf = buf;
+	v.len = len;
+	return v;
+}
+
+/**
+ * Create a view on a complete string object.
+ */
+static inline es_strview_t
+es_viewFromStr(es_str_t *s)
+{
+	return es_viewFromBuf(es_getBufAddr(s), s->lenStr);
+}
+
+/**
+ * Create a view on a substring of a string object.
+ * This is the view counterpart to es_newStrFromSubStr() and has the same
+ * semantics: if start > strlen, an empty view is returned. If
+ * start+len > strlen, the rest of the string starting at start is viewed.
+ *
+ * @param[in] s original string
+ * @param[in] start beginning position of substring (0-based)
+ * @param[in] len length of substring
+ */
+static inline es_strview_t
+es_viewFromSubStr(es_str_t *s, es_size_t start, es_size_t len)
+{
+	if(start > s->lenStr)
+		start = len = 0;
+	else if(len > s->lenStr - start)
+		len = s->lenStr - start;
+	return es_viewFromBuf(es_getBufAddr(s) + start, len);
+}
+
+/**
+ * Create a new string object from a view. This copies the data.
+ * @returns pointer to new object or NULL on error
+ */
+es_str_t* es_newStrFromView(es_strview_t v);
+
+/**
+ * Compare a view against a buffer.
+ * This is the view counterpart to es_strbufcmp(), see there for details.
+ */
+int es_viewbufcmp(es_strview_t v, const unsigned char *buf, es_size_t len);
+
+/** Case-insensitive version of es_viewbufcmp.
+ */
+int es_viewcasebufcmp(es_strview_t v, const unsigned char *buf, es_size_t len);
+
+/**
+ * Compare two views.
+ * Semantics are the same as for es_strcmp().
+ */
+static inline int
+es_viewcmp(es_strview_t v1, es_strview_t v2)
+{
+	return es_viewbufcmp(v1, v2.buf, v2.len);
+}
+
+/** Case-insensitive version of es_viewcmp.
+ */
+static inline int
+es_viewcasecmp(es_strview_t v1, es_strview_t v2)
+{
+	return es_viewcasebufcmp(v1, v2.buf, v2.len);
+}
+
+/**
+ * Check if two views are equal.
+ * This is the view counterpart to es_strequal().
+ */
+int es_viewequal(es_strview_t v1, es_strview_t v2);
+
+/**
+ * A macro to compare a view against a constant C string
+ */
+#define es_viewconstcmp(v, constcstr) \
+	es_viewbufcmp(v, (const unsigned char*) constcstr, sizeof(constcstr) - 1)
+
+/**
+ * Check if the second view is contained within the first one.
+ * This is the view counterpart to es_strContains(), see there for details.
+ */
+int es_viewContains(es_strview_t v1, es_strview_t v2);
+
+/**
+ * Case-insensitive version of es_viewContains.
+ */
+int es_viewCaseContains(es_strview_t v1, es_strview_t v2);
+
+/**
+ * Obtain a traditional C-String from a view.
+ * This is the view counterpart to es_str2cstr(), see there for details.
+ */
+char *es_view2cstr(es_strview_t v, const char *nulEsc);
+
+/**
+ * Obtain a number from a view.
+ * This is the view counterpart to es_str2num(), see there for details.
+ */
+long long es_view2num(es_strview_t v, int *bSuccess);
+
+/** View counterpart to es_str2unum(). */
+unsigned long long es_view2unum(es_strview_t v, int *bSuccess);
+
+/** View counterpart to es_str2double(). */
+double es_view2double(es_strview_t v, int *bSuccess);
+
+/**
+ * Parse a number at the start of a view.
+ * The syntax is the same as for es_str2num(), but the number does not
+ * need to span the whole view. This permits to extract numbers from
+ * fields like "250ms" and to continue parsing after them. In contrast
+ * to es_str2num(), at least one digit is required.
+ *
+ * @param[in] v view to parse
+ * @param[out] pNum parsed number (may be NULL). On overflow, it is set
+ *             to LLONG_MAX or LLONG_MIN, on error to 0.
+ * @param[out] pLenUsed number of bytes consumed (may be NULL). On
+ *             overflow, this includes all digits; on error, it is 0.
+ * @returns 0 on success, ERANGE on overflow, EINVAL if the view does
+ *          not start with a number
+ */
+int es_viewParseNum(es_strview_t v, long long *pNum, es_size_t *pLenUsed);
+
+/**
+ * Unsigned version of es_viewParseNum(), see es_str2unum() for the syntax.
+ * On overflow, *pNum is set to ULLONG_MAX.
+ */
+int es_viewParseUNum(es_strview_t v, unsigned long long *pNum, es_size_t *pLenUsed);
+
+/**
+ * Floating point version of es_viewParseNum(), see es_str2double() for
+ * the syntax. On overflow, *pNum is set to +/-HUGE_VAL. An exponent
+ * marker without digits is not consumed.
+ * @returns 0 on success, ERANGE on overflow, EINVAL if the view does
+ *          not start with a number, ENOMEM if memory was exhausted
+ */
+int es_viewParseDouble(es_strview_t v, double *pNum, es_size_t *pLenUsed);
+
+/**
+ * A tokenizer, which splits data into fields at delimiters.
+ * Fields are returned as offset and length into the data, so splitting
+ * does neither copy nor allocate. The set of delimiter bytes is
+ * compiled once into the (opaque) tokenizer object, which then can be
+ * used by many threads concurrently. Usage is as follows:
+ * - create it via es_newTokenizer()
+ * - iterate over the fields of some data via es_fieldIterInit() and
+ *   es_fieldNext(), or fetch a single field via es_fieldGet()
+ * - destruct it via es_deleteTokenizer()
+ *
+ * Without flags, each delimiter ends a field, so n delimiters result in
+ * n+1 (possibly empty) fields, like with CSV.
+ */
+typedef struct es_tokenizer_s es_tokenizer_t;
+
+/** Runs of delimiters count as one delimiter and leading and trailing
+ *  delimiters are ignored, so there are no empty fields (e.g. for
+ *  words separated by spaces).
+ */
+#define ES_TOK_MERGE_DELIMS	0x01
+/** Fields may be enclosed in double quotes. Delimiters inside quotes
+ *  are part of the field. A literal quote inside a quoted field is
+ *  written as two quotes (CSV style).
+ */
+#define ES_TOK_QUOTES		0x02
+/** Like ES_TOK_QUOTES, but inside quotes a backslash escapes the next
+ *  character (RFC5424 structured data style).
+ */
+#define ES_TOK_QUOTES_BSLASH	0x04
+
+/**
+ * Create a new tokenizer.
+ *
+ * @param[in] delims delimiter bytes (all of them are delimiters)
+ * @param[in] nDelims number of delimiter bytes, at least 1
+ * @param[in] flags ES_TOK_* flags, ORed together
+ * @returns pointer to new object or NULL on error
+ */
+es_tokenizer_t *es_newTokenizer(const unsigned char *delims, es_size_t nDelims, int flags);
+
+/**
+ * Delete a tokenizer.
+ * @param[in] t tokenizer to be deleted, may be NULL.
+ */
+void es_deleteTokenizer(es_tokenizer_t *t);
+
+/**
+ * State of an iteration over fields.
+ * This is usually placed on the stack. The members are private.
+ */
+typedef struct {
+	es_tokenizer_t *tok;
+	const unsigned char *buf;
+	es_size_t len;
+	es_size_t pos;		/**< start of next field */
+	int bDone;
+	int bQuoted;		/**< last field returned was quoted */
+} es_fielditer_t;
+
+/**
+ * Start iterating over the fields of a view.
+ * Use es_viewFromStr() to iterate over a string object. The viewed data
+ * must remain unmodified during the iteration.
+ *
+ * @param[out] it iterator to initialize
+ * @param[in] t tokenizer to use
+ * @param[in] v data to split
+ */
+void es_fieldIterInit(es_fielditer_t *it, es_tokenizer_t *t, es_strview_t v);
+
+/**
+ * Obtain the next field.
+ * For quoted fields, the enclosing quotes are not part of the field,
+ * but escape sequences inside it are returned as they are; see
+ * es_fieldIsQuoted(). Data between the closing quote and the next
+ * delimiter is ignored.
+ *
+ * @param[in/out] it iterator
+ * @param[out] pOffs offset of the field, relative to the start of the view
+ * @param[out] pLen length of the field
+ * @returns 1 if a field was returned, 0 if there are no more fields
+ */
+int es_fieldNext(es_fielditer_t *it, es_size_t *pOffs, es_size_t *pLen);
+
+/**
+ * Check if the field returned last by es_fieldNext() was quoted.
+ * Only quoted fields can contain escape sequences.
+ */
+static inline int
+es_fieldIsQuoted(const es_fielditer_t *it)
+{
+	return it->bQuoted;
+}
+
+/**
+ * Obtain field n (0-based) of a view.
+ * The result is the same as calling es_fieldNext() n+1 times, but
+ * without ES_TOK_MERGE_DELIMS and quotes, delimiters are counted block
+ * by block (vectorized where possible), which is much faster for
+ * fields at the end of long data.
+ *
+ * @param[in] t tokenizer to use
+ * @param[in] v data to split
+ * @param[in] n number of the field
+ * @param[out] pOffs offset of the field, relative to the start of the view
+ * @param[out] pLen length of the field
+ * @returns 0 on success, ENOENT if there are not enough fields
+ */
+int es_fieldGet(es_tokenizer_t *t, es_strview_t v, es_size_t n,
+	es_size_t *pOffs, es_size_t *pLen);
+
+/**
+ * A string intern table.
+ * Interning maps all strings with equal contents to a single canonical
+ * string object, which then can be compared by pointer. This saves
+ * memory and compare time for values that repeat frequently, like
+ * hostnames, tags or field names.
+ *
+ * Lookups of already interned strings do not take any lock, so a table
+ * can be shared by many threads with little overhead; only inserting a
+ * new string serializes on a mutex.
+ *
+ * Interned strings are owned by the table and remain valid until the
+ * table is deleted. They are \b read-only: the same object is handed
+ * out to all callers and used for later lookups, so modifying it would
+ * change the value for everybody. They behave like permanently shared
+ * strings (see es_strshare()): functions that take an updatable
+ * pointer, like es_addBuf(), replace the caller's pointer by a private
+ * copy, and the in-place modifiers (es_tolower() etc.) abort the
+ * program. es_emptyStr() and writing the buffer directly are not
+ * permitted. es_deleteStr() on an interned string is a no-op.
+ * Code that needs a modifiable string must call es_unshareStr() on
+ * (its pointer to) the interned string first.
+ */
+typedef struct es_internTable_s es_internTable_t;
+
+/**
+ * Create a new intern table.
+ * @param[in] sizeHint expected number of distinct strings; the table
+ *            grows as needed, so 0 is fine.
+ * @returns pointer to new object or NULL on error
+ */
+es_internTable_t *es_newInternTable(es_size_t sizeHint);
+
+/**
+ * Delete an intern table, including all strings interned in it.
+ * No other thread must use the table or any of its strings while (or
+ * after) it is being deleted.
+ * @param[in] t table to be deleted, may be NULL.
+ */
+void es_deleteInternTable(es_internTable_t *t);
+
+/**
+ * Intern a buffer.
+ * @param[in] t table to use
+ * @param[in] buf buffer begin
+ * @param[in] len length of buffer
+ * @returns the canonical string with the given contents or NULL on
+ *          error. All calls with equal contents return the same pointer.
+ */
+es_str_t *es_internBuf(es_internTable_t *t, const unsigned char *buf, es_size_t len);
+
+/**
+ * Intern a string.
+ * The string itself is not modified and remains owned by the caller.
+ * @param[in] t table to use
+ * @param[in] s string to intern
+ * @returns the canonical string with the contents of s or NULL on error
+ */
+es_str_t *es_intern(es_internTable_t *t, es_str_t *s);
+
+/**
+ * Compute the hash of a buffer.
+ * This is a fast, high-quality 64 bit hash (XXH64), suitable for hash
+ * tables. The seed can be used to make hash values unpredictable to
+ * outside parties (e.g. to defend against hash flooding). Hash values
+ * are only meant to be used inside a process; they may differ between
+ * platforms and library versions.
+ *
+ * @param[in] buf buffer begin
+ * @param[in] len length of buffer
+ * @param[in] seed hash seed
+ * @returns hash value
+ */
+unsigned long long es_hashBuf(const unsigned char *buf, es_size_t len, unsigned long long seed);
+
+/**
+ * Compute the hash of a string.
+ * The result is the same as es_hashBuf() over the string's contents.
+ * If libestr was built with --enable-hash-cache, the hash is cached
+ * inside the string object, so repeated calls with the same seed are
+ * very cheap. The cache is invalidated by all library functions that
+ * modify the string. Code that modifies the string buffer directly
+ * (via es_getBufAddr()) must call es_strInvalidateHash() afterwards.
+ * Strings shared via es_strshare() are not cached (except for interned
+ * strings with seed 0), as other threads may access them concurrently.
+ *
+ * @param[in] s string to hash
+ * @param[in] seed hash seed
+ * @returns hash value
+ */
+unsigned long long es_strhash(es_str_t *s, unsigned long long seed);
+
+/**
+ * Invalidate the cached hash of a string.
+ * This must be called after modifying a string's buffer directly. It
+ * is a no-op if the hash cache is not enabled.
+ * @param[in] s string that was modified
+ */
+void es_strInvalidateHash(es_str_t *s);
+
+/**
+ * Compute the hash of a view.
+ * The result is the same as for es_strhash() on a string with equal
+ * contents, but it is never cached.
+ */
+static inline unsigned long long
+es_viewhash(es_strview_t v, unsigned long long seed)
+{
+	return es_hashBuf(v.buf, v.len, seed);
+}
+
+/**
+ * A rope (chunk list) string builder.
+ * Appending to a rope never moves data already inside it: data is
+ * copied into fixed-size chunks, which are simply linked together.
+ * In copy-on-write mode, larger strings are not copied at all, but
+ * referenced via es_strshare(). This avoids the repeated copying es_addBuf() does when
+ * it needs to grow a large string. The rope's contents can be converted
+ * into a regular string via es_ropeFlatten() or written without any
+ * further copying via es_ropeIovec() and writev().
+ * @note
+ * A rope is \b not thread-safe.
+ */
+typedef struct es_rope_s es_rope_t;
+
+/**
+ * Create a new (empty) rope.
+ * @param[in] chunkSize size of the data chunks. Use 0 for the default
+ *            (64KiB).
+ * @returns pointer to new object or NULL on error
+ */
+es_rope_t *es_newRope(es_size_t chunkSize);
+
+/**
+ * Delete a rope.
+ * @param[in] rope rope to be deleted, may be NULL.
+ */
+void es_deleteRope(es_rope_t *rope);
+
+/**
+ * Reset a rope to empty. One data chunk is kept for future use, so
+ * a rope can efficiently be reused, e.g. for the next output batch.
+ * @param[in] rope rope to be reset
+ */
+void es_resetRope(es_rope_t *rope);
+
+/**
+ * Append a buffer to a rope. This involves copying the buffer.
+ * @param[in] rope rope to append to
+ * @param[in] buf buffer begin
+ * @param[in] lenBuf length of buffer
+ * @returns 0 on success, something else otherwise
+ */
+int es_ropeAddBuf(es_rope_t *rope, const char *buf, es_size_t lenBuf);
+
+/**
+ * Append a string to a rope.
+ * The rope takes a snapshot of the string's current contents; the
+ * caller keeps ownership of its string and may modify it afterwards.
+ * If copy-on-write mode is enabled (see es_setCOWMode()), larger
+ * strings (a quarter of the chunk size or more) are not copied, but
+ * shared via es_strshare(); the caller must then follow the rules for
+ * shared strings given there. Otherwise, the string is always copied.
+ * @param[in] rope rope to append to
+ * @param[in] s string to append
+ * @returns 0 on success, something else otherwise
+ */
+int es_ropeAddStr(es_rope_t *rope, es_str_t *s);
+
+/**
+ * A macro to add a traditional C constant to a rope.
+ */
+#define es_ropeAddBufConstcstr(rope, constcstr) \
+	es_ropeAddBuf(rope, constcstr, sizeof(constcstr) - 1)
+
+/**
+ * Get the length of a rope's contents.
+ */
+es_size_t es_ropeLen(es_rope_t *rope);
+
+/**
+ * Get the number of chunks of a rope. This is the maximum number of
+ * iovec entries es_ropeIovec() requires.
+ */
+int es_ropeNumChunks(es_rope_t *rope);
+
+/**
+ * Create a string from a rope's contents. The rope is not modified.
+ * @param[in] rope rope to flatten
+ * @returns pointer to new object or NULL on error
+ */
+es_str_t *es_ropeFlatten(es_rope_t *rope);
+
+/**
+ * Describe a rope's contents as an iovec array, e.g. for writev().
+ * The iovec entries point into the rope and are valid until the rope
+ * is modified, reset or deleted.
+ * @param[in] rope rope to describe
+ * @param[out] iov array to fill
+ * @param[in] nIov number of entries in iov
+ * @returns number of entries filled. If this is nIov and less than
+ *          es_ropeNumChunks(), iov was too small to describe all data.
+ */
+int es_ropeIovec(es_rope_t *rope, struct iovec *iov, int nIov);
+
+/**
+ * A scatter/gather output batch.
+ * A batch collects references to strings and other buffers and writes
+ * all of them with a single writev() call (or a few, if there are more
+ * than IOV_MAX entries). No data is copied, so all strings and buffers
+ * added to the batch must remain valid and unchanged until the batch is
+ * flushed or reset.
+ * @note
+ * A batch is \b not thread-safe.
+ */
+typedef struct es_iobatch_s es_iobatch_t;
+
+/**
+ * Create a new (empty) batch.
+ * @param[in] nHint expected number of entries per batch, 0 for the
+ *            default. The batch grows as needed.
+ * @returns pointer to new object or NULL on error
+ */
+es_iobatch_t *es_newIOBatch(int nHint);
+
+/**
+ * Delete a batch. Unwritten data is discarded.
+ * @param[in] b batch to be deleted, may be NULL.
+ */
+void es_deleteIOBatch(es_iobatch_t *b);
+
+/**
+ * Discard all entries of a batch.
+ * @param[in] b batch to reset
+ */
+void es_resetIOBatch(es_iobatch_t *b);
+
+/**
+ * Add a buffer to a batch.
+ * @param[in] b batch to add to
+ * @param[in] buf buffer begin
+ * @param[in] len length of buffer
+ * @returns 0 on success, something else otherwise
+ */
+int es_iobatchAddBuf(es_iobatch_t *b, const void *buf, es_size_t len);
+
+/**
+ * Add a string to a batch.
+ * @param[in] b batch to add to
+ * @param[in] s string to add
+ * @returns 0 on success, something else otherwise
+ */
+int es_iobatchAddStr(es_iobatch_t *b, es_str_t *s);
+
+/**
+ * A macro to add a traditional C constant to a batch.
+ */
+#define es_iobatchAddBufConstcstr(b, constcstr) \
+	es_iobatchAddBuf(b, constcstr, sizeof(constcstr) - 1)
+
+/**
+ * Add the contents of a rope to a batch.
+ * @param[in] b batch to add to
+ * @param[in] rope rope to add
+ * @returns 0 on success, something else otherwise
+ */
+int es_iobatchAddRope(es_iobatch_t *b, es_rope_t *rope);
+
+/**
+ * Get the number of bytes not yet written.
+ */
+size_t es_iobatchLen(es_iobatch_t *b);
+
+/**
+ * Write a batch to a file descriptor.
+ * Partial writes and interrupted calls are retried until all data is
+ * written. On success, the batch is reset. On error (including EAGAIN
+ * on non-blocking descriptors), the batch keeps the data not yet
+ * written, so that the flush can be retried later.
+ *
+ * @param[in] b batch to write
+ * @param[in] fd file descriptor to write to
+ * @returns 0 on success, an errno value otherwise
+ */
+int es_iobatchFlush(es_iobatch_t *b, int fd);
+
 #endif /* #ifndef LIBESTR_H_INCLUDED */
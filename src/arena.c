@@ -0,0 +1,295 @@
+/**
+ * @file arena.c
+ * Implements arenas (memory regions) for string objects.
+ *
+ * Strings inside an arena are bump-allocated from large chunks and are
+ * all freed together when the arena is reset or deleted. Each string
+ * records the offset of its header inside the chunk, so we can find the
+ * chunk (and thus the arena) from the string alone. That way, the
+ * regular string functions (most importantly es_extendBuf()) work
+ * unchanged on arena strings.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#define DEFAULT_CHUNK_SIZE (16 * 1024)
+
+struct arenaChunk {
+	struct arenaChunk *next;
+	es_arena_t *arena;
+	size_t size;		/**< total size of chunk, including this header */
+	size_t used;		/**< bytes used, including this header */
+};
+
+/* string allocations start at this offset, which keeps them 8-byte aligned */
+#define CHUNK_HDR_SIZE ((sizeof(struct arenaChunk) + 7) & ~((size_t) 7))
+
+struct es_arena_s {
+	struct arenaChunk *chunks;	/**< current chunk first */
+	size_t chunkSize;		/**< size of regular chunks */
+	int bHavePolicy;		/**< use policy instead of the process-wide one? */
+	es_growthPolicy_t policy;
+};
+
+
+/* size of the memory block occupied by an arena string with the
+ * given buffer size. For arena strings, lenBuf is always a multiple
+ * of 8, so no rounding is required.
+ */
+static inline size_t
+allocSize(es_size_t lenBuf)
+{
+	return sizeof(es_strhdr_t) + sizeof(es_str_t) + (size_t) lenBuf;
+}
+
+static inline struct arenaChunk *
+chunkOf(es_strhdr_t *h)
+{
+	return (struct arenaChunk*) (((char*) h) - h->u.arenaOffs);
+}
+
+
+es_arena_t *
+es_newArena(es_size_t chunkSize)
+{
+	es_arena_t *a;
+
+	if((a = malloc(sizeof(es_arena_t))) == NULL)
+		goto done;
+	a->chunks = NULL;
+	a->bHavePolicy = 0;
+	a->chunkSize = (chunkSize == 0) ? DEFAULT_CHUNK_SIZE : chunkSize;
+	a->chunkSize = (a->chunkSize + 7) & ~((size_t) 7);
+	a->chunkSize += CHUNK_HDR_SIZE;
+
+done:
+	return a;
+}
+
+
+void
+es_deleteArena(es_arena_t *a)
+{
+	struct arenaChunk *c, *del;
+
+	if(a == NULL)
+		return;
+	for(c = a->chunks ; c != NULL ; ) {
+		del = c;
+		c = c->next;
+		free(del);
+	}
+	free(a);
+}
+
+
+void
+es_resetArena(es_arena_t *a)
+{
+	struct arenaChunk *c, *del;
+	struct arenaChunk *keep = NULL;
+
+	/* we keep one regular chunk, so that the next round of allocations
+	 * does not need to go to malloc() again.
+	 */
+	for(c = a->chunks ; c != NULL ; ) {
+		del = c;
+		c = c->next;
+		if(keep == NULL && del->size == a->chunkSize) {
+			keep = del;
+		} else {
+			free(del);
+		}
+	}
+	if(keep != NULL) {
+		keep->next = NULL;
+		keep->used = CHUNK_HDR_SIZE;
+	}
+	a->chunks = keep;
+}
+
+
+/* Allocate a block of size bytes (a multiple of 8) from the arena. */
+static es_strhdr_t *
+arenaAlloc(es_arena_t *a, size_t size)
+{
+	struct arenaChunk *c;
+	es_strhdr_t *h = NULL;
+	size_t chunkSize;
+
+	c = a->chunks;
+	if(c == NULL || c->size - c->used < size) {
+		/* large blocks get a dedicated chunk, which we put behind the
+		 * current one, so that its free space can still be used.
+		 */
+		chunkSize = a->chunkSize;
+		if(size > (a->chunkSize - CHUNK_HDR_SIZE) / 2)
+			chunkSize = CHUNK_HDR_SIZE + size;
+		if(chunkSize < size) /* overflow? */
+			goto done;
+		if((c = malloc(chunkSize)) == NULL)
+			goto done;
+		c->arena = a;
+		c->size = chunkSize;
+		c->used = CHUNK_HDR_SIZE;
+		if(chunkSize != a->chunkSize && a->chunks != NULL) {
+			c->next = a->chunks->next;
+			a->chunks->next = c;
+		} else {
+			c->next = a->chunks;
+			a->chunks = c;
+		}
+	}
+
+	h = (es_strhdr_t*) (((char*) c) + c->used);
+	h->flags = ES_STRF_ARENA;
+	h->u.arenaOffs = c->used;
+	c->used += size;
+
+done:
+	return h;
+}
+
+
+es_str_t *
+es_newStrInArena(es_arena_t *a, es_size_t lenhint)
+{
+	es_str_t *s = NULL;
+	es_strhdr_t *h;
+	es_size_t lenBuf;
+
+	/* round just like es_newStr(); we rely on lenBuf being a multiple of 8 */
+	lenBuf = es_int_roundSize(a->bHavePolicy ? &a->policy : &es_int_growthPolicy, lenhint);
+	if(lenBuf == 0 && lenhint != 0)
+		goto done;
+	lenhint = lenBuf;
+
+	if((h = arenaAlloc(a, allocSize(lenhint))) == NULL)
+		goto done;
+	s = es_int_strFromHdr(h);
+	s->lenBuf = lenhint;
+	s->lenStr = 0;
+
+done:
+	return s;
+}
+
+
+es_str_t *
+es_newStrFromBufInArena(es_arena_t *a, const char *buf, es_size_t len)
+{
+	es_str_t *s;
+
+	if((s = es_newStrInArena(a, len)) == NULL)
+		goto done;
+	memcpy(es_getBufAddr(s), buf, len);
+	s->lenStr = len;
+
+done:
+	return s;
+}
+
+
+int
+es_arenaSetGrowthPolicy(es_arena_t *a, const es_growthPolicy_t *p)
+{
+	if(p == NULL) {
+		a->bHavePolicy = 0;
+		return 0;
+	}
+	if(p->factor < 100 || p->factor > 1000)
+		return EINVAL;
+	a->policy = *p;
+	a->bHavePolicy = 1;
+	return 0;
+}
+
+
+const es_growthPolicy_t *
+es_int_arenaPolicy(es_str_t *s)
+{
+	es_arena_t *a = chunkOf(es_int_hdr(s))->arena;
+
+	return a->bHavePolicy ? &a->policy : NULL;
+}
+
+
+int
+es_int_arenaResize(es_str_t **ps, es_size_t newSize)
+{
+	int r = 0;
+	es_str_t *s = *ps;
+	es_str_t *n;
+	es_strhdr_t *h = es_int_hdr(s);
+	struct arenaChunk *c = chunkOf(h);
+	size_t oldAlloc, newAlloc;
+
+	if(newSize > (es_size_t)-8) {
+		r = ENOMEM;
+		goto done;
+	}
+	if(newSize & 0x07)
+		newSize = newSize - (newSize & 0x07) + 8;
+	oldAlloc = allocSize(s->lenBuf);
+	newAlloc = allocSize(newSize);
+
+	/* if we are the chunk's last allocation, we can resize in place */
+	if(h->u.arenaOffs + oldAlloc == c->used
+	   && (newAlloc <= oldAlloc || newAlloc - oldAlloc <= c->size - c->used)) {
+		c->used = c->used - oldAlloc + newAlloc;
+		s->lenBuf = newSize;
+		goto done;
+	}
+	if(newAlloc <= oldAlloc)
+		goto done; /* space inside the chunk can not be given back */
+
+	if((h = arenaAlloc(c->arena, newAlloc)) == NULL) {
+		r = ENOMEM;
+		goto done;
+	}
+	n = es_int_strFromHdr(h);
+	n->lenBuf = newSize;
+	n->lenStr = s->lenStr;
+	memcpy(es_getBufAddr(n), es_getBufAddr(s), s->lenStr);
+	*ps = n;
+
+done:
+	return r;
+}
+
+
+void
+es_int_arenaFree(es_str_t *s)
+{
+	es_strhdr_t *h = es_int_hdr(s);
+	struct arenaChunk *c = chunkOf(h);
+
+	if(h->u.arenaOffs + allocSize(s->lenBuf) == c->used)
+		c->used = h->u.arenaOffs;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file case.c
+ * Implements ASCII case conversion.
+ *
+ * Only the ASCII letters are converted, all other bytes are copied
+ * unchanged, so the result does not depend on the locale. This permits
+ * to convert 16 (SSE2) or 32 (AVX2) bytes per step. The same kernels do
+ * in-place and out-of-place conversion.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#ifdef ES_USE_SSE2
+#	include <emmintrin.h>
+#endif
+#ifdef ES_USE_AVX2
+#	include <immintrin.h>
+#endif
+
+/* All kernels flip the 0x20 bit of bytes in first..first+25, that is
+ * 'A'..'Z' for lower case and 'a'..'z' for upper case conversion.
+ * dst may be identical to src, but the buffers must not overlap
+ * otherwise.
+ */
+
+static void
+convCase_scalar(unsigned char *dst, const unsigned char *src, size_t len, const unsigned char first)
+{
+	size_t i;
+
+	for(i = 0 ; i < len ; ++i)
+		dst[i] = ((unsigned char) (src[i] - first) < 26) ? src[i] ^ 0x20 : src[i];
+}
+
+
+#ifdef ES_USE_SSE2
+/* There is no unsigned byte compare, so the range is moved to the
+ * bottom of the signed range, where a single signed compare does.
+ */
+static void
+convCase_sse2(unsigned char *dst, const unsigned char *src, size_t len, const unsigned char first)
+{
+	const __m128i shift = _mm_set1_epi8((char) (0x80 - first));
+	const __m128i limit = _mm_set1_epi8((char) (-128 + 26));
+	const __m128i flip = _mm_set1_epi8(0x20);
+	__m128i blk, inRange;
+	size_t i;
+
+	for(i = 0 ; i + 16 <= len ; i += 16) {
+		blk = _mm_loadu_si128((const __m128i*) (src + i));
+		inRange = _mm_cmplt_epi8(_mm_add_epi8(blk, shift), limit);
+		blk = _mm_xor_si128(blk, _mm_and_si128(inRange, flip));
+		_mm_storeu_si128((__m128i*) (dst + i), blk);
+	}
+	convCase_scalar(dst + i, src + i, len - i, first);
+}
+#endif /* #ifdef ES_USE_SSE2 */
+
+
+#ifdef ES_USE_AVX2
+__attribute__((target("avx2")))
+static void
+convCase_avx2(unsigned char *dst, const unsigned char *src, size_t len, const unsigned char first)
+{
+	const __m256i shift = _mm256_set1_epi8((char) (0x80 - first));
+	const __m256i limit = _mm256_set1_epi8((char) (-128 + 26));
+	const __m256i flip = _mm256_set1_epi8(0x20);
+	__m256i blk, inRange;
+	size_t i;
+
+	for(i = 0 ; i + 32 <= len ; i += 32) {
+		blk = _mm256_loadu_si256((const __m256i*) (src + i));
+		inRange = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(blk, shift));
+		blk = _mm256_xor_si256(blk, _mm256_and_si256(inRange, flip));
+		_mm256_storeu_si256((__m256i*) (dst + i), blk);
+	}
+	convCase_sse2(dst + i, src + i, len - i, first);
+}
+#endif /* #ifdef ES_USE_AVX2 */
+
+
+static void
+convCase(unsigned char *dst, const unsigned char *src, size_t len, const unsigned char first)
+{
+#	if defined(ES_USE_AVX2)
+	if(es_int_haveAVX2())
+		convCase_avx2(dst, src, len, first);
+	else
+		convCase_sse2(dst, src, len, first);
+#	elif defined(ES_USE_SSE2)
+	convCase_sse2(dst, src, len, first);
+#	else
+	convCase_scalar(dst, src, len, first);
+#	endif
+}
+
+
+static int
+addConvCase(es_str_t **ps, const char *buf, es_size_t lenBuf, const unsigned char first)
+{
+	int r;
+	es_str_t *s;
+
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
+	if((r = es_int_reserve(ps, lenBuf)) != 0)
+		goto done;
+	s = *ps;
+	convCase(es_getBufAddr(s) + s->lenStr, (const unsigned char*) buf, lenBuf, first);
+	s->lenStr += lenBuf;
+	ES_INVALIDATE_HASH(s);
+
+done:
+	return r;
+}
+
+
+void
+es_tolower(es_str_t *s)
+{
+	ES_REQUIRE_EXCLUSIVE(s);
+	convCase(es_getBufAddr(s), es_getBufAddr(s), s->lenStr, 'A');
+	ES_INVALIDATE_HASH(s);
+}
+
+
+void
+es_toupper(es_str_t *s)
+{
+	ES_REQUIRE_EXCLUSIVE(s);
+	convCase(es_getBufAddr(s), es_getBufAddr(s), s->lenStr, 'a');
+	ES_INVALIDATE_HASH(s);
+}
+
+
+int
+es_tolowerCOW(es_str_t **ps)
+{
+	int r;
+
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
+	es_tolower(*ps);
+
+done:
+	return r;
+}
+
+
+int
+es_toupperCOW(es_str_t **ps)
+{
+	int r;
+
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
+	es_toupper(*ps);
+
+done:
+	return r;
+}
+
+
+int
+es_addLower(es_str_t **ps, const char *buf, es_size_t lenBuf)
+{
+	return addConvCase(ps, buf, lenBuf, 'A');
+}
+
+
+int
+es_addUpper(es_str_t **ps, const char *buf, es_size_t lenBuf)
+{
+	return addConvCase(ps, buf, lenBuf, 'a');
+}
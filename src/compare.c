@@ -0,0 +1,104 @@
+/**
+ * @file compare.c
+ * Implements the kernels behind the string comparison functions.
+ *
+ * Comparisons only need to know where two buffers differ first, the
+ * ordering is then derived from the bytes at that position. Equal
+ * prefixes are skipped 16 (SSE2) or 8 (word-at-a-time) bytes per step.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#ifdef ES_USE_SSE2
+#	include <emmintrin.h>
+#endif
+
+#ifdef ES_USE_SSE2
+/* lower case 'A'..'Z' in a block, see case.c for how this works */
+static inline __m128i
+foldBlock(const __m128i blk)
+{
+	const __m128i shift = _mm_set1_epi8((char) (0x80 - 'A'));
+	const __m128i limit = _mm_set1_epi8((char) (-128 + 26));
+	const __m128i flip = _mm_set1_epi8(0x20);
+
+	return _mm_xor_si128(blk,
+		_mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(blk, shift), limit), flip));
+}
+#endif /* #ifdef ES_USE_SSE2 */
+
+
+size_t
+es_int_mismatch(const unsigned char *a, const unsigned char *b, size_t len)
+{
+	size_t i = 0;
+
+#	ifdef ES_USE_SSE2
+	for( ; i + 16 <= len ; i += 16) {
+		const unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+			_mm_loadu_si128((const __m128i*) (a + i)),
+			_mm_loadu_si128((const __m128i*) (b + i))));
+		if(mask != 0xffff)
+			return i + __builtin_ctz(~mask);
+	}
+#	endif
+#	ifdef ES_USE_SWAR
+	for( ; i + 8 <= len ; i += 8) {
+		unsigned long long wa, wb;
+		memcpy(&wa, a + i, sizeof(wa));
+		memcpy(&wb, b + i, sizeof(wb));
+		if(wa != wb) /* little endian: first byte is lowest */
+			return i + (__builtin_ctzll(wa ^ wb) >> 3);
+	}
+#	endif
+	for( ; i < len ; ++i)
+		if(a[i] != b[i])
+			break;
+	return i;
+}
+
+
+size_t
+es_int_caseMismatch(const unsigned char *a, const unsigned char *b, size_t len)
+{
+	size_t i = 0;
+
+#	ifdef ES_USE_SSE2
+	for( ; i + 16 <= len ; i += 16) {
+		const unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+			foldBlock(_mm_loadu_si128((const __m128i*) (a + i))),
+			foldBlock(_mm_loadu_si128((const __m128i*) (b + i)))));
+		if(mask != 0xffff)
+			return i + __builtin_ctz(~mask);
+	}
+#	endif
+	for( ; i < len ; ++i)
+		if(es_int_asciiLower[a[i]] != es_int_asciiLower[b[i]])
+			break;
+	return i;
+}
@@ -0,0 +1,405 @@
+/**
+ * @file glob.c
+ * Implements compiled shell-style wildcard patterns.
+ *
+ * A pattern is split at its stars into segments of fixed length. The
+ * first segment must match at the start of the subject (unless the
+ * pattern begins with a star) and the last one at the end (unless it
+ * ends with a star). All other segments are searched for from left to
+ * right, each after the end of the previous match. Taking the leftmost
+ * match is always right, as the following star can absorb everything
+ * in between. So there is no backtracking and matching is linear in
+ * the subject length: segments without wildcards are searched with a
+ * precompiled needle, segments with wildcards (up to 64 positions) with
+ * the bit-parallel Shift-And algorithm.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#define SHIFTAND_MAX 64
+
+/* a set of bytes, one bit per byte value */
+typedef unsigned char byteset_t[32];
+
+#define BYTESET_SET(bs, c) ((bs)[(c) >> 3] |= 1 << ((c) & 7))
+#define BYTESET_CLR(bs, c) ((bs)[(c) >> 3] &= ~(1 << ((c) & 7)))
+#define BYTESET_HAS(bs, c) ((bs)[(c) >> 3] & (1 << ((c) & 7)))
+
+/* ASCII lower case, as fnmatch() with FNM_CASEFOLD uses in the C locale */
+#define FOLD(c) (((unsigned) (c) - 'A' < 26) ? (c) + 0x20 : (c))
+
+struct globSeg {
+	es_size_t len;		/**< number of positions */
+	unsigned char *lit;	/**< bytes, if the segment has no wildcards */
+	byteset_t *cls;		/**< allowed bytes per position, otherwise */
+	es_needle_t *needle;	/**< for searching a literal segment */
+	unsigned long long *masks; /**< Shift-And table for searching a
+				     segment with wildcards */
+};
+
+struct es_glob_s {
+	int bCaseInsensitive;
+	int bHaveStar;
+	int bAnchorStart;	/**< first segment must match at the start */
+	int bAnchorEnd;		/**< last segment must match at the end */
+	int nSegs;
+	struct globSeg *segs;
+	es_size_t minLen;	/**< sum of segment lengths */
+};
+
+
+/* Turn a set of folded bytes into the set of subject bytes that match
+ * case-insensitively: a subject byte matches if its folded value is in
+ * the set. Upper case letters in the set itself (e.g. from the range
+ * "?-[") can never equal a folded byte.
+ */
+static void
+foldByteset(byteset_t bs)
+{
+	int c;
+
+	for(c = 'A' ; c <= 'Z' ; ++c) {
+		if(BYTESET_HAS(bs, c + 0x20))
+			BYTESET_SET(bs, c);
+		else
+			BYTESET_CLR(bs, c);
+	}
+}
+
+
+/* Parse a character class starting after the '['. Returns the number
+ * of pattern bytes consumed, or 0 if the class is not terminated (the
+ * '[' is then a literal). Case-insensitive sets must be folded before
+ * they are negated. Like fnmatch() with FNM_CASEFOLD, a case-insensitive
+ * class contains the folded bytes and the folded range ends, that is
+ * "[A-a]" is "[a-a]" and "[?-[]" contains no letters at all.
+ */
+static es_size_t
+parseClass(const unsigned char *pat, es_size_t len, byteset_t bs, int bCaseInsensitive)
+{
+	es_size_t i = 0;
+	int bNegate = 0;
+	int c, last, k;
+
+	memset(bs, 0, sizeof(byteset_t));
+	if(i < len && (pat[i] == '!' || pat[i] == '^')) {
+		bNegate = 1;
+		++i;
+	}
+	for(k = 0 ; i < len ; ++k) {
+		if(pat[i] == ']' && k > 0)
+			break;
+		if(pat[i] == '\\' && i + 1 < len)
+			++i;
+		c = pat[i++];
+		if(bCaseInsensitive)
+			c = FOLD(c);
+		if(i + 1 < len && pat[i] == '-' && pat[i + 1] != ']') {
+			++i;
+			if(pat[i] == '\\' && i + 1 < len)
+				++i;
+			last = pat[i++];
+			if(bCaseInsensitive)
+				last = FOLD(last);
+			for( ; c <= last ; ++c)
+				BYTESET_SET(bs, c);
+		} else {
+			BYTESET_SET(bs, c);
+		}
+	}
+	if(i == len)
+		return 0;
+	if(bCaseInsensitive)
+		foldByteset(bs);
+	if(bNegate)
+		for(k = 0 ; k < 32 ; ++k)
+			bs[k] = ~bs[k];
+	return i + 1;
+}
+
+
+/* add a segment from the parsed positions; bLiteral[j] tells if
+ * position j is a plain byte (lit[j]) or a class (cls[j])
+ */
+static int
+addSeg(es_glob_t *g, const unsigned char *lit, const byteset_t *cls,
+       const char *bLiteral, es_size_t len)
+{
+	struct globSeg *seg;
+	es_size_t j;
+	int bAllLiteral = 1;
+
+	if(len == 0)
+		return 0;
+	seg = &g->segs[g->nSegs++];
+	seg->len = len;
+	g->minLen += len;
+	for(j = 0 ; j < len ; ++j)
+		if(!bLiteral[j])
+			bAllLiteral = 0;
+
+	if(bAllLiteral) {
+		if((seg->lit = malloc(len)) == NULL)
+			return -1;
+		memcpy(seg->lit, lit, len);
+		return 0;
+	}
+
+	/* literal positions of the segment are checked via byte sets, too */
+	if((seg->cls = malloc(len * sizeof(byteset_t))) == NULL)
+		return -1;
+	for(j = 0 ; j < len ; ++j) {
+		if(bLiteral[j]) {
+			memset(seg->cls[j], 0, sizeof(byteset_t));
+			if(g->bCaseInsensitive) {
+				BYTESET_SET(seg->cls[j], FOLD(lit[j]));
+				foldByteset(seg->cls[j]);
+			} else {
+				BYTESET_SET(seg->cls[j], lit[j]);
+			}
+		} else {
+			memcpy(seg->cls[j], cls[j], sizeof(byteset_t));
+		}
+	}
+	return 0;
+}
+
+
+/* prepare searching for a segment that is not anchored */
+static int
+compileSearch(es_glob_t *g, struct globSeg *seg)
+{
+	es_size_t j;
+	int c;
+
+	if(seg->lit != NULL) {
+		seg->needle = es_newNeedleFromBuf(seg->lit, seg->len, g->bCaseInsensitive);
+		return (seg->needle == NULL) ? -1 : 0;
+	}
+	if(seg->len > SHIFTAND_MAX)
+		return 0; /* searched position by position */
+	if((seg->masks = calloc(256, sizeof(unsigned long long))) == NULL)
+		return -1;
+	for(j = 0 ; j < seg->len ; ++j)
+		for(c = 0 ; c < 256 ; ++c)
+			if(BYTESET_HAS(seg->cls[j], c))
+				seg->masks[c] |= 1ULL << j;
+	return 0;
+}
+
+
+es_glob_t *
+es_newGlobFromBuf(const unsigned char *pat, es_size_t len, int bCaseInsensitive)
+{
+	es_glob_t *g = NULL;
+	unsigned char *lit = NULL;
+	byteset_t *cls = NULL;
+	char *bLiteral = NULL;
+	es_size_t i, n, nPos;
+	int j;
+	int r = -1;
+
+	if((g = calloc(1, sizeof(es_glob_t))) == NULL)
+		goto done;
+	g->bCaseInsensitive = bCaseInsensitive;
+	/* there can not be more segments or positions than pattern bytes */
+	if((g->segs = calloc(len / 2 + 1, sizeof(struct globSeg))) == NULL
+	   || (lit = malloc(len + 1)) == NULL
+	   || (cls = malloc((len + 1) * sizeof(byteset_t))) == NULL
+	   || (bLiteral = malloc(len + 1)) == NULL)
+		goto done;
+
+	g->bAnchorStart = 1;
+	g->bAnchorEnd = 1;
+	nPos = 0;
+	for(i = 0 ; i < len ; ) {
+		g->bAnchorEnd = 1;
+		if(pat[i] == '*') {
+			if(i == 0)
+				g->bAnchorStart = 0;
+			g->bHaveStar = 1;
+			g->bAnchorEnd = 0;
+			if(addSeg(g, lit, cls, bLiteral, nPos) != 0)
+				goto done;
+			nPos = 0;
+			++i;
+		} else if(pat[i] == '?') {
+			memset(cls[nPos], 0xff, sizeof(byteset_t));
+			bLiteral[nPos++] = 0;
+			++i;
+		} else if(pat[i] == '['
+			  && (n = parseClass(pat + i + 1, len - i - 1, cls[nPos], bCaseInsensitive)) != 0) {
+			bLiteral[nPos++] = 0;
+			i += n + 1;
+		} else {
+			if(pat[i] == '\\' && i + 1 < len)
+				++i;
+			lit[nPos] = pat[i++];
+			bLiteral[nPos++] = 1;
+		}
+	}
+	if(addSeg(g, lit, cls, bLiteral, nPos) != 0)
+		goto done;
+
+	for(j = 0 ; j < g->nSegs ; ++j) {
+		if((j == 0 && g->bAnchorStart) || (j == g->nSegs - 1 && g->bAnchorEnd))
+			continue;
+		if(compileSearch(g, &g->segs[j]) != 0)
+			goto done;
+	}
+	r = 0;
+
+done:
+	free(lit);
+	free(cls);
+	free(bLiteral);
+	if(r != 0) {
+		es_deleteGlob(g);
+		g = NULL;
+	}
+	return g;
+}
+
+
+es_glob_t *
+es_newGlob(es_str_t *pattern, int bCaseInsensitive)
+{
+	return es_newGlobFromBuf(es_getBufAddr(pattern), es_strlen(pattern), bCaseInsensitive);
+}
+
+
+void
+es_deleteGlob(es_glob_t *g)
+{
+	int j;
+
+	if(g == NULL)
+		return;
+	if(g->segs != NULL) {
+		for(j = 0 ; j < g->nSegs ; ++j) {
+			free(g->segs[j].lit);
+			free(g->segs[j].cls);
+			free(g->segs[j].masks);
+			if(g->segs[j].needle != NULL)
+				es_deleteNeedle(g->segs[j].needle);
+		}
+		free(g->segs);
+	}
+	free(g);
+}
+
+
+/* check if a segment matches at p (which has at least seg->len bytes) */
+static inline int
+matchAt(const es_glob_t *g, const struct globSeg *seg, const unsigned char *p)
+{
+	es_size_t j;
+
+	if(seg->lit != NULL) {
+		if(g->bCaseInsensitive)
+			return es_int_caseMismatch(p, seg->lit, seg->len) == seg->len;
+		return memcmp(p, seg->lit, seg->len) == 0;
+	}
+	for(j = 0 ; j < seg->len ; ++j)
+		if(!BYTESET_HAS(seg->cls[j], p[j]))
+			return 0;
+	return 1;
+}
+
+
+/* offset of the leftmost match of a segment inside buf, -1 if none */
+static long long
+findSeg(const es_glob_t *g, const struct globSeg *seg, const unsigned char *buf, es_size_t len)
+{
+	unsigned long long d, hit;
+	es_size_t i;
+
+	if(seg->len > len)
+		return -1;
+	if(seg->needle != NULL)
+		return es_bufContainsNeedle(buf, len, seg->needle);
+	if(seg->masks != NULL) {
+		hit = 1ULL << (seg->len - 1);
+		for(d = 0, i = 0 ; i < len ; ++i) {
+			d = ((d << 1) | 1) & seg->masks[buf[i]];
+			if(d & hit)
+				return (long long) i + 1 - seg->len;
+		}
+		return -1;
+	}
+	for(i = 0 ; i + seg->len <= len ; ++i)
+		if(matchAt(g, seg, buf + i))
+			return i;
+	return -1;
+}
+
+
+int
+es_globMatchBuf(es_glob_t *g, const unsigned char *buf, es_size_t len)
+{
+	const struct globSeg *seg;
+	es_size_t pos = 0;
+	es_size_t end = len;
+	long long offs;
+	int first = 0;
+	int last = g->nSegs;
+	int i;
+
+	if(len < g->minLen)
+		return 0;
+	if(!g->bHaveStar)
+		return len == g->minLen && (g->nSegs == 0 || matchAt(g, &g->segs[0], buf));
+
+	if(g->bAnchorStart) {
+		if(!matchAt(g, &g->segs[0], buf))
+			return 0;
+		pos = g->segs[0].len;
+		first = 1;
+	}
+	if(g->bAnchorEnd && last > first) {
+		seg = &g->segs[last - 1];
+		end = len - seg->len;
+		if(end < pos || !matchAt(g, seg, buf + end))
+			return 0;
+		--last;
+	}
+	for(i = first ; i < last ; ++i) {
+		seg = &g->segs[i];
+		if((offs = findSeg(g, seg, buf + pos, end - pos)) < 0)
+			return 0;
+		pos += (es_size_t) offs + seg->len;
+	}
+	return 1;
+}
+
+
+int
+es_globMatch(es_glob_t *g, es_str_t *s)
+{
+	return es_globMatchBuf(g, es_getBufAddr(s), es_strlen(s));
+}
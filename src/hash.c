@@ -0,0 +1,164 @@
+/**
+ * @file hash.c
+ * Implements string hashing.
+ *
+ * The hash function is XXH64 by Yann Collet. It processes 32 bytes per
+ * round in four independent 64-bit lanes, so modern CPUs can execute
+ * the lanes in parallel. It has excellent distribution and is much
+ * faster than the classic byte-at-a-time hashes.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#define PRIME1 11400714785074694791ULL
+#define PRIME2 14029467366897019727ULL
+#define PRIME3  1609587929392839161ULL
+#define PRIME4  9650029242287828579ULL
+#define PRIME5  2870177450012600261ULL
+
+#define ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/* unaligned loads; memcpy() is turned into a single move by the compiler */
+static inline unsigned long long
+read64(const unsigned char *p)
+{
+	unsigned long long v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline unsigned long long
+read32(const unsigned char *p)
+{
+	unsigned int v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline unsigned long long
+round64(unsigned long long acc, unsigned long long input)
+{
+	acc += input * PRIME2;
+	acc = ROTL(acc, 31);
+	return acc * PRIME1;
+}
+
+static inline unsigned long long
+mergeRound(unsigned long long acc, unsigned long long val)
+{
+	acc ^= round64(0, val);
+	return acc * PRIME1 + PRIME4;
+}
+
+
+unsigned long long
+es_hashBuf(const unsigned char *buf, es_size_t len, unsigned long long seed)
+{
+	const unsigned char *p = buf;
+	const unsigned char *const end = buf + len;
+	unsigned long long h;
+	unsigned long long v1, v2, v3, v4;
+
+	if(len >= 32) {
+		v1 = seed + PRIME1 + PRIME2;
+		v2 = seed + PRIME2;
+		v3 = seed;
+		v4 = seed - PRIME1;
+		do {
+			v1 = round64(v1, read64(p));
+			v2 = round64(v2, read64(p + 8));
+			v3 = round64(v3, read64(p + 16));
+			v4 = round64(v4, read64(p + 24));
+			p += 32;
+		} while(end - p >= 32);
+		h = ROTL(v1, 1) + ROTL(v2, 7) + ROTL(v3, 12) + ROTL(v4, 18);
+		h = mergeRound(h, v1);
+		h = mergeRound(h, v2);
+		h = mergeRound(h, v3);
+		h = mergeRound(h, v4);
+	} else {
+		h = seed + PRIME5;
+	}
+	h += (unsigned long long) len;
+
+	while(end - p >= 8) {
+		h ^= round64(0, read64(p));
+		h = ROTL(h, 27) * PRIME1 + PRIME4;
+		p += 8;
+	}
+	if(end - p >= 4) {
+		h ^= read32(p) * PRIME1;
+		h = ROTL(h, 23) * PRIME2 + PRIME3;
+		p += 4;
+	}
+	while(p < end) {
+		h ^= (*p) * PRIME5;
+		h = ROTL(h, 11) * PRIME1;
+		++p;
+	}
+
+	/* final avalanche */
+	h ^= h >> 33;
+	h *= PRIME2;
+	h ^= h >> 29;
+	h *= PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+
+unsigned long long
+es_strhash(es_str_t *s, unsigned long long seed)
+{
+#	ifdef ENABLE_HASH_CACHE
+	es_strhdr_t *h = es_int_hdr(s);
+	unsigned long long hash;
+
+	if((h->flags & ES_STRF_HASHED) && h->hashSeed == seed)
+		return h->hash;
+	hash = es_hashBuf(es_getBufAddr(s), es_strlen(s), seed);
+	/* shared strings may be read by other threads at the same time,
+	 * so we only cache for strings we exclusively own.
+	 */
+	if(!(h->flags & ES_STRF_SHARED)) {
+		h->hash = hash;
+		h->hashSeed = seed;
+		h->flags |= ES_STRF_HASHED;
+	}
+	return hash;
+#	else
+	return es_hashBuf(es_getBufAddr(s), es_strlen(s), seed);
+#	endif
+}
+
+
+void
+es_strInvalidateHash(es_str_t *s)
+{
+	ES_INVALIDATE_HASH(s);
+}
@@ -0,0 +1,285 @@
+/**
+ * @file intern.c
+ * Implements string interning.
+ *
+ * The intern table is a chained hash table. Lookups do not take any
+ * lock: nodes are fully initialized before they are published with a
+ * memory barrier and they are never modified or removed afterwards.
+ * Inserts are serialized by a mutex. When the table grows, a new bucket
+ * array (with new nodes) is built and published; the old one is kept
+ * until the table is deleted, because concurrent readers may still be
+ * traversing it.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+/* Without atomic builtins, we can not safely publish nodes to lock-free
+ * readers, so lookups need to take the mutex as well.
+ */
+#if defined(HAVE_PTHREAD_H) && !defined(HAVE_ATOMIC_BUILTINS)
+#	define LOCKED_LOOKUP
+#endif
+
+struct internNode {
+	struct internNode *next;
+	unsigned long long hash;
+	es_str_t *str;
+};
+
+struct internBuckets {
+	es_size_t nBuckets;		/**< always a power of 2 */
+	struct internBuckets *retired;	/**< previous (smaller) bucket arrays */
+	struct internNode * volatile *bucket;
+};
+
+struct es_internTable_s {
+	struct internBuckets * volatile curr;
+	es_size_t nEntries;
+#	ifdef HAVE_PTHREAD_H
+	pthread_mutex_t mut;
+#	endif
+};
+
+
+static struct internBuckets *
+newBuckets(es_size_t nBuckets)
+{
+	struct internBuckets *b;
+
+	if((b = malloc(sizeof(struct internBuckets))) == NULL)
+		goto done;
+	b->nBuckets = nBuckets;
+	b->retired = NULL;
+	if((b->bucket = calloc(nBuckets, sizeof(struct internNode*))) == NULL) {
+		free(b);
+		b = NULL;
+	}
+
+done:
+	return b;
+}
+
+
+/* free a bucket array and its nodes, but not the strings */
+static void
+freeBuckets(struct internBuckets *b)
+{
+	struct internNode *n, *del;
+	es_size_t i;
+
+	for(i = 0 ; i < b->nBuckets ; ++i) {
+		for(n = b->bucket[i] ; n != NULL ; ) {
+			del = n;
+			n = n->next;
+			free(del);
+		}
+	}
+	free((void*) b->bucket);
+	free(b);
+}
+
+
+es_internTable_t *
+es_newInternTable(es_size_t sizeHint)
+{
+	es_internTable_t *t;
+	es_size_t nBuckets;
+
+	if((t = malloc(sizeof(es_internTable_t))) == NULL)
+		goto done;
+	for(nBuckets = 64 ; nBuckets < sizeHint && nBuckets < (1u << 30) ; nBuckets *= 2)
+		/* just compute */;
+	if((t->curr = newBuckets(nBuckets)) == NULL) {
+		free(t);
+		t = NULL;
+		goto done;
+	}
+	t->nEntries = 0;
+#	ifdef HAVE_PTHREAD_H
+	pthread_mutex_init(&t->mut, NULL);
+#	endif
+
+done:
+	return t;
+}
+
+
+void
+es_deleteInternTable(es_internTable_t *t)
+{
+	struct internBuckets *b, *del;
+	struct internNode *n;
+	es_size_t i;
+
+	if(t == NULL)
+		return;
+	/* the current bucket array references each string exactly once */
+	b = t->curr;
+	for(i = 0 ; i < b->nBuckets ; ++i) {
+		for(n = b->bucket[i] ; n != NULL ; n = n->next) {
+			es_int_hdr(n->str)->flags &= ~(ES_STRF_INTERNED | ES_STRF_SHARED);
+			es_deleteStr(n->str);
+		}
+	}
+	for(b = t->curr ; b != NULL ; ) {
+		del = b;
+		b = b->retired;
+		freeBuckets(del);
+	}
+#	ifdef HAVE_PTHREAD_H
+	pthread_mutex_destroy(&t->mut);
+#	endif
+	free(t);
+}
+
+
+static inline es_str_t *
+lookup(struct internBuckets *b, unsigned long long hash,
+	const unsigned char *buf, es_size_t len)
+{
+	struct internNode *n;
+
+	for(n = b->bucket[hash & (b->nBuckets - 1)] ; n != NULL ; n = n->next) {
+		if(n->hash == hash && es_strlen(n->str) == len
+		   && memcmp(es_getBufAddr(n->str), buf, len) == 0)
+			return n->str;
+	}
+	return NULL;
+}
+
+
+/* Double the number of buckets. Must be called with the mutex held.
+ * On error, we simply keep the current size; that only costs speed.
+ */
+static void
+grow(es_internTable_t *t)
+{
+	struct internBuckets *old = t->curr;
+	struct internBuckets *b;
+	struct internNode *n, *nn;
+	es_size_t i, idx;
+
+	if(old->nBuckets >= (1u << 30) || (b = newBuckets(2 * old->nBuckets)) == NULL)
+		return;
+	for(i = 0 ; i < old->nBuckets ; ++i) {
+		for(n = old->bucket[i] ; n != NULL ; n = n->next) {
+			if((nn = malloc(sizeof(struct internNode))) == NULL) {
+				freeBuckets(b);
+				return;
+			}
+			*nn = *n;
+			idx = nn->hash & (b->nBuckets - 1);
+			nn->next = b->bucket[idx];
+			b->bucket[idx] = nn;
+		}
+	}
+	b->retired = old;
+	ES_MEMBAR();
+	t->curr = b;
+}
+
+
+static es_str_t *
+internHashed(es_internTable_t *t, const unsigned char *buf, es_size_t len,
+	unsigned long long hash)
+{
+	struct internBuckets *b;
+	struct internNode *n;
+	es_str_t *s;
+	es_size_t idx;
+
+#	ifndef LOCKED_LOOKUP
+	/* fast path: no lock required */
+	if((s = lookup(t->curr, hash, buf, len)) != NULL)
+		return s;
+#	endif
+
+#	ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&t->mut);
+#	endif
+	/* someone else may have inserted it in the meantime */
+	b = t->curr;
+	if((s = lookup(b, hash, buf, len)) != NULL)
+		goto done;
+
+	if((n = malloc(sizeof(struct internNode))) == NULL)
+		goto done;
+	if((s = es_newStr(len)) == NULL) {
+		free(n);
+		goto done;
+	}
+	memcpy(es_getBufAddr(s), buf, len);
+	s->lenStr = len;
+	/* interned strings are permanently shared, so they are never
+	 * modified (only copied) and never freed by es_deleteStr().
+	 */
+	es_int_hdr(s)->flags |= ES_STRF_SHARED | ES_STRF_INTERNED;
+	es_int_hdr(s)->u.refcnt = 1;
+#	ifdef ENABLE_HASH_CACHE
+	/* safe to do, as nobody else can see the string yet */
+	es_int_hdr(s)->hash = hash;
+	es_int_hdr(s)->hashSeed = 0;
+	es_int_hdr(s)->flags |= ES_STRF_HASHED;
+#	endif
+
+	n->hash = hash;
+	n->str = s;
+	idx = hash & (b->nBuckets - 1);
+	n->next = b->bucket[idx];
+	/* the node must be complete before readers can see it */
+	ES_MEMBAR();
+	b->bucket[idx] = n;
+
+	if(++t->nEntries > 2 * b->nBuckets)
+		grow(t);
+
+done:
+#	ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&t->mut);
+#	endif
+	return s;
+}
+
+
+es_str_t *
+es_internBuf(es_internTable_t *t, const unsigned char *buf, es_size_t len)
+{
+	return internHashed(t, buf, len, es_hashBuf(buf, len, 0));
+}
+
+
+es_str_t *
+es_intern(es_internTable_t *t, es_str_t *s)
+{
+	/* es_strhash() may have the hash already cached */
+	return internHashed(t, es_getBufAddr(s), es_strlen(s), es_strhash(s, 0));
+}
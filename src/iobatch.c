@@ -0,0 +1,226 @@
+/**
+ * @file iobatch.c
+ * Implements scatter/gather output batches.
+ *
+ * A batch collects references to string objects and other buffers in
+ * an iovec array and writes all of them with as few writev() calls as
+ * possible. No data is copied.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+/* IOV_MAX is not defined everywhere; 16 is the POSIX minimum */
+#ifndef IOV_MAX
+#	ifdef UIO_MAXIOV
+#		define IOV_MAX UIO_MAXIOV
+#	else
+#		define IOV_MAX 16
+#	endif
+#endif
+
+#define DEFAULT_NIOV 64
+
+struct es_iobatch_s {
+	struct iovec *iov;
+	int nIov;		/**< number of iovec entries in use */
+	int maxIov;		/**< size of iov array */
+	int first;		/**< first entry not yet (fully) written */
+	size_t len;		/**< number of bytes not yet written */
+};
+
+
+es_iobatch_t *
+es_newIOBatch(int nHint)
+{
+	es_iobatch_t *b;
+
+	if((b = calloc(1, sizeof(es_iobatch_t))) == NULL)
+		goto done;
+	b->maxIov = (nHint > 0) ? nHint : DEFAULT_NIOV;
+	if((b->iov = malloc(b->maxIov * sizeof(struct iovec))) == NULL) {
+		free(b);
+		b = NULL;
+	}
+
+done:
+	return b;
+}
+
+
+void
+es_deleteIOBatch(es_iobatch_t *b)
+{
+	if(b == NULL)
+		return;
+	free(b->iov);
+	free(b);
+}
+
+
+void
+es_resetIOBatch(es_iobatch_t *b)
+{
+	b->nIov = 0;
+	b->first = 0;
+	b->len = 0;
+}
+
+
+/* make sure there is space for n more entries */
+static int
+reserve(es_iobatch_t *b, int n)
+{
+	int r = 0;
+	int newMax;
+	struct iovec *newIov;
+
+	if(b->maxIov - b->nIov >= n)
+		goto done;
+	newMax = b->maxIov;
+	while(newMax - b->nIov < n) {
+		if(newMax > INT_MAX / 2) {
+			r = ENOMEM;
+			goto done;
+		}
+		newMax *= 2;
+	}
+	if((newIov = realloc(b->iov, newMax * sizeof(struct iovec))) == NULL) {
+		r = ENOMEM;
+		goto done;
+	}
+	b->iov = newIov;
+	b->maxIov = newMax;
+
+done:
+	return r;
+}
+
+
+int
+es_iobatchAddBuf(es_iobatch_t *b, const void *buf, es_size_t len)
+{
+	int r = 0;
+
+	if(len == 0)
+		goto done;
+	if((r = reserve(b, 1)) != 0)
+		goto done;
+	b->iov[b->nIov].iov_base = (void*) buf;
+	b->iov[b->nIov].iov_len = len;
+	++b->nIov;
+	b->len += len;
+
+done:
+	return r;
+}
+
+
+int
+es_iobatchAddStr(es_iobatch_t *b, es_str_t *s)
+{
+	return es_iobatchAddBuf(b, es_getBufAddr(s), es_strlen(s));
+}
+
+
+int
+es_iobatchAddRope(es_iobatch_t *b, es_rope_t *rope)
+{
+	int r;
+	int n;
+
+	if((r = reserve(b, es_ropeNumChunks(rope))) != 0)
+		goto done;
+	n = es_ropeIovec(rope, b->iov + b->nIov, b->maxIov - b->nIov);
+	b->nIov += n;
+	b->len += es_ropeLen(rope);
+
+done:
+	return r;
+}
+
+
+size_t
+es_iobatchLen(es_iobatch_t *b)
+{
+	return b->len;
+}
+
+
+/* skip n written bytes */
+static void
+consume(es_iobatch_t *b, size_t n)
+{
+	struct iovec *v;
+
+	b->len -= n;
+	while(n > 0) {
+		v = b->iov + b->first;
+		if(n < v->iov_len) {
+			v->iov_base = ((char*) v->iov_base) + n;
+			v->iov_len -= n;
+			break;
+		}
+		n -= v->iov_len;
+		++b->first;
+	}
+}
+
+
+int
+es_iobatchFlush(es_iobatch_t *b, int fd)
+{
+	int r = 0;
+	int cnt;
+	ssize_t n;
+
+	while(b->first < b->nIov) {
+		cnt = b->nIov - b->first;
+		if(cnt > IOV_MAX)
+			cnt = IOV_MAX;
+		n = writev(fd, b->iov + b->first, cnt);
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			r = errno;
+			goto done;
+		}
+		if(n == 0) { /* should not happen, but do not loop forever */
+			r = EIO;
+			goto done;
+		}
+		consume(b, n);
+	}
+	es_resetIOBatch(b);
+
+done:
+	return r;
+}
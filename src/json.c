@@ -0,0 +1,334 @@
+/**
+ * @file json.c
+ * Implements JSON string escaping.
+ *
+ * Bytes that need escaping are located 16 (SSE2) or 32 (AVX2) bytes at a
+ * time, and the runs between them are copied in bulk. If the input
+ * contains such bytes, a first pass with the same scan computes the
+ * exact escaped length, so the destination is grown at most once, no
+ * matter how many escapes follow. Escape-free input needs a single scan.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#ifdef ES_USE_SSE2
+#	include <emmintrin.h>
+#endif
+#ifdef ES_USE_AVX2
+#	include <immintrin.h>
+#endif
+
+static const char hexDigit[] = "0123456789abcdef";
+
+/* does c need to be looked at? If bUTF8 is set, all non-ASCII bytes
+ * do, because they need to be validated.
+ */
+static inline int
+isSpecial(const unsigned char c, const int bUTF8)
+{
+	return c < 0x20 || c == '"' || c == '\\' || (bUTF8 && c >= 0x80);
+}
+
+/* Scalar scan, also used for the tail of the vectorized versions.
+ * @returns offset of the first special byte at or after start, or len
+ */
+static size_t
+scan_scalar(const unsigned char *buf, size_t len, size_t start, const int bUTF8)
+{
+	size_t i;
+
+	for(i = start ; i < len && !isSpecial(buf[i], bUTF8) ; ++i)
+		/* just search */;
+	return i;
+}
+
+
+#ifdef ES_USE_SSE2
+static size_t
+scan_sse2(const unsigned char *buf, size_t len, size_t start, const int bUTF8)
+{
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i bslash = _mm_set1_epi8('\\');
+	const __m128i ctl = _mm_set1_epi8(0x1f);
+	__m128i blk, m;
+	unsigned mask;
+	size_t i;
+
+	for(i = start ; i + 16 <= len ; i += 16) {
+		blk = _mm_loadu_si128((const __m128i*) (buf + i));
+		/* unsigned c <= 0x1f is the same as min(c, 0x1f) == c */
+		m = _mm_or_si128(_mm_cmpeq_epi8(blk, quote), _mm_cmpeq_epi8(blk, bslash));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(blk, ctl), blk));
+		if(bUTF8)
+			m = _mm_or_si128(m, blk); /* only the high bit counts */
+		mask = _mm_movemask_epi8(m);
+		if(mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	return scan_scalar(buf, len, i, bUTF8);
+}
+#endif /* #ifdef ES_USE_SSE2 */
+
+
+#ifdef ES_USE_AVX2
+__attribute__((target("avx2")))
+static size_t
+scan_avx2(const unsigned char *buf, size_t len, size_t start, const int bUTF8)
+{
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i bslash = _mm256_set1_epi8('\\');
+	const __m256i ctl = _mm256_set1_epi8(0x1f);
+	__m256i blk, m;
+	unsigned mask;
+	size_t i;
+
+	for(i = start ; i + 32 <= len ; i += 32) {
+		blk = _mm256_loadu_si256((const __m256i*) (buf + i));
+		m = _mm256_or_si256(_mm256_cmpeq_epi8(blk, quote), _mm256_cmpeq_epi8(blk, bslash));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_min_epu8(blk, ctl), blk));
+		if(bUTF8)
+			m = _mm256_or_si256(m, blk);
+		mask = (unsigned) _mm256_movemask_epi8(m);
+		if(mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	return scan_scalar(buf, len, i, bUTF8);
+}
+#endif /* #ifdef ES_USE_AVX2 */
+
+
+static inline size_t
+scan(const unsigned char *buf, size_t len, size_t start, const int bUTF8)
+{
+#	if defined(ES_USE_AVX2)
+	if(es_int_haveAVX2())
+		return scan_avx2(buf, len, start, bUTF8);
+	return scan_sse2(buf, len, start, bUTF8);
+#	elif defined(ES_USE_SSE2)
+	return scan_sse2(buf, len, start, bUTF8);
+#	else
+	return scan_scalar(buf, len, start, bUTF8);
+#	endif
+}
+
+
+/* Check for a valid UTF-8 sequence at p, which starts with a non-ASCII
+ * byte. Overlong encodings, surrogates and values above U+10FFFF are
+ * invalid.
+ * @returns length of the sequence, 0 if invalid
+ */
+static inline size_t
+utf8SeqLen(const unsigned char *p, size_t len)
+{
+	const unsigned char c = p[0];
+	unsigned char lo = 0x80, hi = 0xbf;
+	size_t n, i;
+
+	if(c >= 0xc2 && c <= 0xdf) {
+		n = 2;
+	} else if(c >= 0xe0 && c <= 0xef) {
+		n = 3;
+		if(c == 0xe0)
+			lo = 0xa0;
+		else if(c == 0xed)
+			hi = 0x9f;
+	} else if(c >= 0xf0 && c <= 0xf4) {
+		n = 4;
+		if(c == 0xf0)
+			lo = 0x90;
+		else if(c == 0xf4)
+			hi = 0x8f;
+	} else {
+		return 0;
+	}
+	if(n > len || p[1] < lo || p[1] > hi)
+		return 0;
+	for(i = 2 ; i < n ; ++i)
+		if((p[i] & 0xc0) != 0x80)
+			return 0;
+	return n;
+}
+
+
+/* Length of the escape sequence for a special byte c that is not part
+ * of a valid UTF-8 sequence.
+ */
+static inline es_size_t
+escLen(const unsigned char c)
+{
+	switch(c) {
+	case '"':
+	case '\\':
+	case '\b':
+	case '\f':
+	case '\n':
+	case '\r':
+	case '\t':
+		return 2;
+	default:
+		return 6;
+	}
+}
+
+
+/* Write the escape sequence for c to out, which must have room for
+ * escLen(c) bytes.
+ * @returns number of bytes written
+ */
+static inline es_size_t
+writeEsc(unsigned char *out, const unsigned char c)
+{
+	out[0] = '\\';
+	switch(c) {
+	case '"':
+	case '\\':
+		out[1] = c;
+		return 2;
+	case '\b':
+		out[1] = 'b';
+		return 2;
+	case '\f':
+		out[1] = 'f';
+		return 2;
+	case '\n':
+		out[1] = 'n';
+		return 2;
+	case '\r':
+		out[1] = 'r';
+		return 2;
+	case '\t':
+		out[1] = 't';
+		return 2;
+	default:
+		if(c >= 0x80) {
+			/* invalid UTF-8, use the replacement character */
+			memcpy(out + 1, "ufffd", 5);
+		} else {
+			memcpy(out + 1, "u00", 3);
+			out[4] = hexDigit[c >> 4];
+			out[5] = hexDigit[c & 0x0f];
+		}
+		return 6;
+	}
+}
+
+
+/* First pass: compute the exact escaped length of buf, starting at the
+ * special byte at offset first. Uses the same scan as the second pass,
+ * so the clean runs are skipped a block at a time.
+ */
+static size_t
+escapedLen(const unsigned char *buf, es_size_t len, es_size_t first, const int bUTF8)
+{
+	size_t lenOut = first;
+	es_size_t i, j, n;
+
+	i = first;
+	while(i < len) {
+		j = scan(buf, len, i, bUTF8);
+		lenOut += j - i;
+		if(j == len)
+			break;
+		if(buf[j] >= 0x80 && (n = utf8SeqLen(buf + j, len - j)) != 0) {
+			lenOut += n;
+			i = j + n;
+		} else {
+			lenOut += escLen(buf[j]);
+			i = j + 1;
+		}
+	}
+	return lenOut;
+}
+
+
+static int
+addJSONEscaped(es_str_t **ps, const unsigned char *buf, es_size_t len, const int bUTF8)
+{
+	int r;
+	es_str_t *s;
+	unsigned char *out;
+	es_size_t first, i, j, n;
+	size_t lenOut;
+
+	if(len == 0) {
+		r = 0;
+		goto done;
+	}
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
+	first = scan(buf, len, 0, bUTF8);
+	lenOut = (first == len) ? len : escapedLen(buf, len, first, bUTF8);
+	if(lenOut > (es_size_t) -1) {
+		r = ENOMEM;
+		goto done;
+	}
+	if((r = es_int_reserve(ps, lenOut)) != 0)
+		goto done;
+	s = *ps;
+	ES_INVALIDATE_HASH(s);
+
+	/* from here on, the buffer is known to be large enough */
+	out = es_getBufAddr(s) + s->lenStr;
+	memcpy(out, buf, first);
+	out += first;
+	i = first;
+	while(i < len) {
+		j = scan(buf, len, i, bUTF8);
+		memcpy(out, buf + i, j - i);
+		out += j - i;
+		if(j == len)
+			break;
+		if(buf[j] >= 0x80 && (n = utf8SeqLen(buf + j, len - j)) != 0) {
+			memcpy(out, buf + j, n);
+			out += n;
+			i = j + n;
+		} else {
+			out += writeEsc(out, buf[j]);
+			i = j + 1;
+		}
+	}
+	s->lenStr += lenOut;
+
+done:
+	return r;
+}
+
+
+int
+es_addJSONEscaped(es_str_t **ps, const char *buf, es_size_t lenBuf)
+{
+	return addJSONEscaped(ps, (const unsigned char*) buf, lenBuf, 0);
+}
+
+
+int
+es_addJSONEscapedUTF8(es_str_t **ps, const char *buf, es_size_t lenBuf)
+{
+	return addJSONEscaped(ps, (const unsigned char*) buf, lenBuf, 1);
+}
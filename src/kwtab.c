@@ -0,0 +1,410 @@
+/**
+ * @file kwtab.c
+ * Implements keyword tables.
+ *
+ * A keyword table maps a fixed set of keywords to their index via a
+ * perfect hash function, built by "hash and displace": keys are hashed
+ * into buckets, and for each bucket (largest first) a displacement is
+ * searched that places all of its keys into free slots. A lookup thus
+ * needs one hash computation, two array reads and one compare.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#define NO_KEY ((es_size_t) -1)
+#define MAX_SEED_TRIES 32	/* new hash seeds to try before we give up */
+#define MAX_DISP_TRIES 65536	/* displacements to try per bucket and seed */
+
+struct kwKey {
+	es_size_t offs;		/**< offset of keyword inside keywords buffer */
+	es_size_t len;		/**< length of keyword */
+};
+
+struct es_kwtab_s {
+	int bCaseInsensitive;
+	int bCompiled;
+	/* keywords as added by the caller */
+	struct kwKey *keys;
+	es_size_t nKeys;
+	es_size_t maxKeys;
+	es_str_t *keywords;	/**< all keyword bytes (folded if case-insensitive) */
+	es_size_t minLen;	/**< length of shortest keyword */
+	es_size_t maxLen;	/**< length of longest keyword */
+	/* the compiled hash function */
+	unsigned long long seed;
+	es_size_t nBuckets;
+	es_size_t *disp;	/**< displacement per bucket */
+	es_size_t mask;		/**< number of slots - 1, a power of 2 minus 1 */
+	es_size_t *slots;	/**< key index per slot or NO_KEY */
+};
+
+/* Convert 'A'..'Z' in all eight bytes of a word to lower case. Bytes
+ * are processed with 7 bits, so there is no carry between them.
+ */
+static inline unsigned long long
+foldWord(const unsigned long long w)
+{
+	const unsigned long long low7 = w & 0x7f7f7f7f7f7f7f7fULL;
+	const unsigned long long geA = low7 + 0x3f3f3f3f3f3f3f3fULL; /* 0x80 set if >= 'A' */
+	const unsigned long long gtZ = low7 + 0x2525252525252525ULL; /* 0x80 set if > 'Z' */
+
+	return w | ((geA & ~gtZ & ~w & 0x8080808080808080ULL) >> 2);
+}
+
+static inline unsigned long long
+fmix64(unsigned long long h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* Hash a key, eight bytes per step. If bFold is set, the result is the
+ * same as for the lower case version of the key.
+ */
+static inline unsigned long long
+hashKey(const unsigned char *p, es_size_t len, const unsigned long long seed, const int bFold)
+{
+	unsigned long long h = seed ^ (len * 0x9e3779b97f4a7c15ULL);
+	unsigned long long w;
+	es_size_t i;
+
+	for(i = 0 ; i + 8 <= len ; i += 8) {
+		memcpy(&w, p + i, sizeof(w));
+		if(bFold)
+			w = foldWord(w);
+		h = (h ^ w) * 0x87c37b91114253d5ULL;
+		h ^= h >> 31;
+	}
+	if(i < len) {
+		w = 0;
+		memcpy(&w, p + i, len - i);
+		if(bFold)
+			w = foldWord(w);
+		h = (h ^ w) * 0x87c37b91114253d5ULL;
+	}
+	return fmix64(h);
+}
+
+static inline es_size_t
+bucketOf(const unsigned long long h, const es_size_t nBuckets)
+{
+	return (es_size_t) (((h >> 32) * nBuckets) >> 32);
+}
+
+static inline es_size_t
+slotOf(const unsigned long long h, const es_size_t disp, const es_size_t mask)
+{
+	return (es_size_t) fmix64(h + disp * 0x9e3779b97f4a7c15ULL) & mask;
+}
+
+
+es_kwtab_t *
+es_newKwTab(int bCaseInsensitive)
+{
+	es_kwtab_t *t;
+
+	if((t = calloc(1, sizeof(es_kwtab_t))) == NULL)
+		goto done;
+	t->bCaseInsensitive = bCaseInsensitive;
+	if((t->keywords = es_newStr(256)) == NULL) {
+		free(t);
+		t = NULL;
+	}
+
+done:
+	return t;
+}
+
+
+static void
+freeHashFunction(es_kwtab_t *t)
+{
+	free(t->disp);
+	free(t->slots);
+	t->disp = t->slots = NULL;
+	t->bCompiled = 0;
+}
+
+
+void
+es_deleteKwTab(es_kwtab_t *t)
+{
+	if(t == NULL)
+		return;
+	freeHashFunction(t);
+	free(t->keys);
+	es_deleteStr(t->keywords);
+	free(t);
+}
+
+
+int
+es_kwtabAddBuf(es_kwtab_t *t, const unsigned char *buf, es_size_t len)
+{
+	int r = 0;
+	struct kwKey *newKeys;
+	es_size_t newMax;
+	size_t allocSize;
+	es_size_t offs;
+	es_size_t i;
+	unsigned char *c;
+
+	if(t->nKeys == INT_MAX) {
+		/* the index must be representable as return value of the lookup */
+		r = ENOMEM;
+		goto done;
+	}
+	if(t->nKeys == t->maxKeys) {
+		newMax = (t->maxKeys == 0) ? 16 : 2 * t->maxKeys;
+		allocSize = (size_t) newMax * sizeof(struct kwKey);
+		if(newMax < t->maxKeys || allocSize / sizeof(struct kwKey) != newMax) {
+			r = ENOMEM;
+			goto done;
+		}
+		if((newKeys = realloc(t->keys, allocSize)) == NULL) {
+			r = ENOMEM;
+			goto done;
+		}
+		t->keys = newKeys;
+		t->maxKeys = newMax;
+	}
+
+	offs = es_strlen(t->keywords);
+	if((r = es_addBuf(&t->keywords, (const char*) buf, len)) != 0)
+		goto done;
+	if(t->bCaseInsensitive) {
+		c = es_getBufAddr(t->keywords) + offs;
+		for(i = 0 ; i < len ; ++i)
+			c[i] = es_int_asciiLower[c[i]];
+	}
+
+	t->keys[t->nKeys].offs = offs;
+	t->keys[t->nKeys].len = len;
+	++t->nKeys;
+	/* any existing hash function is now outdated */
+	freeHashFunction(t);
+
+done:
+	return r;
+}
+
+
+int
+es_kwtabAdd(es_kwtab_t *t, es_str_t *keyword)
+{
+	return es_kwtabAddBuf(t, es_getBufAddr(keyword), es_strlen(keyword));
+}
+
+
+static int
+keysEqual(es_kwtab_t *t, const es_size_t k1, const es_size_t k2)
+{
+	const unsigned char *kw = es_getBufAddr(t->keywords);
+
+	return t->keys[k1].len == t->keys[k2].len
+	       && memcmp(kw + t->keys[k1].offs, kw + t->keys[k2].offs, t->keys[k1].len) == 0;
+}
+
+/* Try to find displacements for all buckets with the current seed.
+ * byBucket holds the key indexes grouped by bucket, bucket b's keys
+ * start at bucketStart[b]; order lists the buckets, largest first.
+ * @returns 0 on success, EAGAIN if a new seed is needed, EEXIST if
+ *          there are duplicate keywords
+ */
+static int
+placeBuckets(es_kwtab_t *t, const unsigned long long *hashes, const es_size_t *byBucket,
+	const es_size_t *bucketStart, const es_size_t *order, es_size_t *tmpSlots)
+{
+	es_size_t o, b, d, i, j, nInBucket;
+	const es_size_t *keys;
+
+	for(i = 0 ; i <= t->mask ; ++i)
+		t->slots[i] = NO_KEY;
+	for(o = 0 ; o < t->nBuckets ; ++o) {
+		b = order[o];
+		keys = byBucket + bucketStart[b];
+		nInBucket = bucketStart[b + 1] - bucketStart[b];
+		if(nInBucket == 0)
+			break; /* buckets are sorted by size, so all others are empty */
+		for(d = 0 ; d < MAX_DISP_TRIES ; ++d) {
+			for(i = 0 ; i < nInBucket ; ++i) {
+				tmpSlots[i] = slotOf(hashes[keys[i]], d, t->mask);
+				if(t->slots[tmpSlots[i]] != NO_KEY)
+					break;
+				for(j = 0 ; j < i && tmpSlots[j] != tmpSlots[i] ; ++j)
+					/* just search */;
+				if(j < i) {
+					/* only keys with equal hashes collide for all d */
+					if(hashes[keys[i]] == hashes[keys[j]])
+						return keysEqual(t, keys[i], keys[j]) ? EEXIST : EAGAIN;
+					break;
+				}
+			}
+			if(i == nInBucket)
+				break; /* all keys placed */
+		}
+		if(d == MAX_DISP_TRIES)
+			return EAGAIN;
+		t->disp[b] = d;
+		for(i = 0 ; i < nInBucket ; ++i)
+			t->slots[tmpSlots[i]] = keys[i];
+	}
+	return 0;
+}
+
+int
+es_kwtabCompile(es_kwtab_t *t)
+{
+	int r = 0;
+	es_size_t n = t->nKeys;
+	es_size_t nSlots, i, b, k, sz, maxSize, tries;
+	unsigned long long *hashes = NULL;
+	es_size_t *byBucket = NULL;
+	es_size_t *bucketStart = NULL;
+	es_size_t *order = NULL;
+	es_size_t *tmpSlots = NULL;
+	const unsigned char *kw;
+
+	freeHashFunction(t);
+
+	/* about one key per bucket and a load factor of at most 2/3 */
+	t->nBuckets = (n == 0) ? 1 : n;
+	for(nSlots = 1 ; nSlots < n + n / 2 ; nSlots *= 2) {
+		if(nSlots > UINT_MAX / 4) {
+			r = ENOMEM;
+			goto done;
+		}
+	}
+	t->mask = nSlots - 1;
+	t->disp = calloc(t->nBuckets, sizeof(es_size_t));
+	t->slots = malloc(nSlots * sizeof(es_size_t));
+	hashes = malloc((n + 1) * sizeof(unsigned long long));
+	byBucket = malloc((n + 1) * sizeof(es_size_t));
+	bucketStart = malloc((t->nBuckets + 1) * sizeof(es_size_t));
+	order = malloc(t->nBuckets * sizeof(es_size_t));
+	tmpSlots = malloc((n + 1) * sizeof(es_size_t));
+	if(t->disp == NULL || t->slots == NULL || hashes == NULL || byBucket == NULL
+	   || bucketStart == NULL || order == NULL || tmpSlots == NULL) {
+		r = ENOMEM;
+		goto done;
+	}
+
+	t->minLen = (n == 0) ? 1 : t->keys[0].len;
+	t->maxLen = 0;
+	for(i = 0 ; i < n ; ++i) {
+		if(t->keys[i].len < t->minLen)
+			t->minLen = t->keys[i].len;
+		if(t->keys[i].len > t->maxLen)
+			t->maxLen = t->keys[i].len;
+	}
+
+	kw = es_getBufAddr(t->keywords);
+	for(tries = 0 ; tries < MAX_SEED_TRIES ; ++tries) {
+		t->seed = fmix64(tries + 1);
+		for(i = 0 ; i < n ; ++i)
+			hashes[i] = hashKey(kw + t->keys[i].offs, t->keys[i].len, t->seed, 0);
+
+		/* group keys by bucket (counting sort) */
+		memset(bucketStart, 0, (t->nBuckets + 1) * sizeof(es_size_t));
+		for(i = 0 ; i < n ; ++i)
+			++bucketStart[bucketOf(hashes[i], t->nBuckets) + 1];
+		for(b = 0 ; b < t->nBuckets ; ++b)
+			bucketStart[b + 1] += bucketStart[b];
+		memset(order, 0, t->nBuckets * sizeof(es_size_t));
+		for(i = 0 ; i < n ; ++i) {
+			b = bucketOf(hashes[i], t->nBuckets);
+			/* order[] is used as fill count for now */
+			byBucket[bucketStart[b] + order[b]++] = i;
+		}
+
+		/* order buckets by size, largest first */
+		maxSize = 0;
+		for(b = 0 ; b < t->nBuckets ; ++b)
+			if(order[b] > maxSize)
+				maxSize = order[b];
+		k = 0;
+		for(sz = maxSize + 1 ; sz-- > 0 ; )
+			for(b = 0 ; b < t->nBuckets ; ++b)
+				if(bucketStart[b + 1] - bucketStart[b] == sz)
+					order[k++] = b;
+
+		r = placeBuckets(t, hashes, byBucket, bucketStart, order, tmpSlots);
+		if(r != EAGAIN)
+			break;
+	}
+	if(r == 0)
+		t->bCompiled = 1;
+
+done:
+	free(hashes);
+	free(byBucket);
+	free(bucketStart);
+	free(order);
+	free(tmpSlots);
+	if(r != 0)
+		freeHashFunction(t);
+	return r;
+}
+
+
+int
+es_kwtabLookupBuf(es_kwtab_t *t, const unsigned char *buf, es_size_t len)
+{
+	unsigned long long h;
+	es_size_t k;
+	const unsigned char *key;
+
+	if(!t->bCompiled || len < t->minLen || len > t->maxLen)
+		return -1;
+	h = hashKey(buf, len, t->seed, t->bCaseInsensitive);
+	k = t->slots[slotOf(h, t->disp[bucketOf(h, t->nBuckets)], t->mask)];
+	if(k == NO_KEY || t->keys[k].len != len)
+		return -1;
+	key = es_getBufAddr(t->keywords) + t->keys[k].offs;
+	if(t->bCaseInsensitive) {
+		if(es_int_caseMismatch(buf, key, len) != len)
+			return -1;
+	} else {
+		if(memcmp(buf, key, len) != 0)
+			return -1;
+	}
+	return (int) k;
+}
+
+
+int
+es_kwtabLookup(es_kwtab_t *t, es_str_t *s)
+{
+	return es_kwtabLookupBuf(t, es_getBufAddr(s), es_strlen(s));
+}
@@ -29,11 +29,55 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <assert.h>
+#if !defined(HAVE_ATOMIC_BUILTINS) && defined(HAVE_PTHREAD_H)
+#	include <pthread.h>
+#endif
 
 #include "libestr.h"
+#include "libestr_int.h"
 
 char *
 es_version(void)
 {
 	return VERSION;
 }
+
+#ifdef ES_USE_AVX2
+int
+es_int_haveAVX2(void)
+{
+	/* the race on first use is benign: all threads compute the same value */
+	static int haveAVX2 = -1;
+
+	if(haveAVX2 == -1) {
+		__builtin_cpu_init();
+		haveAVX2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+	return haveAVX2;
+}
+#endif
+
+#ifndef HAVE_ATOMIC_BUILTINS
+/* Fallback for compilers without atomic builtins. This is slow, but
+ * only used for reference counts of shared strings.
+ */
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t mutAtomic = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+es_size_t
+es_int_atomicFetchAdd(es_size_t *p, int delta)
+{
+	es_size_t old;
+
+#	ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&mutAtomic);
+#	endif
+	old = *p;
+	*p += delta;
+#	ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&mutAtomic);
+#	endif
+	return old;
+}
+#endif
@@ -0,0 +1,417 @@
+/**
+ * @file libestr_int.h
+ * Definitions shared between the library's source modules. This is
+ * \b not part of the public API and thus not installed.
+ *
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef LIBESTR_INT_H_INCLUDED
+#define	LIBESTR_INT_H_INCLUDED
+#include <stddef.h>
+#include <errno.h>
+
+/* SIMD code paths are only used with compilers that provide the
+ * x86 intrinsics headers and the bit-scan builtins we need. Everything
+ * else uses the plain C fallbacks, which are always present.
+ */
+#if defined(ENABLE_SIMD) && defined(__GNUC__) && defined(__SSE2__)
+#	define ES_USE_SSE2
+#endif
+#if defined(ES_USE_SSE2) && defined(HAVE_X86_AVX2_TARGET)
+#	define ES_USE_AVX2
+#endif
+/* statistics are kept per thread, so they need thread-local storage */
+#if defined(ENABLE_STATS) && defined(HAVE_TLS) && defined(HAVE_PTHREAD_H)
+#	define ES_USE_STATS
+#endif
+/* SWAR (SIMD within a register) code works on 8 bytes loaded into an
+ * unsigned long long and assumes little endian byte order.
+ */
+#if defined(ENABLE_SIMD) && defined(__BYTE_ORDER__) \
+	&& defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#	define ES_USE_SWAR
+#endif
+
+/**
+ * Hidden string header.
+ * Every es_str_t allocated by the library is preceded by this header.
+ * It is not part of es_str_t itself, so that the public structure (and
+ * es_getBufAddr()) stays unchanged. Its size is a multiple of 8, so the
+ * string data keeps its alignment.
+ */
+typedef struct {
+	es_size_t flags;	/**< ES_STRF_* flags */
+	union {
+		es_size_t refcnt;	/**< number of *additional* owners (0 = exclusive) */
+		es_size_t arenaOffs;	/**< arena strings: offset of header inside chunk */
+	} u;
+#	ifdef ENABLE_HASH_CACHE
+	unsigned long long hash;	/**< cached hash, valid if ES_STRF_HASHED */
+	unsigned long long hashSeed;	/**< seed the cached hash was computed with */
+#	endif
+#	ifdef ES_USE_STATS
+	es_size_t nGrowths;	/**< number of times the buffer was grown */
+	es_size_t statsPad;	/**< keeps the header size a multiple of 8 */
+#	endif
+} es_strhdr_t;
+
+#define ES_STRF_ARENA	0x01	/**< string lives inside an arena */
+#define ES_STRF_SHARED	0x02	/**< string was shared, check refcnt before modifying */
+#define ES_STRF_INTERNED 0x04	/**< string is owned by an intern table, never freed */
+#define ES_STRF_HASHED	0x08	/**< hash/hashSeed fields are valid */
+
+/* must be called by all functions that modify a string's contents */
+#ifdef ENABLE_HASH_CACHE
+#	define ES_INVALIDATE_HASH(s) (es_int_hdr(s)->flags &= ~ES_STRF_HASHED)
+#else
+#	define ES_INVALIDATE_HASH(s) ((void) (s))
+#endif
+
+/* atomic operations, used for the reference counts of shared strings */
+#ifdef HAVE_ATOMIC_BUILTINS
+#	define ES_ATOMIC_FETCH_ADD(p, v) __sync_fetch_and_add((p), (v))
+#	define ES_ATOMIC_FETCH_SUB(p, v) __sync_fetch_and_sub((p), (v))
+#	define ES_MEMBAR() __sync_synchronize()
+#else
+es_size_t es_int_atomicFetchAdd(es_size_t *p, int delta);
+#	define ES_ATOMIC_FETCH_ADD(p, v) es_int_atomicFetchAdd((p), (v))
+#	define ES_ATOMIC_FETCH_SUB(p, v) es_int_atomicFetchAdd((p), -(v))
+#	define ES_MEMBAR()
+#endif
+
+/**
+ * Make sure the caller has exclusive ownership of a string, so that it
+ * can be modified. This must be called by all functions that modify
+ * a string and have an updatable string pointer.
+ * @returns 0 on success, something else otherwise
+ */
+int es_int_unshare(es_str_t **ps);
+
+/* copy-on-write mode, see es_setCOWMode() */
+extern int es_int_bCOWMode;
+
+/* the fast path of es_int_unshare() */
+#define ES_UNSHARE(ps) \
+	((es_int_hdr(*(ps))->flags & ES_STRF_SHARED) ? es_int_unshare(ps) : 0)
+
+static inline es_strhdr_t *
+es_int_hdr(es_str_t *s)
+{
+	return ((es_strhdr_t*) s) - 1;
+}
+
+static inline es_str_t *
+es_int_strFromHdr(es_strhdr_t *h)
+{
+	return (es_str_t*) (h + 1);
+}
+
+/* does anybody besides the caller own the string? */
+static inline int
+es_int_hasOtherOwners(es_str_t *s)
+{
+	es_strhdr_t *h = es_int_hdr(s);
+	return (h->flags & ES_STRF_SHARED) && ES_ATOMIC_FETCH_ADD(&h->u.refcnt, 0) != 0;
+}
+
+/**
+ * Report an in-place modification of a shared string and abort.
+ * All owners of a shared string hold the same object, so a function
+ * without an updatable pointer can not give its caller a private copy.
+ * Silently modifying (or not modifying) the data would corrupt the
+ * other owners' view or lose the caller's change.
+ */
+void es_int_sharedModifyAbort(const char *func);
+
+/* must be called by all in-place modifiers, see es_int_sharedModifyAbort() */
+#define ES_REQUIRE_EXCLUSIVE(s) \
+	do { \
+		if(es_int_hasOtherOwners(s)) \
+			es_int_sharedModifyAbort(__func__); \
+	} while(0)
+
+#ifdef ES_USE_STATS
+/**
+ * Statistics counters of one thread. Each thread has its own block,
+ * which is cache line aligned, so updates need no atomic operations
+ * and do not cause cache line bouncing.
+ */
+struct es_int_statsBlock {
+	es_stats_t st;
+	struct es_int_statsBlock *next;	/**< list of all threads' blocks */
+	struct es_int_statsBlock *prev;
+};
+
+extern __thread struct es_int_statsBlock *es_int_tlsStats;
+
+/**
+ * Create and register the calling thread's statistics block.
+ * @returns the block or NULL if it could not be created
+ */
+struct es_int_statsBlock *es_int_statsInit(void);
+
+static inline es_stats_t *
+es_int_stats(void)
+{
+	struct es_int_statsBlock *b = es_int_tlsStats;
+
+	if(b == NULL && (b = es_int_statsInit()) == NULL)
+		return NULL;
+	return &b->st;
+}
+
+/* called when a string object was allocated */
+static inline void
+es_int_statsAlloc(es_strhdr_t *h, es_size_t lenBuf)
+{
+	es_stats_t *st;
+
+	h->nGrowths = 0;
+	if((st = es_int_stats()) == NULL)
+		return;
+	++st->nAlloc;
+	st->bytesLive += lenBuf;
+}
+
+/* called when a string buffer was resized; bytesCopied is the number
+ * of bytes that had to be moved to a new memory location (0 if resized
+ * in place).
+ */
+static inline void
+es_int_statsResize(es_strhdr_t *h, es_size_t oldSize, es_size_t newSize, es_size_t bytesCopied)
+{
+	es_stats_t *st;
+
+	if(newSize > oldSize)
+		++h->nGrowths;
+	if((st = es_int_stats()) == NULL)
+		return;
+	++st->nRealloc;
+	st->bytesCopied += bytesCopied;
+	st->bytesLive += (long long) newSize - (long long) oldSize;
+}
+
+/* called right before a string object is freed */
+static inline void
+es_int_statsFree(es_str_t *s)
+{
+	es_stats_t *st;
+	unsigned long long slack = 0;
+	es_size_t nGrowths;
+
+	if((st = es_int_stats()) == NULL)
+		return;
+	++st->nFree;
+	st->bytesLive -= s->lenBuf;
+	if(s->lenBuf != 0)
+		slack = (unsigned long long) (s->lenBuf - s->lenStr) * ES_STATS_NBUCKETS / s->lenBuf;
+	++st->slackHist[(slack < ES_STATS_NBUCKETS) ? slack : ES_STATS_NBUCKETS - 1];
+	nGrowths = es_int_hdr(s)->nGrowths;
+	++st->growthHist[(nGrowths < ES_STATS_NBUCKETS) ? nGrowths : ES_STATS_NBUCKETS - 1];
+}
+#	define ES_STATS_ALLOC(h, lenBuf) es_int_statsAlloc((h), (lenBuf))
+#	define ES_STATS_RESIZE(h, oldSize, newSize, bytesCopied) \
+		es_int_statsResize((h), (oldSize), (newSize), (bytesCopied))
+#	define ES_STATS_FREE(s) es_int_statsFree(s)
+#else
+#	define ES_STATS_ALLOC(h, lenBuf) ((void) (h), (void) (lenBuf))
+#	define ES_STATS_RESIZE(h, oldSize, newSize, bytesCopied) \
+		((void) (h), (void) (oldSize), (void) (newSize), (void) (bytesCopied))
+#	define ES_STATS_FREE(s) ((void) (s))
+#endif /* #ifdef ES_USE_STATS */
+
+/**
+ * The process-wide growth policy, see es_setGrowthPolicy().
+ */
+extern es_growthPolicy_t es_int_growthPolicy;
+
+/**
+ * Round a buffer size as requested by a growth policy. The result is
+ * always a multiple of 8 (arena strings rely on that).
+ * @returns rounded size or 0 on overflow
+ */
+static inline es_size_t
+es_int_roundSize(const es_growthPolicy_t *p, es_size_t size)
+{
+	const unsigned long long hdrSize = sizeof(es_strhdr_t) + sizeof(es_str_t);
+	unsigned long long total, step;
+
+	if(p->bRoundToBins) {
+		/* malloc size classes: 16 byte steps for small blocks, then
+		 * four steps per power of two. This is done in 64 bit, so
+		 * that sizes close to the es_size_t limit can not overflow.
+		 */
+		total = size + hdrSize;
+		for(step = 16 ; total > 8 * step ; step *= 2)
+			/* just search */;
+		total = (total + step - 1) & ~(step - 1);
+		if(total - hdrSize > (es_size_t)-1)
+			return 0;
+		return (es_size_t) (total - hdrSize);
+	}
+	if(size > (es_size_t)-8)
+		return 0;
+	return (size + 7) & ~((es_size_t) 7);
+}
+
+/**
+ * Make sure a string has room for at least need more bytes.
+ * Does not unshare the string, callers must do that before modifying it.
+ * @returns 0 on success, something else otherwise
+ */
+static inline int
+es_int_reserve(es_str_t **ps, es_size_t need)
+{
+	es_str_t *s = *ps;
+
+	if(s->lenBuf - s->lenStr >= need)
+		return 0;
+	if(s->lenStr + need < s->lenStr)
+		return ENOMEM;
+	return es_extendBuf(ps, s->lenStr + need - s->lenBuf);
+}
+
+/**
+ * Resize a string that lives inside an arena. This is the arena
+ * counterpart to the realloc() done by es_extendBuf(). A string can only
+ * be shrunk if it is the arena's most recent allocation, otherwise it
+ * is left unchanged.
+ *
+ * @param[in/out] ps string to be resized
+ * @param[in] newSize new buffer size (already computed by caller)
+ * @returns 0 on success, something else otherwise
+ */
+int es_int_arenaResize(es_str_t **ps, es_size_t newSize);
+
+/**
+ * Get the growth policy of the arena an arena string lives in.
+ * @returns the arena's policy or NULL if it uses the process-wide one
+ */
+const es_growthPolicy_t *es_int_arenaPolicy(es_str_t *s);
+
+/**
+ * Release an arena string. Memory is only given back if the string
+ * is the arena's most recent allocation, otherwise this is a no-op and
+ * the space is reclaimed when the arena is reset or deleted.
+ */
+void es_int_arenaFree(es_str_t *s);
+
+/**
+ * Set if the per-thread string pool is enabled.
+ */
+extern int es_int_poolEnabled;
+
+/**
+ * Get a string block from the calling thread's pool.
+ * Rounds *pLen up to the buffer size of its size class, if there is one.
+ * That also happens if no block is available, so that the caller's
+ * malloc() creates a block that can later be pooled.
+ *
+ * @param[in/out] pLen requested buffer size, updated to the actual one
+ * @returns block with a buffer of *pLen bytes or NULL if none available
+ */
+es_strhdr_t *es_int_poolGet(es_size_t *pLen);
+
+/**
+ * Put a string block into the calling thread's pool.
+ * @param[in] h header of the block
+ * @param[in] lenBuf buffer size of the block
+ * @returns 1 if the block was taken over by the pool, 0 if the caller
+ *          must free() it.
+ */
+int es_int_poolPut(es_strhdr_t *h, es_size_t lenBuf);
+
+#ifdef ES_USE_AVX2
+/**
+ * Check if the CPU we are running on supports AVX2. The result is
+ * cached, so this is cheap to call.
+ * @returns 1 if AVX2 is available, 0 otherwise
+ */
+int es_int_haveAVX2(void);
+#endif
+
+/**
+ * ASCII lower case table, indexed by byte value. Non-ASCII bytes
+ * map to themselves, so this is locale-independent.
+ */
+extern const unsigned char es_int_asciiLower[256];
+
+/**
+ * Convert an ASCII character to upper case, independent of the locale.
+ */
+static inline unsigned char
+es_int_asciiUpper(const unsigned char c)
+{
+	return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+}
+
+/**
+ * Check if two buffers are equal when ignoring ASCII case.
+ * @returns 1 if equal, 0 otherwise
+ */
+static inline int
+es_int_memcaseeq(const unsigned char *a, const unsigned char *b, size_t len)
+{
+	size_t i;
+
+	for(i = 0 ; i < len ; ++i)
+		if(es_int_asciiLower[a[i]] != es_int_asciiLower[b[i]])
+			return 0;
+	return 1;
+}
+
+/**
+ * Find the first position where two buffers differ.
+ * @returns offset of the first differing byte, or len if the buffers
+ *          are equal
+ */
+size_t es_int_mismatch(const unsigned char *a, const unsigned char *b, size_t len);
+
+/**
+ * Case-insensitive version of es_int_mismatch(). Only ASCII letters
+ * are folded, independent of the locale.
+ */
+size_t es_int_caseMismatch(const unsigned char *a, const unsigned char *b, size_t len);
+
+/**
+ * Search a buffer for the first occurence of another one.
+ * This is the engine behind es_strContains() and friends.
+ *
+ * @param[in] hay buffer to search in
+ * @param[in] lenHay length of hay
+ * @param[in] needle buffer to search for
+ * @param[in] lenNeedle length of needle
+ * @returns -1 if needle is not contained in hay, otherwise the zero-based
+ *          offset of its first occurence.
+ */
+int es_int_findBuf(const unsigned char *hay, es_size_t lenHay,
+	const unsigned char *needle, es_size_t lenNeedle);
+
+/**
+ * Case-insensitive version of es_int_findBuf(). Only ASCII letters are
+ * folded, the current locale is not used.
+ */
+int es_int_findBufCase(const unsigned char *hay, es_size_t lenHay,
+	const unsigned char *needle, es_size_t lenNeedle);
+
+#endif /* #ifndef LIBESTR_INT_H_INCLUDED */
@@ -0,0 +1,431 @@
+/**
+ * @file mpm.c
+ * Implements the multi-pattern matcher (Aho-Corasick).
+ *
+ * Needles are first collected and then compiled into a complete DFA, so
+ * searching needs exactly one table lookup per haystack byte, no matter
+ * how many needles there are. To keep the state table small (and thus
+ * cache-friendly), the input alphabet is compressed into classes: only
+ * bytes that actually occur inside needles get a class of their own,
+ * all others share class 0. For typical rule sets, this reduces rows
+ * from 256 entries to a few dozen.
+ *
+ * While the automaton is in its start state, we use a (vectorized where
+ * possible) prefilter to skip over bytes that can not start a match.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#ifdef ES_USE_SSE2
+#	include <emmintrin.h>
+#endif
+#ifdef ES_USE_AVX2
+#	include <immintrin.h>
+#endif
+
+#define NO_NEEDLE ((es_size_t) -1)
+
+struct mpmNeedle {
+	unsigned id;		/**< caller-provided id */
+	es_size_t offs;		/**< offset of pattern inside patterns buffer */
+	es_size_t len;		/**< length of pattern */
+	es_size_t nextSame;	/**< next needle ending in the same state */
+};
+
+struct es_mpm_s {
+	int bCaseInsensitive;
+	int bCompiled;
+	/* needles as added by the caller */
+	struct mpmNeedle *needles;
+	es_size_t nNeedles;
+	es_size_t maxNeedles;
+	es_str_t *patterns;	/**< all needle bytes (folded if case-insensitive) */
+	/* the compiled automaton */
+	unsigned short cls[256]; /**< byte -> character class */
+	es_size_t nCls;		/**< number of classes (row length) */
+	es_size_t nStates;
+	es_size_t *next;	/**< transitions, nStates rows of nCls entries */
+	es_size_t *out;		/**< first needle ending in state or NO_NEEDLE */
+	es_size_t *dict;	/**< next state on fail chain with output, 0 if none */
+	/* prefilter for the start state */
+	unsigned char first[256]; /**< 1 if byte may start a match */
+	int nFirst;		/**< number of distinct bytes in first[] */
+	unsigned char firstBytes[3]; /**< the bytes if nFirst <= 3 */
+	unsigned char loNibble[16]; /**< shufti tables, see skipToCandidate() */
+	unsigned char hiNibble[16];
+};
+
+
+es_mpm_t *
+es_newMPM(int bCaseInsensitive)
+{
+	es_mpm_t *m;
+
+	if((m = calloc(1, sizeof(es_mpm_t))) == NULL)
+		goto done;
+	m->bCaseInsensitive = bCaseInsensitive;
+	if((m->patterns = es_newStr(256)) == NULL) {
+		free(m);
+		m = NULL;
+	}
+
+done:
+	return m;
+}
+
+
+static void
+freeAutomaton(es_mpm_t *m)
+{
+	free(m->next);
+	free(m->out);
+	free(m->dict);
+	m->next = m->out = m->dict = NULL;
+	m->bCompiled = 0;
+}
+
+
+void
+es_deleteMPM(es_mpm_t *m)
+{
+	if(m == NULL)
+		return;
+	freeAutomaton(m);
+	free(m->needles);
+	es_deleteStr(m->patterns);
+	free(m);
+}
+
+
+int
+es_mpmAddBuf(es_mpm_t *m, const unsigned char *buf, es_size_t len, unsigned id)
+{
+	int r = 0;
+	struct mpmNeedle *newNeedles;
+	es_size_t newMax;
+	size_t allocSize;
+	es_size_t offs;
+	es_size_t i;
+	unsigned char *c;
+
+	if(len == 0) {
+		/* the empty needle would match everywhere, we do not support that */
+		r = EINVAL;
+		goto done;
+	}
+	if(m->nNeedles == m->maxNeedles) {
+		newMax = (m->maxNeedles == 0) ? 16 : 2 * m->maxNeedles;
+		allocSize = (size_t) newMax * sizeof(struct mpmNeedle);
+		if(newMax < m->maxNeedles || allocSize / sizeof(struct mpmNeedle) != newMax) {
+			r = ENOMEM;
+			goto done;
+		}
+		if((newNeedles = realloc(m->needles, allocSize)) == NULL) {
+			r = ENOMEM;
+			goto done;
+		}
+		m->needles = newNeedles;
+		m->maxNeedles = newMax;
+	}
+
+	offs = es_strlen(m->patterns);
+	if((r = es_addBuf(&m->patterns, (const char*) buf, len)) != 0)
+		goto done;
+	if(m->bCaseInsensitive) {
+		c = es_getBufAddr(m->patterns) + offs;
+		for(i = 0 ; i < len ; ++i)
+			c[i] = es_int_asciiLower[c[i]];
+	}
+
+	m->needles[m->nNeedles].id = id;
+	m->needles[m->nNeedles].offs = offs;
+	m->needles[m->nNeedles].len = len;
+	m->needles[m->nNeedles].nextSame = NO_NEEDLE;
+	++m->nNeedles;
+	/* any existing automaton is now outdated */
+	freeAutomaton(m);
+
+done:
+	return r;
+}
+
+
+int
+es_mpmAdd(es_mpm_t *m, es_str_t *needle, unsigned id)
+{
+	return es_mpmAddBuf(m, es_getBufAddr(needle), es_strlen(needle), id);
+}
+
+
+/* build the start state prefilter from the root's transitions */
+static void
+buildPrefilter(es_mpm_t *m)
+{
+	int c;
+	int bucket;
+	int nHi;
+	int hiBucket[16];
+
+	memset(m->first, 0, sizeof(m->first));
+	m->nFirst = 0;
+	for(c = 0 ; c < 256 ; ++c) {
+		if(m->cls[c] != 0 && m->next[m->cls[c]] != 0) {
+			m->first[c] = 1;
+			if(m->nFirst < 3)
+				m->firstBytes[m->nFirst] = (unsigned char) c;
+			++m->nFirst;
+		}
+	}
+
+	/* shufti tables: a byte is a candidate if the buckets of its low and
+	 * high nibble intersect. Each distinct high nibble gets its own bucket,
+	 * which makes the test exact. If we have more than 8 high nibbles, some
+	 * share a bucket; this results in false positives, which is fine for
+	 * a prefilter.
+	 */
+	memset(m->loNibble, 0, sizeof(m->loNibble));
+	memset(m->hiNibble, 0, sizeof(m->hiNibble));
+	for(c = 0 ; c < 16 ; ++c)
+		hiBucket[c] = -1;
+	nHi = 0;
+	for(c = 0 ; c < 256 ; ++c) {
+		if(!m->first[c])
+			continue;
+		if(hiBucket[c >> 4] == -1)
+			hiBucket[c >> 4] = nHi++ % 8;
+		bucket = hiBucket[c >> 4];
+		m->hiNibble[c >> 4] |= 1 << bucket;
+		m->loNibble[c & 0x0f] |= 1 << bucket;
+	}
+}
+
+
+int
+es_mpmCompile(es_mpm_t *m)
+{
+	int r = 0;
+	es_size_t maxStates;
+	es_size_t n, i, s, t, c;
+	es_size_t *fail = NULL;
+	es_size_t *queue = NULL;
+	es_size_t qHead, qTail;
+	const unsigned char *pat;
+	struct mpmNeedle *nd;
+
+	freeAutomaton(m);
+
+	/* compute character classes */
+	memset(m->cls, 0, sizeof(m->cls));
+	m->nCls = 1;
+	pat = es_getBufAddr(m->patterns);
+	for(i = 0 ; i < es_strlen(m->patterns) ; ++i) {
+		if(m->cls[pat[i]] == 0)
+			m->cls[pat[i]] = m->nCls++;
+	}
+	if(m->bCaseInsensitive) {
+		for(c = 'A' ; c <= 'Z' ; ++c)
+			m->cls[c] = m->cls[es_int_asciiLower[c]];
+	}
+
+	/* worst case, each needle byte creates a state */
+	maxStates = es_strlen(m->patterns) + 1;
+	if(maxStates == 0 || maxStates > ((size_t) -1) / sizeof(es_size_t) / m->nCls) {
+		r = ENOMEM;
+		goto done;
+	}
+	m->next = calloc((size_t) maxStates * m->nCls, sizeof(es_size_t));
+	m->out = malloc(maxStates * sizeof(es_size_t));
+	m->dict = calloc(maxStates, sizeof(es_size_t));
+	fail = calloc(maxStates, sizeof(es_size_t));
+	queue = malloc(maxStates * sizeof(es_size_t));
+	if(m->next == NULL || m->out == NULL || m->dict == NULL || fail == NULL || queue == NULL) {
+		r = ENOMEM;
+		goto done;
+	}
+	for(s = 0 ; s < maxStates ; ++s)
+		m->out[s] = NO_NEEDLE;
+
+	/* build the trie; a transition to 0 means "none" for now */
+	m->nStates = 1;
+	for(n = 0 ; n < m->nNeedles ; ++n) {
+		nd = &m->needles[n];
+		s = 0;
+		for(i = 0 ; i < nd->len ; ++i) {
+			c = m->cls[pat[nd->offs + i]];
+			if(m->next[s * m->nCls + c] == 0)
+				m->next[s * m->nCls + c] = m->nStates++;
+			s = m->next[s * m->nCls + c];
+		}
+		nd->nextSame = m->out[s];
+		m->out[s] = n;
+	}
+
+	/* compute failure links breadth-first and turn the trie into a
+	 * complete DFA by filling missing transitions from the fail state.
+	 */
+	qHead = qTail = 0;
+	for(c = 0 ; c < m->nCls ; ++c) {
+		if((t = m->next[c]) != 0)
+			queue[qTail++] = t; /* fail[t] is already 0 */
+	}
+	while(qHead < qTail) {
+		s = queue[qHead++];
+		for(c = 0 ; c < m->nCls ; ++c) {
+			t = m->next[s * m->nCls + c];
+			if(t != 0) {
+				fail[t] = m->next[fail[s] * m->nCls + c];
+				m->dict[t] = (m->out[fail[t]] != NO_NEEDLE) ? fail[t] : m->dict[fail[t]];
+				queue[qTail++] = t;
+			} else {
+				m->next[s * m->nCls + c] = m->next[fail[s] * m->nCls + c];
+			}
+		}
+	}
+
+	buildPrefilter(m);
+	m->bCompiled = 1;
+
+done:
+	free(fail);
+	free(queue);
+	if(r != 0)
+		freeAutomaton(m);
+	return r;
+}
+
+
+#ifdef ES_USE_AVX2
+__attribute__((target("avx2")))
+static es_size_t
+skipShufti_avx2(es_mpm_t *m, const unsigned char *buf, es_size_t i, es_size_t len)
+{
+	const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) m->loNibble));
+	const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) m->hiNibble));
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i v, hit;
+	unsigned mask;
+
+	for( ; (size_t) i + 32 <= len ; i += 32) {
+		v = _mm256_loadu_si256((const __m256i*) (buf + i));
+		hit = _mm256_and_si256(
+			_mm256_shuffle_epi8(lo, _mm256_and_si256(v, nibble)),
+			_mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+		mask = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hit, zero));
+		if(mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	while(i < len && !m->first[buf[i]])
+		++i;
+	return i;
+}
+#endif /* #ifdef ES_USE_AVX2 */
+
+
+/* Skip bytes that can not start a match. Returns the index of the next
+ * candidate or len if there is none.
+ */
+static inline es_size_t
+skipToCandidate(es_mpm_t *m, const unsigned char *buf, es_size_t i, es_size_t len)
+{
+	const unsigned char *p;
+
+	if(m->nFirst == 1) {
+		p = memchr(buf + i, m->firstBytes[0], len - i);
+		return (p == NULL) ? len : (es_size_t) (p - buf);
+	}
+#	ifdef ES_USE_AVX2
+	if(es_int_haveAVX2())
+		return skipShufti_avx2(m, buf, i, len);
+#	endif
+#	ifdef ES_USE_SSE2
+	if(m->nFirst <= 3) {
+		const __m128i b0 = _mm_set1_epi8((char) m->firstBytes[0]);
+		const __m128i b1 = _mm_set1_epi8((char) m->firstBytes[1]);
+		const __m128i b2 = _mm_set1_epi8((char) m->firstBytes[m->nFirst - 1]);
+		__m128i v;
+		unsigned mask;
+		for( ; (size_t) i + 16 <= len ; i += 16) {
+			v = _mm_loadu_si128((const __m128i*) (buf + i));
+			mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, b0),
+				_mm_cmpeq_epi8(v, b1)), _mm_cmpeq_epi8(v, b2)));
+			if(mask != 0)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#	endif
+	while(i < len && !m->first[buf[i]])
+		++i;
+	return i;
+}
+
+
+int
+es_mpmSearchBuf(es_mpm_t *m, const unsigned char *buf, es_size_t len,
+	es_mpmCallback_t cb, void *usrptr)
+{
+	int nMatches = 0;
+	es_size_t i, s, o, n;
+
+	if(!m->bCompiled) {
+		nMatches = -1;
+		goto done;
+	}
+	if(m->nNeedles == 0)
+		goto done;
+
+	s = 0;
+	for(i = 0 ; i < len ; ++i) {
+		if(s == 0) {
+			if((i = skipToCandidate(m, buf, i, len)) == len)
+				break;
+		}
+		s = m->next[s * m->nCls + m->cls[buf[i]]];
+		/* report all needles ending here: the state's own ones and then
+		 * those of the states on the dictionary suffix chain.
+		 */
+		for(o = s ; o != 0 ; o = m->dict[o]) {
+			for(n = m->out[o] ; n != NO_NEEDLE ; n = m->needles[n].nextSame) {
+				++nMatches;
+				if(cb == NULL || cb(usrptr, m->needles[n].id, i + 1 - m->needles[n].len) != 0)
+					goto done;
+			}
+		}
+	}
+
+done:
+	return nMatches;
+}
+
+
+int
+es_mpmSearch(es_mpm_t *m, es_str_t *s, es_mpmCallback_t cb, void *usrptr)
+{
+	return es_mpmSearchBuf(m, es_getBufAddr(s), es_strlen(s), cb, usrptr);
+}
@@ -0,0 +1,318 @@
+/**
+ * @file needle.c
+ * Implements precompiled needles for repeated substring searches.
+ *
+ * Short needles are searched with the vectorized engine from search.c,
+ * which needs no preprocessing besides case-folding the needle once.
+ * Long needles use the Two-Way algorithm by Crochemore and Perrin,
+ * combined with a Boyer-Moore-Horspool bad character table. This gives
+ * sublinear average behaviour, but still guarantees linear worst case
+ * time, which plain Horspool does not. The implementation follows the
+ * well-known one from gnulib/glibc.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+/* needles shorter than this are handled by the vectorized engine */
+#define LONG_NEEDLE_THRESHOLD 32
+
+struct es_needle_s {
+	es_size_t len;			/**< length of the needle */
+	es_size_t suffix;		/**< start of right half of critical factorization */
+	es_size_t period;		/**< period of the needle (for Two-Way) */
+	int bCaseInsensitive;
+	int bPeriodic;			/**< needle is periodic (left half repeats in right)? */
+	es_size_t *shift;		/**< bad character table, NULL for short needles */
+	/* NOTE: the (case-folded) needle is placed AFTER the last data
+	 * element, just like with es_str_t.
+	 */
+};
+
+static inline unsigned char *
+getNeedleAddr(es_needle_t *n)
+{
+	return ((unsigned char*) n) + sizeof(es_needle_t);
+}
+
+
+/* Compute the critical factorization of the needle. Returns the start of
+ * the right half and stores the period of the right half in *period.
+ * Needle is expected to be already case-folded if required.
+ */
+static es_size_t
+criticalFactorization(const unsigned char *needle, es_size_t len, es_size_t *period)
+{
+	size_t maxSuffix, maxSuffixRev;
+	size_t j, k, p;
+	unsigned char a, b;
+
+	if(len < 3) {
+		*period = 1;
+		return len - 1;
+	}
+
+	/* maximal suffix for the "<" ordering. Note that maxSuffix starts
+	 * as (size_t)-1 and intentionally wraps to 0 when k is added.
+	 */
+	maxSuffix = (size_t) -1;
+	j = 0;
+	k = p = 1;
+	while(j + k < len) {
+		a = needle[j + k];
+		b = needle[maxSuffix + k];
+		if(a < b) {
+			j += k;
+			k = 1;
+			p = j - maxSuffix;
+		} else if(a == b) {
+			if(k != p) {
+				++k;
+			} else {
+				j += p;
+				k = 1;
+			}
+		} else {
+			maxSuffix = j++;
+			k = p = 1;
+		}
+	}
+	*period = p;
+
+	/* and now for the ">" ordering */
+	maxSuffixRev = (size_t) -1;
+	j = 0;
+	k = p = 1;
+	while(j + k < len) {
+		a = needle[j + k];
+		b = needle[maxSuffixRev + k];
+		if(b < a) {
+			j += k;
+			k = 1;
+			p = j - maxSuffixRev;
+		} else if(a == b) {
+			if(k != p) {
+				++k;
+			} else {
+				j += p;
+				k = 1;
+			}
+		} else {
+			maxSuffixRev = j++;
+			k = p = 1;
+		}
+	}
+
+	/* choose the longer suffix, the +1 handles the wrapped initial value */
+	if(maxSuffixRev + 1 < maxSuffix + 1)
+		return maxSuffix + 1;
+	*period = p;
+	return maxSuffixRev + 1;
+}
+
+
+es_needle_t *
+es_newNeedleFromBuf(const unsigned char *buf, es_size_t len, int bCaseInsensitive)
+{
+	es_needle_t *n;
+	unsigned char *c;
+	es_size_t i;
+	es_size_t period;
+
+	if(sizeof(es_needle_t) + len < len) { /* overflow? */
+		n = NULL;
+		goto done;
+	}
+	if((n = malloc(sizeof(es_needle_t) + len)) == NULL)
+		goto done;
+
+	n->len = len;
+	n->bCaseInsensitive = bCaseInsensitive;
+	n->bPeriodic = 0;
+	n->suffix = 0;
+	n->period = 0;
+	n->shift = NULL;
+	c = getNeedleAddr(n);
+	if(bCaseInsensitive) {
+		for(i = 0 ; i < len ; ++i)
+			c[i] = es_int_asciiLower[buf[i]];
+	} else if(len > 0) {
+		memcpy(c, buf, len);
+	}
+
+	if(len < LONG_NEEDLE_THRESHOLD)
+		goto done; /* all done, vectorized engine needs no tables */
+
+	if((n->shift = malloc(256 * sizeof(es_size_t))) == NULL) {
+		free(n);
+		n = NULL;
+		goto done;
+	}
+	n->suffix = criticalFactorization(c, len, &period);
+	if(n->suffix <= len - period && memcmp(c, c + period, n->suffix) == 0) {
+		n->bPeriodic = 1;
+		n->period = period;
+	} else {
+		n->period = (n->suffix > len - n->suffix ? n->suffix : len - n->suffix) + 1;
+	}
+
+	for(i = 0 ; i < 256 ; ++i)
+		n->shift[i] = len;
+	for(i = 0 ; i < len ; ++i)
+		n->shift[c[i]] = len - i - 1;
+	if(bCaseInsensitive) {
+		/* upper case letters must shift exactly like their lower case versions */
+		for(i = 'A' ; i <= 'Z' ; ++i)
+			n->shift[i] = n->shift[es_int_asciiLower[i]];
+	}
+
+done:
+	return n;
+}
+
+
+es_needle_t *
+es_newNeedle(es_str_t *str, int bCaseInsensitive)
+{
+	return es_newNeedleFromBuf(es_getBufAddr(str), es_strlen(str), bCaseInsensitive);
+}
+
+
+void
+es_deleteNeedle(es_needle_t *n)
+{
+	if(n == NULL)
+		return;
+	free(n->shift);
+	free(n);
+}
+
+
+/* The Two-Way search itself. CANON folds a haystack byte the same way
+ * the needle was folded, so we can generate both variants from one code
+ * base without a per-byte branch.
+ */
+#define TWO_WAY_SEARCH(FUNCNAME, CANON) \
+static int \
+FUNCNAME(es_needle_t *n, const unsigned char *hay, size_t lenHay) \
+{ \
+	const unsigned char *needle = getNeedleAddr(n); \
+	const size_t len = n->len; \
+	const size_t suffix = n->suffix; \
+	const size_t period = n->period; \
+	size_t i, j, shift, memory; \
+ \
+	j = 0; \
+	if(n->bPeriodic) { \
+		/* the needle repeats, so we can remember how much of the \
+		 * left half is already known to match after a shift. \
+		 */ \
+		memory = 0; \
+		while(j <= lenHay - len) { \
+			shift = n->shift[hay[j + len - 1]]; \
+			if(shift > 0) { \
+				if(memory && shift < period) \
+					shift = len - period; \
+				memory = 0; \
+				j += shift; \
+				continue; \
+			} \
+			i = (suffix > memory) ? suffix : memory; \
+			while(i < len - 1 && needle[i] == CANON(hay[i + j])) \
+				++i; \
+			if(len - 1 <= i) { \
+				i = suffix - 1; \
+				while(memory < i + 1 && needle[i] == CANON(hay[i + j])) \
+					--i; \
+				if(i + 1 < memory + 1) \
+					return (int) j; \
+				j += period; \
+				memory = len - period; \
+			} else { \
+				j += i - suffix + 1; \
+				memory = 0; \
+			} \
+		} \
+	} else { \
+		while(j <= lenHay - len) { \
+			shift = n->shift[hay[j + len - 1]]; \
+			if(shift > 0) { \
+				j += shift; \
+				continue; \
+			} \
+			i = suffix; \
+			while(i < len - 1 && needle[i] == CANON(hay[i + j])) \
+				++i; \
+			if(len - 1 <= i) { \
+				/* i wraps to (size_t)-1 if suffix is 0 */ \
+				i = suffix - 1; \
+				while(i != (size_t) -1 && needle[i] == CANON(hay[i + j])) \
+					--i; \
+				if(i == (size_t) -1) \
+					return (int) j; \
+				j += period; \
+			} else { \
+				j += i - suffix + 1; \
+			} \
+		} \
+	} \
+	return -1; \
+}
+
+#define CANON_IDENTITY(c) (c)
+#define CANON_FOLD(c) (es_int_asciiLower[(c)])
+TWO_WAY_SEARCH(twoWay, CANON_IDENTITY)
+TWO_WAY_SEARCH(twoWayCase, CANON_FOLD)
+
+
+int
+es_bufContainsNeedle(const unsigned char *buf, es_size_t len, es_needle_t *n)
+{
+	int r;
+
+	if(n->len > len) {
+		r = -1;
+	} else if(n->shift == NULL) {
+		/* short needle, the folded copy is fine for both modes */
+		if(n->bCaseInsensitive)
+			r = es_int_findBufCase(buf, len, getNeedleAddr(n), n->len);
+		else
+			r = es_int_findBuf(buf, len, getNeedleAddr(n), n->len);
+	} else if(n->bCaseInsensitive) {
+		r = twoWayCase(n, buf, len);
+	} else {
+		r = twoWay(n, buf, len);
+	}
+	return r;
+}
+
+
+int
+es_strContainsNeedle(es_str_t *s, es_needle_t *n)
+{
+	return es_bufContainsNeedle(es_getBufAddr(s), es_strlen(s), n);
+}
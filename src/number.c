@@ -0,0 +1,507 @@
+/**
+ * @file number.c
+ * Implements number parsing.
+ *
+ * Decimal digits are converted eight at a time (SWAR): eight bytes are
+ * loaded into one 64 bit word, checked to be all digits and combined
+ * with three multiplications. Up to 19 significant decimal digits can
+ * not overflow 64 bits, so only the 20th digit needs an overflow check.
+ * Doubles are computed exactly from the mantissa in the common case;
+ * everything else is handed to strtod().
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
+#include <locale.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+/* The exact fast path for doubles requires that intermediate results
+ * are not kept in higher precision (like on x87).
+ */
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+#	define ES_DOUBLE_FASTPATH
+#endif
+
+/* max number of significant decimal digits that can never overflow */
+#define MAX_SAFE_DIGITS 19
+
+/* @returns value of a (hex) digit, or 255 if c is no digit */
+static inline unsigned
+digitValue(const unsigned char c)
+{
+	unsigned char lc;
+
+	if((unsigned) (c - '0') < 10)
+		return c - '0';
+	lc = c | 0x20;
+	if((unsigned) (lc - 'a') < 6)
+		return lc - 'a' + 10;
+	return 255;
+}
+
+static inline int
+isDecDigit(const unsigned char c)
+{
+	return (unsigned) (c - '0') < 10;
+}
+
+#ifdef ES_USE_SWAR
+static inline unsigned long long
+load8(const unsigned char *p)
+{
+	unsigned long long v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/* are all eight bytes in '0'..'9'? Adding 6 moves ':'..'?' out of the
+ * 0x3_ row, so both checks together only accept digits.
+ */
+static inline int
+isEightDigits(const unsigned long long v)
+{
+	return ((v & 0xF0F0F0F0F0F0F0F0ULL)
+		| (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+		== 0x3333333333333333ULL;
+}
+
+/* Convert eight digits (first digit in the lowest byte). Neighbouring
+ * digits, then pairs, then quads are combined, each step in parallel.
+ */
+static inline unsigned long long
+parseEightDigits(unsigned long long v)
+{
+	const unsigned long long mask = 0x000000FF000000FFULL;
+	const unsigned long long mul1 = 100 + (1000000ULL << 32);
+	const unsigned long long mul2 = 1 + (10000ULL << 32);
+
+	v -= 0x3030303030303030ULL;
+	v = (v * 10) + (v >> 8);
+	v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+	return v & 0xffffffffULL;
+}
+#endif /* #ifdef ES_USE_SWAR */
+
+
+/* Parse a run of decimal digits. All digits are consumed, even if the
+ * value overflows. In that case, *pbOverflow is set and *pVal is
+ * ULLONG_MAX.
+ * @returns number of digits consumed
+ */
+static es_size_t
+scanDec(const unsigned char *p, es_size_t len, unsigned long long *pVal, int *pbOverflow)
+{
+	es_size_t i, end;
+	unsigned long long v = 0;
+	unsigned d;
+
+	/* leading zeros do not count as significant digits */
+	for(i = 0 ; i < len && p[i] == '0' ; ++i)
+		/* just skip */;
+	end = (len - i > MAX_SAFE_DIGITS) ? i + MAX_SAFE_DIGITS : len;
+
+#	ifdef ES_USE_SWAR
+	while(end - i >= 8) {
+		const unsigned long long w = load8(p + i);
+		if(!isEightDigits(w))
+			break;
+		v = v * 100000000 + parseEightDigits(w);
+		i += 8;
+	}
+#	endif
+	while(i < end && isDecDigit(p[i])) {
+		v = v * 10 + (p[i] - '0');
+		++i;
+	}
+
+	if(i == end && i < len && isDecDigit(p[i])) {
+		d = p[i] - '0';
+		if(v > (ULLONG_MAX - d) / 10) {
+			*pbOverflow = 1;
+		} else {
+			v = v * 10 + d;
+			if(++i < len && isDecDigit(p[i]))
+				*pbOverflow = 1;
+		}
+		if(*pbOverflow) {
+			v = ULLONG_MAX;
+			while(i < len && isDecDigit(p[i]))
+				++i;
+		}
+	}
+	*pVal = v;
+	return i;
+}
+
+/* Parse a run of octal (shift 3) or hex (shift 4) digits, same
+ * semantics as scanDec().
+ */
+static es_size_t
+scanBase(const unsigned char *p, es_size_t len, const unsigned shift, unsigned long long *pVal,
+	int *pbOverflow)
+{
+	es_size_t i;
+	unsigned long long v = 0;
+	unsigned d;
+	const unsigned base = 1u << shift;
+
+	for(i = 0 ; i < len && (d = digitValue(p[i])) < base ; ++i) {
+		if(v >> (64 - shift)) {
+			*pbOverflow = 1;
+			v = ULLONG_MAX;
+			while(++i < len && digitValue(p[i]) < base)
+				/* just skip */;
+			break;
+		}
+		v = (v << shift) | d;
+	}
+	*pVal = v;
+	return i;
+}
+
+/* Parse the magnitude of an integer. Octal ("0" prefix) and hex ("0x"
+ * prefix) are only recognized if bDecOnly is not set.
+ * @returns number of bytes consumed, 0 if there is no number
+ */
+static es_size_t
+scanUInt(const unsigned char *p, es_size_t len, const int bDecOnly, unsigned long long *pVal,
+	int *pbOverflow)
+{
+	if(!bDecOnly && len > 0 && p[0] == '0') {
+		if(len > 2 && p[1] == 'x' && digitValue(p[2]) < 16)
+			return 2 + scanBase(p + 2, len - 2, 4, pVal, pbOverflow);
+		return scanBase(p, len, 3, pVal, pbOverflow);
+	}
+	return scanDec(p, len, pVal, pbOverflow);
+}
+
+
+int
+es_viewParseNum(es_strview_t v, long long *pNum, es_size_t *pLenUsed)
+{
+	unsigned long long mag;
+	long long num = 0;
+	es_size_t i = 0, n;
+	int bNegative = 0, bOverflow = 0;
+	int r = 0;
+
+	if(v.len > 0 && v.buf[0] == '-') {
+		bNegative = 1;
+		i = 1;
+	}
+	/* negative numbers are always decimal */
+	n = scanUInt(v.buf + i, v.len - i, bNegative, &mag, &bOverflow);
+	if(n == 0) {
+		i = 0;
+		r = EINVAL;
+		goto done;
+	}
+	i += n;
+
+	if(bNegative) {
+		if(bOverflow || mag > (unsigned long long) LLONG_MAX + 1) {
+			num = LLONG_MIN;
+			r = ERANGE;
+		} else if(mag == (unsigned long long) LLONG_MAX + 1) {
+			num = LLONG_MIN;
+		} else {
+			num = -(long long) mag;
+		}
+	} else {
+		if(bOverflow || mag > (unsigned long long) LLONG_MAX) {
+			num = LLONG_MAX;
+			r = ERANGE;
+		} else {
+			num = (long long) mag;
+		}
+	}
+
+done:
+	if(pNum != NULL)
+		*pNum = num;
+	if(pLenUsed != NULL)
+		*pLenUsed = i;
+	return r;
+}
+
+
+int
+es_viewParseUNum(es_strview_t v, unsigned long long *pNum, es_size_t *pLenUsed)
+{
+	unsigned long long num = 0;
+	es_size_t i;
+	int bOverflow = 0;
+	int r = 0;
+
+	i = scanUInt(v.buf, v.len, 0, &num, &bOverflow);
+	if(i == 0)
+		r = EINVAL;
+	else if(bOverflow)
+		r = ERANGE;
+
+	if(pNum != NULL)
+		*pNum = num;
+	if(pLenUsed != NULL)
+		*pLenUsed = i;
+	return r;
+}
+
+
+/* Add a run of decimal digits to a mantissa of at most MAX_SAFE_DIGITS
+ * significant digits. *pnKept is set to the number of digits that went
+ * into the mantissa (leading zeros included), the others are dropped.
+ * *pbInexact is set if a non-zero digit was dropped.
+ * @returns number of digits consumed
+ */
+static es_size_t
+scanMantissa(const unsigned char *p, es_size_t len, unsigned long long *pMant, int *pnSig,
+	es_size_t *pnKept, int *pbInexact)
+{
+	es_size_t i = 0;
+	unsigned long long m = *pMant;
+	int nSig = *pnSig;
+
+#	ifdef ES_USE_SWAR
+	while(nSig <= MAX_SAFE_DIGITS - 8 && len - i >= 8) {
+		const unsigned long long w = load8(p + i);
+		unsigned long long blk, t;
+		if(!isEightDigits(w))
+			break;
+		blk = parseEightDigits(w);
+		if(m != 0) {
+			nSig += 8;
+		} else {
+			for(t = blk ; t != 0 ; t /= 10)
+				++nSig;
+		}
+		m = m * 100000000 + blk;
+		i += 8;
+	}
+#	endif
+	while(i < len && nSig < MAX_SAFE_DIGITS && isDecDigit(p[i])) {
+		m = m * 10 + (p[i] - '0');
+		if(m != 0)
+			++nSig;
+		++i;
+	}
+	*pnKept = i;
+	while(i < len && isDecDigit(p[i])) {
+		if(p[i] != '0')
+			*pbInexact = 1;
+		++i;
+	}
+
+	*pMant = m;
+	*pnSig = nSig;
+	return i;
+}
+
+/* Hand a number that can not be converted exactly by us to strtod().
+ * The input has already been validated, we just need to adapt the
+ * decimal point to the current locale.
+ */
+static int
+parseDoubleSlow(const unsigned char *p, es_size_t len, double *pNum)
+{
+	char buf[128];
+	char *cstr = buf;
+	const char *dp = localeconv()->decimal_point;
+	const size_t lenDp = strlen(dp);
+	size_t i, j;
+	int r = 0;
+
+	if(len + lenDp >= sizeof(buf)) {
+		if((cstr = malloc(len + lenDp + 1)) == NULL) {
+			r = ENOMEM;
+			goto done;
+		}
+	}
+	for(i = j = 0 ; i < len ; ++i) {
+		if(p[i] == '.') {
+			memcpy(cstr + j, dp, lenDp);
+			j += lenDp;
+		} else {
+			cstr[j++] = p[i];
+		}
+	}
+	cstr[j] = '\0';
+
+	errno = 0;
+	*pNum = strtod(cstr, NULL);
+	if(errno == ERANGE && (*pNum == HUGE_VAL || *pNum == -HUGE_VAL))
+		r = ERANGE;
+
+	if(cstr != buf)
+		free(cstr);
+done:
+	return r;
+}
+
+int
+es_viewParseDouble(es_strview_t v, double *pNum, es_size_t *pLenUsed)
+{
+	/* all powers of ten up to 1e22 are exact doubles */
+	static const double pow10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+		1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const unsigned char *c = v.buf;
+	unsigned long long mant = 0;
+	long long exp10 = 0, expPart = 0;
+	es_size_t i = 0, j, n, nKept;
+	int nSig = 0, bInexact = 0, bNegative = 0, bNegExp = 0, bHaveDigits = 0;
+	double num = 0.0;
+	int r = 0;
+
+	if(v.len > 0 && c[0] == '-') {
+		bNegative = 1;
+		i = 1;
+	}
+	/* integer part; dropped digits scale the value up */
+	n = scanMantissa(c + i, v.len - i, &mant, &nSig, &nKept, &bInexact);
+	exp10 += n - nKept;
+	bHaveDigits = n > 0;
+	i += n;
+	/* fraction; kept digits scale the value down */
+	if(i < v.len && c[i] == '.') {
+		n = scanMantissa(c + i + 1, v.len - i - 1, &mant, &nSig, &nKept, &bInexact);
+		if(n > 0 || bHaveDigits) {
+			exp10 -= nKept;
+			bHaveDigits = 1;
+			i += 1 + n;
+		}
+	}
+	if(!bHaveDigits) {
+		i = 0;
+		r = EINVAL;
+		goto done;
+	}
+	/* exponent, only used if it has digits */
+	if(i < v.len && (c[i] == 'e' || c[i] == 'E')) {
+		j = i + 1;
+		if(j < v.len && (c[j] == '-' || c[j] == '+')) {
+			bNegExp = c[j] == '-';
+			++j;
+		}
+		if(j < v.len && isDecDigit(c[j])) {
+			for( ; j < v.len && isDecDigit(c[j]) ; ++j) {
+				if(expPart < 100000) /* beyond any double */
+					expPart = expPart * 10 + (c[j] - '0');
+			}
+			exp10 += bNegExp ? -expPart : expPart;
+			i = j;
+		}
+	}
+
+	if(mant == 0) {
+		num = 0.0;
+#	ifdef ES_DOUBLE_FASTPATH
+	} else if(!bInexact && mant <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+		/* both operands are exact, so IEEE rounding gives the exact result */
+		num = (double) mant;
+		num = (exp10 < 0) ? num / pow10[-exp10] : num * pow10[exp10];
+#	endif
+	} else {
+		r = parseDoubleSlow(c + bNegative, i - bNegative, &num);
+	}
+	if(bNegative)
+		num = -num;
+
+done:
+	if(pNum != NULL)
+		*pNum = num;
+	if(pLenUsed != NULL)
+		*pLenUsed = i;
+	return r;
+}
+
+
+long long
+es_view2num(es_strview_t v, int *bSuccess)
+{
+	long long num;
+	es_size_t lenUsed;
+	int r;
+
+	r = es_viewParseNum(v, &num, &lenUsed);
+	if(bSuccess != NULL) {
+		/* a lone "-" has always been accepted as 0 */
+		*bSuccess = (r == 0 && lenUsed == v.len)
+			|| (v.len == 1 && v.buf[0] == '-');
+	}
+	return num;
+}
+
+long long
+es_str2num(es_str_t *s, int *bSuccess)
+{
+	return es_view2num(es_viewFromStr(s), bSuccess);
+}
+
+
+unsigned long long
+es_view2unum(es_strview_t v, int *bSuccess)
+{
+	unsigned long long num;
+	es_size_t lenUsed;
+	int r;
+
+	r = es_viewParseUNum(v, &num, &lenUsed);
+	if(bSuccess != NULL)
+		*bSuccess = (r == 0 && lenUsed == v.len);
+	return num;
+}
+
+unsigned long long
+es_str2unum(es_str_t *s, int *bSuccess)
+{
+	return es_view2unum(es_viewFromStr(s), bSuccess);
+}
+
+
+double
+es_view2double(es_strview_t v, int *bSuccess)
+{
+	double num;
+	es_size_t lenUsed;
+	int r;
+
+	r = es_viewParseDouble(v, &num, &lenUsed);
+	if(bSuccess != NULL)
+		*bSuccess = (r == 0 && lenUsed == v.len);
+	return num;
+}
+
+double
+es_str2double(es_str_t *s, int *bSuccess)
+{
+	return es_view2double(es_viewFromStr(s), bSuccess);
+}
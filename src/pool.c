@@ -0,0 +1,228 @@
+/**
+ * @file pool.c
+ * Implements the per-thread string object pool.
+ *
+ * If enabled, freed string objects are not given back to the system
+ * allocator but kept in a per-thread cache, bucketed by the size class
+ * of their buffer. New strings are then taken from that cache, so
+ * typical create/delete cycles do not touch the (shared) allocator at
+ * all. As pooled blocks are regular malloc()ed blocks, they can still
+ * be realloc()ed and free()d like any other string, so the pool can be
+ * enabled and disabled at any time.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#if defined(HAVE_TLS) && defined(HAVE_PTHREAD_H)
+
+#ifdef ENABLE_POOL_DEFAULT
+int es_int_poolEnabled = 1;
+#else
+int es_int_poolEnabled = 0;
+#endif
+
+/* Buffer sizes (lenBuf) of the size classes. Larger strings are not
+ * pooled, they are usually rare and long-lived.
+ */
+static const es_size_t classSize[] = {
+	16, 32, 48, 64, 80, 96, 112, 128,
+	192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+};
+#define NCLASSES (sizeof(classSize) / sizeof(classSize[0]))
+#define MAX_POOLED 4096
+/* max number of bytes cached per thread and size class */
+#define MAX_CACHED_BYTES (64 * 1024)
+
+struct freeBlock {
+	struct freeBlock *next;
+};
+
+struct poolCache {
+	struct freeBlock *head[NCLASSES];
+	unsigned cnt[NCLASSES];
+};
+
+static __thread struct poolCache *cache = NULL;
+static pthread_key_t cacheKey;
+static pthread_once_t cacheKeyOnce = PTHREAD_ONCE_INIT;
+
+
+static void
+freeCache(void *ptr)
+{
+	struct poolCache *pc = (struct poolCache*) ptr;
+	struct freeBlock *b, *del;
+	unsigned i;
+
+	if(pc == NULL)
+		return;
+	/* we are called in the context of the exiting thread, so this is
+	 * its cache pointer. Reset it, in case the library is used again by
+	 * other thread-specific destructors.
+	 */
+	cache = NULL;
+	for(i = 0 ; i < NCLASSES ; ++i) {
+		for(b = pc->head[i] ; b != NULL ; ) {
+			del = b;
+			b = b->next;
+			free(del);
+		}
+	}
+	free(pc);
+}
+
+static void
+createCacheKey(void)
+{
+	pthread_key_create(&cacheKey, freeCache);
+}
+
+/* get the current thread's cache, create it if required */
+static inline struct poolCache *
+getCache(void)
+{
+	if(cache == NULL) {
+		pthread_once(&cacheKeyOnce, createCacheKey);
+		if((cache = calloc(1, sizeof(struct poolCache))) == NULL)
+			return NULL;
+		/* this makes sure the cache is freed on thread exit */
+		pthread_setspecific(cacheKey, cache);
+	}
+	return cache;
+}
+
+static inline int
+sizeClass(es_size_t len)
+{
+	int i;
+
+	if(len <= 128)
+		return (len == 0) ? 0 : (int) ((len - 1) / 16);
+	for(i = 8 ; len > classSize[i] ; ++i)
+		/* just search */;
+	return i;
+}
+
+
+es_strhdr_t *
+es_int_poolGet(es_size_t *pLen)
+{
+	struct poolCache *pc;
+	struct freeBlock *b;
+	int i;
+
+	if(*pLen > MAX_POOLED)
+		return NULL;
+	i = sizeClass(*pLen);
+	*pLen = classSize[i];
+	if((pc = getCache()) == NULL || (b = pc->head[i]) == NULL)
+		return NULL;
+	pc->head[i] = b->next;
+	--pc->cnt[i];
+	return (es_strhdr_t*) b;
+}
+
+
+int
+es_int_poolPut(es_strhdr_t *h, es_size_t lenBuf)
+{
+	struct poolCache *pc;
+	struct freeBlock *b;
+	int i;
+
+	if(lenBuf > MAX_POOLED)
+		return 0;
+	i = sizeClass(lenBuf);
+	if(classSize[i] != lenBuf)
+		return 0; /* not a block of exactly this class */
+	if((pc = getCache()) == NULL || pc->cnt[i] >= MAX_CACHED_BYTES / lenBuf)
+		return 0;
+	b = (struct freeBlock*) h;
+	b->next = pc->head[i];
+	pc->head[i] = b;
+	++pc->cnt[i];
+	return 1;
+}
+
+
+int
+es_initPool(void)
+{
+	es_int_poolEnabled = 1;
+	return 0;
+}
+
+
+void
+es_exitPool(void)
+{
+	es_int_poolEnabled = 0;
+	if(cache != NULL) {
+		pthread_setspecific(cacheKey, NULL);
+		freeCache(cache);
+	}
+}
+
+#else /* #if defined(HAVE_TLS) && defined(HAVE_PTHREAD_H) */
+
+/* no thread-local storage, so no pool. We can not use a global pool,
+ * as that would bring back the contention we want to avoid.
+ */
+int es_int_poolEnabled = 0;
+
+es_strhdr_t *
+es_int_poolGet(es_size_t *pLen)
+{
+	(void) pLen;
+	return NULL;
+}
+
+int
+es_int_poolPut(es_strhdr_t *h, es_size_t lenBuf)
+{
+	(void) h;
+	(void) lenBuf;
+	return 0;
+}
+
+int
+es_initPool(void)
+{
+	return ENOTSUP;
+}
+
+void
+es_exitPool(void)
+{
+}
+
+#endif /* #if defined(HAVE_TLS) && defined(HAVE_PTHREAD_H) */
@@ -0,0 +1,289 @@
+/**
+ * @file rope.c
+ * Implements the rope (chunk list) string builder.
+ *
+ * Data appended to a rope is copied into fixed-size chunks, which are
+ * linked into a list. So, in contrast to es_addBuf(), the data already
+ * in the rope is never moved. Large strings are not copied at all, but
+ * referenced via es_strshare(). The rope is only converted into a
+ * contiguous string if the caller asks for it; for output, its chunks
+ * can be handed to writev() directly.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#define DEFAULT_CHUNK_SIZE (64 * 1024)
+
+struct ropeChunk {
+	struct ropeChunk *next;
+	es_str_t *ref;		/**< referenced string, NULL for data chunks */
+	es_size_t size;		/**< size of data buffer */
+	es_size_t used;		/**< bytes used in data buffer; for references
+				     the string length when it was added */
+	/* NOTE: for data chunks, the data is placed AFTER the last data
+	 * element, just like with es_str_t.
+	 */
+};
+
+struct es_rope_s {
+	struct ropeChunk *head;
+	struct ropeChunk *tail;
+	es_size_t chunkSize;	/**< size of data chunks */
+	es_size_t len;		/**< total length of rope contents */
+	int nChunks;
+};
+
+static inline unsigned char *
+chunkData(struct ropeChunk *c)
+{
+	return ((unsigned char*) c) + sizeof(struct ropeChunk);
+}
+
+static inline unsigned char *
+chunkBuf(struct ropeChunk *c)
+{
+	return (c->ref == NULL) ? chunkData(c) : es_getBufAddr(c->ref);
+}
+
+/* for references, this is a snapshot: direct writes to the string must
+ * not change the rope's length accounting
+ */
+static inline es_size_t
+chunkLen(struct ropeChunk *c)
+{
+	return c->used;
+}
+
+
+static void
+freeChunk(struct ropeChunk *c)
+{
+	es_deleteStr(c->ref);
+	free(c);
+}
+
+
+static inline void
+appendChunk(es_rope_t *rope, struct ropeChunk *c)
+{
+	c->next = NULL;
+	if(rope->tail == NULL)
+		rope->head = c;
+	else
+		rope->tail->next = c;
+	rope->tail = c;
+	++rope->nChunks;
+}
+
+
+es_rope_t *
+es_newRope(es_size_t chunkSize)
+{
+	es_rope_t *rope;
+
+	if((rope = calloc(1, sizeof(es_rope_t))) == NULL)
+		goto done;
+	rope->chunkSize = (chunkSize == 0) ? DEFAULT_CHUNK_SIZE : chunkSize;
+
+done:
+	return rope;
+}
+
+
+void
+es_deleteRope(es_rope_t *rope)
+{
+	struct ropeChunk *c, *del;
+
+	if(rope == NULL)
+		return;
+	for(c = rope->head ; c != NULL ; ) {
+		del = c;
+		c = c->next;
+		freeChunk(del);
+	}
+	free(rope);
+}
+
+
+void
+es_resetRope(es_rope_t *rope)
+{
+	struct ropeChunk *c, *del;
+	struct ropeChunk *keep = NULL;
+
+	/* we keep one data chunk, so that the next round of appends does
+	 * not need to go to malloc() again.
+	 */
+	for(c = rope->head ; c != NULL ; ) {
+		del = c;
+		c = c->next;
+		if(keep == NULL && del->ref == NULL) {
+			keep = del;
+		} else {
+			freeChunk(del);
+		}
+	}
+	rope->head = rope->tail = NULL;
+	rope->len = 0;
+	rope->nChunks = 0;
+	if(keep != NULL) {
+		keep->used = 0;
+		appendChunk(rope, keep);
+	}
+}
+
+
+int
+es_ropeAddBuf(es_rope_t *rope, const char *buf, es_size_t lenBuf)
+{
+	int r = 0;
+	struct ropeChunk *c;
+	es_size_t toCopy;
+
+	if(rope->len + lenBuf < rope->len) {
+		r = ENOMEM;
+		goto done;
+	}
+
+	while(lenBuf > 0) {
+		c = rope->tail;
+		if(c == NULL || c->ref != NULL || c->used == c->size) {
+			if((c = malloc(sizeof(struct ropeChunk) + rope->chunkSize)) == NULL) {
+				r = ENOMEM;
+				goto done;
+			}
+			c->ref = NULL;
+			c->size = rope->chunkSize;
+			c->used = 0;
+			appendChunk(rope, c);
+		}
+		toCopy = c->size - c->used;
+		if(toCopy > lenBuf)
+			toCopy = lenBuf;
+		memcpy(chunkData(c) + c->used, buf, toCopy);
+		c->used += toCopy;
+		rope->len += toCopy;
+		buf += toCopy;
+		lenBuf -= toCopy;
+	}
+
+done:
+	return r;
+}
+
+
+int
+es_ropeAddStr(es_rope_t *rope, es_str_t *s)
+{
+	int r = 0;
+	struct ropeChunk *c;
+
+	/* small strings are cheaper to copy than to reference; without
+	 * COW mode, the caller did not agree to the sharing rules
+	 */
+	if(!es_int_bCOWMode || es_strlen(s) < rope->chunkSize / 4) {
+		r = es_ropeAddBuf(rope, (char*) es_getBufAddr(s), es_strlen(s));
+		goto done;
+	}
+
+	if(rope->len + es_strlen(s) < rope->len) {
+		r = ENOMEM;
+		goto done;
+	}
+	if((c = malloc(sizeof(struct ropeChunk))) == NULL) {
+		r = ENOMEM;
+		goto done;
+	}
+	if((c->ref = es_strshare(s)) == NULL) {
+		free(c);
+		r = ENOMEM;
+		goto done;
+	}
+	c->size = 0;
+	c->used = es_strlen(s);
+	appendChunk(rope, c);
+	rope->len += c->used;
+
+done:
+	return r;
+}
+
+
+es_size_t
+es_ropeLen(es_rope_t *rope)
+{
+	return rope->len;
+}
+
+
+int
+es_ropeNumChunks(es_rope_t *rope)
+{
+	return rope->nChunks;
+}
+
+
+es_str_t *
+es_ropeFlatten(es_rope_t *rope)
+{
+	struct ropeChunk *c;
+	es_str_t *s;
+	unsigned char *p;
+
+	if((s = es_newStr(rope->len)) == NULL)
+		goto done;
+	p = es_getBufAddr(s);
+	for(c = rope->head ; c != NULL ; c = c->next) {
+		memcpy(p, chunkBuf(c), chunkLen(c));
+		p += chunkLen(c);
+	}
+	s->lenStr = rope->len;
+
+done:
+	return s;
+}
+
+
+int
+es_ropeIovec(es_rope_t *rope, struct iovec *iov, int nIov)
+{
+	struct ropeChunk *c;
+	int i = 0;
+
+	for(c = rope->head ; c != NULL && i < nIov ; c = c->next) {
+		if(chunkLen(c) == 0)
+			continue; /* kept chunk of a reset rope */
+		iov[i].iov_base = chunkBuf(c);
+		iov[i].iov_len = chunkLen(c);
+		++i;
+	}
+	return i;
+}
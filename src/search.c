@@ -0,0 +1,321 @@
+/**
+ * @file search.c
+ * Implements the substring search engine.
+ *
+ * The vectorized engines use the "first and last byte" candidate filter:
+ * for each block of haystack positions, we compare the first needle byte
+ * against the block and the last needle byte against the block shifted
+ * by the needle length. Only positions where both match are candidates
+ * that need a full compare. For typical log data, this rejects almost
+ * all positions with two vector compares per 16 (or 32) bytes.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#ifdef ES_USE_SSE2
+#	include <emmintrin.h>
+#endif
+#ifdef ES_USE_AVX2
+#	include <immintrin.h>
+#endif
+
+
+/* ASCII-only lower case table. We intentionally do not use tolower(),
+ * because it depends on the locale, is a function call per byte and
+ * makes vectorizing impossible.
+ */
+const unsigned char es_int_asciiLower[256] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+	0x40, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+	0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+	0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+	0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+	0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+
+/* Scalar search, also used for the tail of the vectorized versions.
+ * memchr() is usually well optimized by the C library, so we use it
+ * to find candidates for the first needle byte. Caller must ensure that
+ * lenNeedle > 0 and lenNeedle <= lenHay.
+ */
+static int
+findBuf_scalar(const unsigned char *hay, size_t lenHay,
+	const unsigned char *needle, size_t lenNeedle, size_t start)
+{
+	const unsigned char *p;
+	const unsigned char *end;
+	int r = -1;
+
+	p = hay + start;
+	end = hay + (lenHay - lenNeedle + 1); /* one past last candidate */
+	while(p < end && (p = memchr(p, needle[0], end - p)) != NULL) {
+		if(memcmp(p + 1, needle + 1, lenNeedle - 1) == 0) {
+			r = p - hay;
+			break;
+		}
+		++p;
+	}
+	return r;
+}
+
+
+#ifdef ES_USE_SSE2
+static int
+findBuf_sse2(const unsigned char *hay, size_t lenHay,
+	const unsigned char *needle, size_t lenNeedle)
+{
+	const __m128i first = _mm_set1_epi8((char) needle[0]);
+	const __m128i last = _mm_set1_epi8((char) needle[lenNeedle - 1]);
+	__m128i blkFirst, blkLast;
+	unsigned mask;
+	size_t i;
+	int bit;
+
+	for(i = 0 ; i + lenNeedle - 1 + 16 <= lenHay ; i += 16) {
+		blkFirst = _mm_loadu_si128((const __m128i*) (hay + i));
+		blkLast = _mm_loadu_si128((const __m128i*) (hay + i + lenNeedle - 1));
+		mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blkFirst),
+						       _mm_cmpeq_epi8(last, blkLast)));
+		while(mask != 0) {
+			bit = __builtin_ctz(mask);
+			if(memcmp(hay + i + bit + 1, needle + 1, lenNeedle - 2) == 0)
+				return (int) (i + bit);
+			mask &= mask - 1;
+		}
+	}
+	return findBuf_scalar(hay, lenHay, needle, lenNeedle, i);
+}
+#endif /* #ifdef ES_USE_SSE2 */
+
+
+#ifdef ES_USE_AVX2
+__attribute__((target("avx2")))
+static int
+findBuf_avx2(const unsigned char *hay, size_t lenHay,
+	const unsigned char *needle, size_t lenNeedle)
+{
+	const __m256i first = _mm256_set1_epi8((char) needle[0]);
+	const __m256i last = _mm256_set1_epi8((char) needle[lenNeedle - 1]);
+	__m256i blkFirst, blkLast;
+	unsigned mask;
+	size_t i;
+	int bit;
+
+	for(i = 0 ; i + lenNeedle - 1 + 32 <= lenHay ; i += 32) {
+		blkFirst = _mm256_loadu_si256((const __m256i*) (hay + i));
+		blkLast = _mm256_loadu_si256((const __m256i*) (hay + i + lenNeedle - 1));
+		mask = (unsigned) _mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(first, blkFirst),
+					 _mm256_cmpeq_epi8(last, blkLast)));
+		while(mask != 0) {
+			bit = __builtin_ctz(mask);
+			if(memcmp(hay + i + bit + 1, needle + 1, lenNeedle - 2) == 0)
+				return (int) (i + bit);
+			mask &= mask - 1;
+		}
+	}
+	return findBuf_scalar(hay, lenHay, needle, lenNeedle, i);
+}
+#endif /* #ifdef ES_USE_AVX2 */
+
+
+int
+es_int_findBuf(const unsigned char *hay, es_size_t lenHay,
+	const unsigned char *needle, es_size_t lenNeedle)
+{
+	int r;
+
+	if(lenNeedle > lenHay) {
+		/* can not be contained ;) */
+		r = -1;
+	} else if(lenNeedle == 0) {
+		r = 0; /* the empty string is contained everywhere */
+	} else if(lenNeedle == 1) {
+		const unsigned char *p = memchr(hay, needle[0], lenHay);
+		r = (p == NULL) ? -1 : (int) (p - hay);
+	} else {
+#		if defined(ES_USE_AVX2)
+		if(es_int_haveAVX2())
+			r = findBuf_avx2(hay, lenHay, needle, lenNeedle);
+		else
+			r = findBuf_sse2(hay, lenHay, needle, lenNeedle);
+#		elif defined(ES_USE_SSE2)
+		r = findBuf_sse2(hay, lenHay, needle, lenNeedle);
+#		else
+		r = findBuf_scalar(hay, lenHay, needle, lenNeedle, 0);
+#		endif
+	}
+	return r;
+}
+
+
+/* ---------- case-insensitive search ---------- */
+
+/* Scalar case-insensitive search, also used for the tail of the
+ * vectorized versions. Same preconditions as findBuf_scalar().
+ */
+static int
+findBufCase_scalar(const unsigned char *hay, size_t lenHay,
+	const unsigned char *needle, size_t lenNeedle, size_t start)
+{
+	const unsigned char first = es_int_asciiLower[needle[0]];
+	const size_t max = lenHay - lenNeedle + 1;
+	size_t i;
+	int r = -1;
+
+	for(i = start ; i < max ; ++i) {
+		if(es_int_asciiLower[hay[i]] == first
+		   && es_int_memcaseeq(hay + i + 1, needle + 1, lenNeedle - 1)) {
+			r = (int) i;
+			break;
+		}
+	}
+	return r;
+}
+
+
+#ifdef ES_USE_SSE2
+/* We compare each block against the upper and lower case version of the
+ * first and last needle bytes. For non-letters, both are the same, which
+ * costs a redundant compare but keeps the loop branch-free.
+ */
+static int
+findBufCase_sse2(const unsigned char *hay, size_t lenHay,
+	const unsigned char *needle, size_t lenNeedle)
+{
+	const unsigned char f = es_int_asciiLower[needle[0]];
+	const unsigned char l = es_int_asciiLower[needle[lenNeedle - 1]];
+	const __m128i firstLo = _mm_set1_epi8((char) f);
+	const __m128i firstUp = _mm_set1_epi8((char) es_int_asciiUpper(f));
+	const __m128i lastLo = _mm_set1_epi8((char) l);
+	const __m128i lastUp = _mm_set1_epi8((char) es_int_asciiUpper(l));
+	__m128i blkFirst, blkLast, eqFirst, eqLast;
+	unsigned mask;
+	size_t i;
+	int bit;
+
+	for(i = 0 ; i + lenNeedle - 1 + 16 <= lenHay ; i += 16) {
+		blkFirst = _mm_loadu_si128((const __m128i*) (hay + i));
+		blkLast = _mm_loadu_si128((const __m128i*) (hay + i + lenNeedle - 1));
+		eqFirst = _mm_or_si128(_mm_cmpeq_epi8(firstLo, blkFirst),
+				       _mm_cmpeq_epi8(firstUp, blkFirst));
+		eqLast = _mm_or_si128(_mm_cmpeq_epi8(lastLo, blkLast),
+				      _mm_cmpeq_epi8(lastUp, blkLast));
+		mask = _mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast));
+		while(mask != 0) {
+			bit = __builtin_ctz(mask);
+			if(es_int_memcaseeq(hay + i + bit + 1, needle + 1, lenNeedle - 2))
+				return (int) (i + bit);
+			mask &= mask - 1;
+		}
+	}
+	return findBufCase_scalar(hay, lenHay, needle, lenNeedle, i);
+}
+#endif /* #ifdef ES_USE_SSE2 */
+
+
+#ifdef ES_USE_AVX2
+__attribute__((target("avx2")))
+static int
+findBufCase_avx2(const unsigned char *hay, size_t lenHay,
+	const unsigned char *needle, size_t lenNeedle)
+{
+	const unsigned char f = es_int_asciiLower[needle[0]];
+	const unsigned char l = es_int_asciiLower[needle[lenNeedle - 1]];
+	const __m256i firstLo = _mm256_set1_epi8((char) f);
+	const __m256i firstUp = _mm256_set1_epi8((char) es_int_asciiUpper(f));
+	const __m256i lastLo = _mm256_set1_epi8((char) l);
+	const __m256i lastUp = _mm256_set1_epi8((char) es_int_asciiUpper(l));
+	__m256i blkFirst, blkLast, eqFirst, eqLast;
+	unsigned mask;
+	size_t i;
+	int bit;
+
+	for(i = 0 ; i + lenNeedle - 1 + 32 <= lenHay ; i += 32) {
+		blkFirst = _mm256_loadu_si256((const __m256i*) (hay + i));
+		blkLast = _mm256_loadu_si256((const __m256i*) (hay + i + lenNeedle - 1));
+		eqFirst = _mm256_or_si256(_mm256_cmpeq_epi8(firstLo, blkFirst),
+					  _mm256_cmpeq_epi8(firstUp, blkFirst));
+		eqLast = _mm256_or_si256(_mm256_cmpeq_epi8(lastLo, blkLast),
+					 _mm256_cmpeq_epi8(lastUp, blkLast));
+		mask = (unsigned) _mm256_movemask_epi8(_mm256_and_si256(eqFirst, eqLast));
+		while(mask != 0) {
+			bit = __builtin_ctz(mask);
+			if(es_int_memcaseeq(hay + i + bit + 1, needle + 1, lenNeedle - 2))
+				return (int) (i + bit);
+			mask &= mask - 1;
+		}
+	}
+	return findBufCase_scalar(hay, lenHay, needle, lenNeedle, i);
+}
+#endif /* #ifdef ES_USE_AVX2 */
+
+
+int
+es_int_findBufCase(const unsigned char *hay, es_size_t lenHay,
+	const unsigned char *needle, es_size_t lenNeedle)
+{
+	int r;
+
+	if(lenNeedle > lenHay) {
+		r = -1;
+	} else if(lenNeedle == 0) {
+		r = 0;
+	} else if(lenNeedle == 1) {
+		if(es_int_asciiUpper(needle[0]) == es_int_asciiLower[needle[0]]) {
+			/* no letter, so case does not matter */
+			const unsigned char *p = memchr(hay, needle[0], lenHay);
+			r = (p == NULL) ? -1 : (int) (p - hay);
+		} else {
+			r = findBufCase_scalar(hay, lenHay, needle, lenNeedle, 0);
+		}
+	} else {
+#		if defined(ES_USE_AVX2)
+		if(es_int_haveAVX2())
+			r = findBufCase_avx2(hay, lenHay, needle, lenNeedle);
+		else
+			r = findBufCase_sse2(hay, lenHay, needle, lenNeedle);
+#		elif defined(ES_USE_SSE2)
+		r = findBufCase_sse2(hay, lenHay, needle, lenNeedle);
+#		else
+		r = findBufCase_scalar(hay, lenHay, needle, lenNeedle, 0);
+#		endif
+	}
+	return r;
+}
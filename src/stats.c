@@ -0,0 +1,151 @@
+/**
+ * @file stats.c
+ * Implements allocation statistics.
+ *
+ * Each thread counts into its own cache line aligned block, so that
+ * counting needs neither locks nor atomic operations. The blocks are
+ * kept in a list, which es_getStats() walks to sum them up. When a
+ * thread terminates, its counts are added to the "retired" totals.
+ * Statistics are only available if libestr was configured with
+ * --enable-stats.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef HAVE_PTHREAD_H
+#	include <pthread.h>
+#endif
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#ifdef ES_USE_STATS
+
+#define CACHE_LINE_SIZE 64
+
+__thread struct es_int_statsBlock *es_int_tlsStats = NULL;
+
+static pthread_mutex_t mutStats = PTHREAD_MUTEX_INITIALIZER;
+static struct es_int_statsBlock *blocks = NULL;	/**< blocks of live threads */
+static es_stats_t retired;			/**< sum of terminated threads */
+static pthread_key_t statsKey;
+static pthread_once_t statsKeyOnce = PTHREAD_ONCE_INIT;
+
+
+static void
+addStats(es_stats_t *sum, const es_stats_t *st)
+{
+	int i;
+
+	sum->nAlloc += st->nAlloc;
+	sum->nFree += st->nFree;
+	sum->bytesLive += st->bytesLive;
+	sum->nRealloc += st->nRealloc;
+	sum->bytesCopied += st->bytesCopied;
+	for(i = 0 ; i < ES_STATS_NBUCKETS ; ++i) {
+		sum->slackHist[i] += st->slackHist[i];
+		sum->growthHist[i] += st->growthHist[i];
+	}
+}
+
+static void
+retireBlock(void *ptr)
+{
+	struct es_int_statsBlock *b = (struct es_int_statsBlock*) ptr;
+
+	if(b == NULL)
+		return;
+	/* other thread-specific destructors may still use the library,
+	 * they will get a new block (and this destructor is called again).
+	 */
+	es_int_tlsStats = NULL;
+	pthread_mutex_lock(&mutStats);
+	addStats(&retired, &b->st);
+	if(b->prev == NULL)
+		blocks = b->next;
+	else
+		b->prev->next = b->next;
+	if(b->next != NULL)
+		b->next->prev = b->prev;
+	pthread_mutex_unlock(&mutStats);
+	free(b);
+}
+
+static void
+createStatsKey(void)
+{
+	pthread_key_create(&statsKey, retireBlock);
+}
+
+
+struct es_int_statsBlock *
+es_int_statsInit(void)
+{
+	struct es_int_statsBlock *b;
+	void *mem;
+	const size_t size = (sizeof(struct es_int_statsBlock) + CACHE_LINE_SIZE - 1)
+			    & ~((size_t) CACHE_LINE_SIZE - 1);
+
+	pthread_once(&statsKeyOnce, createStatsKey);
+	if(posix_memalign(&mem, CACHE_LINE_SIZE, size) != 0)
+		return NULL;
+	b = (struct es_int_statsBlock*) mem;
+	memset(b, 0, size);
+	pthread_mutex_lock(&mutStats);
+	b->next = blocks;
+	if(blocks != NULL)
+		blocks->prev = b;
+	blocks = b;
+	pthread_mutex_unlock(&mutStats);
+	es_int_tlsStats = b;
+	/* this makes sure the counts are retired on thread exit */
+	pthread_setspecific(statsKey, b);
+	return b;
+}
+
+
+int
+es_getStats(es_stats_t *st)
+{
+	struct es_int_statsBlock *b;
+
+	pthread_mutex_lock(&mutStats);
+	*st = retired;
+	for(b = blocks ; b != NULL ; b = b->next)
+		addStats(st, &b->st);
+	pthread_mutex_unlock(&mutStats);
+	return 0;
+}
+
+#else /* #ifdef ES_USE_STATS */
+
+int
+es_getStats(es_stats_t *st)
+{
+	memset(st, 0, sizeof(es_stats_t));
+	return ENOTSUP;
+}
+
+#endif /* #ifdef ES_USE_STATS */
@@ -30,6 +30,7 @@
  */
 #include "config.h"
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
@@ -37,6 +38,7 @@
 #include <limits.h>
 
 #include "libestr.h"
+#include "libestr_int.h"
 
 #define ERR_ABORT {r = 1; goto done; }
 
@@ -55,10 +57,93 @@
 
 /* ------------------------------ HELPERS ------------------------------ */
 
+/* the default reproduces the classic "double the buffer" behaviour */
+es_growthPolicy_t es_int_growthPolicy = { 200, 0, 0 };
+
+static inline const es_growthPolicy_t *
+policyOf(es_str_t *s)
+{
+	const es_growthPolicy_t *p = NULL;
+
+	if(es_int_hdr(s)->flags & ES_STRF_ARENA)
+		p = es_int_arenaPolicy(s);
+	return (p == NULL) ? &es_int_growthPolicy : p;
+}
+
+/**
+ * Change the buffer size of a string. The caller must own the string
+ * exclusively and newSize must be rounded according to the policy.
+ * Growing and shrinking is supported, but newSize must not be smaller
+ * than the string length.
+ * @returns 0 on success, something else otherwise
+ */
+static int
+resizeBuf(es_str_t **ps, es_size_t newSize)
+{
+	int r = 0;
+	es_str_t *s = *ps;
+	es_strhdr_t *h;
+	es_strhdr_t *oldHdr;
+	es_size_t oldSize;
+	es_size_t newAlloc;
+
+	if(es_int_hdr(s)->flags & ES_STRF_ARENA) {
+		r = es_int_arenaResize(ps, newSize);
+		goto done;
+	}
+
+	if(es_int_poolEnabled) {
+		/* for small strings, copying into a pooled block is cheaper
+		 * than going to the allocator.
+		 */
+		if((h = es_int_poolGet(&newSize)) != NULL) {
+			if(newSize == s->lenBuf) {
+				/* rounded up to the size we already have */
+				es_int_poolPut(h, newSize);
+				goto done;
+			}
+			h->flags = 0;
+			h->u.refcnt = 0;
+#			ifdef ES_USE_STATS
+			h->nGrowths = es_int_hdr(s)->nGrowths;
+#			endif
+			ES_STATS_RESIZE(h, s->lenBuf, newSize, s->lenStr);
+			memcpy(es_int_strFromHdr(h), s, sizeof(es_str_t) + s->lenStr);
+			if(!es_int_poolPut(es_int_hdr(s), s->lenBuf))
+				free(es_int_hdr(s));
+			s = es_int_strFromHdr(h);
+			s->lenBuf = newSize;
+			*ps = s;
+			goto done;
+		}
+	}
+
+	newAlloc = newSize + sizeof(es_strhdr_t) + sizeof(es_str_t);
+	if(newAlloc < newSize) { /* overflow? */
+		r = ENOMEM;
+		goto done;
+	}
+
+	oldHdr = es_int_hdr(s);
+	oldSize = s->lenBuf;
+	if((h = realloc(oldHdr, newAlloc)) == NULL) {
+		r = errno;
+		goto done;
+	}
+	s = es_int_strFromHdr(h);
+	ES_STATS_RESIZE(h, oldSize, newSize, (h == oldHdr) ? 0 : s->lenStr);
+	s->lenBuf = newSize;
+	*ps = s;
+
+done:
+	return r;
+}
+
 /**
  * Extend string buffer.
  * This is called if the size is insufficient. Note that the string
- * pointer will be changed.
+ * pointer will be changed. The new size is computed according to the
+ * growth policy.
  * @param[in/out] ps pointer to (pointo to) string to be extened
  * @param[in] minNeeded minimum number of additional bytes needed
  * @returns 0 on success, something else otherwise
@@ -68,37 +153,245 @@ es_extendBuf(es_str_t **ps, es_size_t minNeeded)
 {
 	int r = 0;
 	es_str_t *s = *ps;
+	const es_growthPolicy_t *p;
+	unsigned long long inc;
 	es_size_t newSize;
-	es_size_t newAlloc;
 
 	ASSERT_STR(s);
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
+	s = *ps;
+	p = policyOf(s);
 	/* first compute the new size needed */
-	if(minNeeded > s->lenBuf) {
-		newSize = s->lenBuf + minNeeded;
+	inc = (unsigned long long) s->lenBuf * (p->factor - 100) / 100;
+	if(p->maxIncrement != 0 && inc > p->maxIncrement)
+		inc = p->maxIncrement;
+	if(inc < minNeeded)
+		inc = minNeeded;
+	if(s->lenBuf + inc > (es_size_t)-1) {
+		newSize = (es_size_t)-1;
 	} else {
-		if (s->lenBuf > ((es_size_t)-1) / 2) {
-			newSize = (es_size_t)-1;
-		} else {
-			newSize = 2 * s->lenBuf;
-		}
+		newSize = s->lenBuf + (es_size_t) inc;
 	}
-	if(newSize < minNeeded || newSize < s->lenBuf) { /* overflow? */
+	if(newSize - s->lenBuf < minNeeded) { /* overflow? */
+		r = ENOMEM;
+		goto done;
+	}
+	if(newSize == 0)
+		goto done; /* empty buffer and nothing needed */
+	if((newSize = es_int_roundSize(p, newSize)) == 0) {
 		r = ENOMEM;
 		goto done;
 	}
 
-	newAlloc = newSize + sizeof(es_str_t);
-	if(newAlloc < newSize) { /* overflow? */
+	r = resizeBuf(ps, newSize);
+
+done:
+	return r;
+}
+
+
+int
+es_reserve(es_str_t **ps, es_size_t need)
+{
+	int r = 0;
+	es_str_t *s;
+	es_size_t newSize;
+
+	ASSERT_STR(*ps);
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
+	s = *ps;
+	if(s->lenBuf - s->lenStr >= need)
+		goto done;
+	newSize = s->lenStr + need;
+	if(newSize < need || (newSize = es_int_roundSize(policyOf(s), newSize)) == 0) {
 		r = ENOMEM;
 		goto done;
 	}
+	r = resizeBuf(ps, newSize);
 
-	if((s = realloc(s, newAlloc)) == NULL) {
-		r = errno;
+done:
+	return r;
+}
+
+
+int
+es_shrinkToFit(es_str_t **ps)
+{
+	int r = 0;
+	es_str_t *s = *ps;
+	es_strhdr_t *h = es_int_hdr(s);
+	es_size_t newSize;
+
+	ASSERT_STR(s);
+	/* other owners still reference the object, so we must not move it */
+	if(h->flags & ES_STRF_INTERNED)
+		goto done;
+	if((h->flags & ES_STRF_SHARED) && ES_ATOMIC_FETCH_ADD(&h->u.refcnt, 0) != 0)
+		goto done;
+	newSize = es_int_roundSize(policyOf(s), s->lenStr);
+	if(newSize == 0 && s->lenStr != 0)
+		goto done; /* can not round, so keep what we have */
+	if(newSize < s->lenBuf)
+		r = resizeBuf(ps, newSize);
+
+done:
+	return r;
+}
+
+
+int
+es_setGrowthPolicy(const es_growthPolicy_t *p)
+{
+	const es_growthPolicy_t dflt = { 200, 0, 0 };
+
+	if(p == NULL)
+		p = &dflt;
+	if(p->factor < 100 || p->factor > 1000)
+		return EINVAL;
+	es_int_growthPolicy = *p;
+	return 0;
+}
+
+
+void
+es_getGrowthPolicy(es_growthPolicy_t *p)
+{
+	*p = es_int_growthPolicy;
+}
+
+
+int
+es_int_unshare(es_str_t **ps)
+{
+	int r = 0;
+	es_str_t *s = *ps;
+	es_str_t *n;
+	es_strhdr_t *h = es_int_hdr(s);
+
+	if(ES_ATOMIC_FETCH_ADD(&h->u.refcnt, 0) == 0) {
+		/* all other owners are gone, so the string is ours again */
+		h->flags &= ~ES_STRF_SHARED;
 		goto done;
 	}
-	s->lenBuf = newSize;
-	*ps = s;
+	if((n = es_newStr(s->lenBuf)) == NULL) {
+		r = ENOMEM;
+		goto done;
+	}
+	memcpy(es_getBufAddr(n), es_getBufAddr(s), s->lenStr);
+	n->lenStr = s->lenStr;
+	es_deleteStr(s); /* drops our reference */
+	*ps = n;
+
+done:
+	return r;
+}
+
+
+
+void
+es_int_sharedModifyAbort(const char *func)
+{
+	fprintf(stderr, "libestr: %s() called on a shared string, use "
+		"es_unshareStr() or the COW variant first\n", func);
+	abort();
+}
+
+
+/* two decimal digits per entry, so we need only half the divisions */
+static const char digitPairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static inline es_size_t
+countDigits(unsigned long long v)
+{
+	es_size_t n = 1;
+
+	for(;;) {
+		if(v < 10) return n;
+		if(v < 100) return n + 1;
+		if(v < 1000) return n + 2;
+		if(v < 10000) return n + 3;
+		v /= 10000;
+		n += 4;
+	}
+}
+
+static inline es_size_t
+countHexDigits(unsigned long long v)
+{
+	es_size_t n = 1;
+
+	while(v >= 16) {
+		v >>= 4;
+		++n;
+	}
+	return n;
+}
+
+/* Append a formatted number. As we know the number of digits in
+ * advance, we can write them directly to their final place (right
+ * to left), without any temporary buffer.
+ */
+static int
+addNumber(es_str_t **ps, unsigned long long v, int bNegative, int bHex, es_size_t minDigits)
+{
+	int r;
+	es_str_t *s;
+	es_size_t nDigits, nPad, len;
+	unsigned char *p;
+	unsigned idx;
+
+	nDigits = bHex ? countHexDigits(v) : countDigits(v);
+	nPad = (minDigits > nDigits) ? minDigits - nDigits : 0;
+	len = nPad + nDigits + (bNegative ? 1 : 0);
+	if(len < nPad) {
+		r = ENOMEM;
+		goto done;
+	}
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
+	if((r = es_int_reserve(ps, len)) != 0)
+		goto done;
+	s = *ps;
+
+	p = es_getBufAddr(s) + s->lenStr;
+	if(bNegative)
+		*p++ = '-';
+	memset(p, '0', nPad);
+	p += nPad + nDigits;
+	if(bHex) {
+		do {
+			*--p = "0123456789abcdef"[v & 0x0f];
+			v >>= 4;
+		} while(v != 0);
+	} else {
+		while(v >= 100) {
+			idx = (unsigned) (v % 100) * 2;
+			v /= 100;
+			*--p = digitPairs[idx + 1];
+			*--p = digitPairs[idx];
+		}
+		if(v >= 10) {
+			idx = (unsigned) v * 2;
+			*--p = digitPairs[idx + 1];
+			*--p = digitPairs[idx];
+		} else {
+			*--p = (unsigned char) ('0' + v);
+		}
+	}
+	s->lenStr += len;
+	ES_INVALIDATE_HASH(s);
 
 done:
 	return r;
@@ -107,26 +400,41 @@ done:
 
 /* ------------------------------ END HELPERS ------------------------------ */
 
+/* if set, es_strdup() shares instead of copying */
+int es_int_bCOWMode = 0;
+
 es_str_t *
 es_newStr(es_size_t lenhint)
 {
 	es_str_t *s;
-	/* we round length to a multiple of 8 in the hope to reduce
-	 * memory fragmentation.
+	es_strhdr_t *h;
+	es_size_t lenBuf;
+	/* we round length (to a multiple of 8 by default) in the hope to
+	 * reduce memory fragmentation.
 	 */
-	if(lenhint > (es_size_t)-8) { /* overflow check for alignment */
+	lenBuf = es_int_roundSize(&es_int_growthPolicy, lenhint);
+	if(lenBuf == 0 && lenhint != 0) { /* overflow? */
 		s = NULL;
 		goto done;
 	}
-	if(lenhint & 0x07)
-		lenhint = lenhint - (lenhint & 0x07) + 8;
+	lenhint = lenBuf;
 
-	if(sizeof(es_str_t) + lenhint < lenhint) { /* overflow? */
+	if(sizeof(es_strhdr_t) + sizeof(es_str_t) + lenhint < lenhint) { /* overflow? */
 		s = NULL;
 		goto done;
 	}
-	if((s = malloc(sizeof(es_str_t) + lenhint)) == NULL)
+	if(es_int_poolEnabled)
+		h = es_int_poolGet(&lenhint);
+	else
+		h = NULL;
+	if(h == NULL && (h = malloc(sizeof(es_strhdr_t) + sizeof(es_str_t) + lenhint)) == NULL) {
+		s = NULL;
 		goto done;
+	}
+	h->flags = 0;
+	h->u.refcnt = 0;
+	ES_STATS_ALLOC(h, lenhint);
+	s = es_int_strFromHdr(h);
 
 #	ifndef NDEBUG
 	/*s->objID = ES_STRING_OID;*/
@@ -171,40 +479,12 @@ done:
 es_str_t*
 es_newStrFromNumber(long long num)
 {
-	char numbuf[20];	/* 2^64 has 20 digits ;) */
-	int i,j;
-	char minus = '\0';
 	es_str_t *s;
-	long long upperBorder = -9223372036854775807LL;
-	--upperBorder; /* handle number in C90 and newer modes */
-	
-	/* handle border case */
-	if(num == upperBorder) {
-		s = es_newStrFromCStr("-9223372036854775808", 20);
-		goto done;
-	}
-
-	if (num < 0) {
-	    minus = '-';
-	    num = -num;
-	}
-	
-	/* generate string (reversed) */
-	for(i = 0 ; num != 0 ; ++i) {
-		numbuf[i] = num % 10 + '0';
-		num /= 10;
-	}
-	if(i == 0)
-		numbuf [i++] = '0';
-	if (minus != '\0')
-		numbuf[i++] = minus;
 
-	/* now create the actual string */
-	if((s = es_newStr(i)) == NULL) goto done;
-	s->lenStr = i;
-	for(j = 0 ; --i >= 0 ; ++j) {
-		es_getBufAddr(s)[j] = numbuf[i];
-	}
+	if((s = es_newStr(20)) == NULL) /* -2^63 has 20 chars ;) */
+		goto done;
+	/* can not fail, as the buffer is large enough */
+	es_addNumber(&s, num);
 
 done:
 	return s;
@@ -234,220 +514,237 @@ done:
 	return s;
 }
 
+es_str_t*
+es_newStrFromView(es_strview_t v)
+{
+	es_str_t *s;
+
+	if((s = es_newStr(v.len)) == NULL) goto done;
+	memcpy(es_getBufAddr(s), v.buf, v.len);
+	s->lenStr = v.len;
+
+done:
+	return s;
+}
+
+
+es_str_t*
+es_strshare(es_str_t *s)
+{
+	es_strhdr_t *h = es_int_hdr(s);
+
+	if(h->flags & ES_STRF_ARENA) {
+		/* the reference count shares space with the arena offset */
+		return es_newStrFromSubStr(s, 0, es_strlen(s));
+	}
+	if(h->flags & ES_STRF_INTERNED)
+		return s; /* lives as long as its table, no need to count */
+	/* only set the flag if not yet set, as other owners may read it */
+	if(!(h->flags & ES_STRF_SHARED))
+		h->flags |= ES_STRF_SHARED;
+	ES_ATOMIC_FETCH_ADD(&h->u.refcnt, 1);
+	return s;
+}
+
+
+void
+es_emptyStr(es_str_t *str)
+{
+	ES_REQUIRE_EXCLUSIVE(str);
+	str->lenStr = 0;
+	ES_INVALIDATE_HASH(str);
+}
+
+
+es_str_t*
+es_strdup(es_str_t *str)
+{
+	if(es_int_bCOWMode)
+		return es_strshare(str);
+	return es_newStrFromSubStr(str, 0, es_strlen(str));
+}
+
+
+void
+es_setCOWMode(int bEnable)
+{
+	es_int_bCOWMode = bEnable;
+}
+
+
+int
+es_unshareStr(es_str_t **ps)
+{
+	return ES_UNSHARE(ps);
+}
+
+
 void
 es_deleteStr(es_str_t *s)
 {
+	es_strhdr_t *h;
+
+	if(s == NULL)
+		return;
 	ASSERT_STR(s);
 #	if 0 /*!defined(NDEBUG)*/
 	s->objID = ES_STRING_FREED;
 #	endif
-	free(s);
+	h = es_int_hdr(s);
+	if(h->flags & ES_STRF_INTERNED)
+		return; /* owned by the intern table */
+	if((h->flags & ES_STRF_SHARED) && ES_ATOMIC_FETCH_SUB(&h->u.refcnt, 1) != 0)
+		return; /* other owners remain */
+	if(h->flags & ES_STRF_ARENA) {
+		es_int_arenaFree(s);
+		return;
+	}
+	ES_STATS_FREE(s);
+	if(!es_int_poolEnabled || !es_int_poolPut(h, s->lenBuf))
+		free(h);
 }
 
 
-int
-es_strbufcmp(es_str_t *s, const unsigned char *buf, es_size_t lenBuf)
+/* Derive the ordering of two buffers from their first difference. If
+ * one is a prefix of the other, the shorter one is smaller. This must
+ * stay compatible with the results of the original byte loops, which
+ * returned the difference of the first differing bytes.
+ */
+static inline int
+bufcmp(const unsigned char *c1, es_size_t len1, const unsigned char *c2, es_size_t len2,
+	const int bCase)
 {
-	int r;
+	const es_size_t lenCmp = (len1 < len2) ? len1 : len2;
 	es_size_t i;
-	unsigned char *c;
+	int r;
 
-	ASSERT_STR(s);
-	assert(buf != NULL);
-	c = es_getBufAddr(s);
-	r = 0;	/* assume: strings equal, will be reset if not */
-	for(i = 0 ; i < s->lenStr ; ++i) {
-		if(i == lenBuf) {
-			r = 1; /* strings are so far equal, but second string is smaller */
-			break;
-		}
-		if(c[i] != buf[i]) {
-			r = c[i] - buf[i];
-			break;
-		}
+	if(bCase) {
+		i = es_int_caseMismatch(c1, c2, lenCmp);
+		if(i < lenCmp)
+			return es_int_asciiLower[c1[i]] - es_int_asciiLower[c2[i]];
+	} else {
+		i = es_int_mismatch(c1, c2, lenCmp);
+		if(i < lenCmp)
+			return c1[i] - c2[i];
 	}
-	if(r == 0 && s->lenStr < lenBuf)
-		r = -1; /* strings are so far equal, but first string is smaller */
+	if(len1 == len2)
+		r = 0;
+	else
+		r = (len1 < len2) ? -1 : 1;
 	return r;
 }
 
 
-/* The following is the case-insensitive version of es_strbufcmp. It is
- * a separate function for speed puprposes. However, the code is almost
- * identical to es_strbufcmp, so when that one is updated, changes should
- * be copied over to here as well. The only difference is the tolower()
- * call, so change propagation is easy ;)
- */
 int
-es_strcasebufcmp(es_str_t *s, const unsigned char *buf, es_size_t lenBuf)
+es_viewbufcmp(es_strview_t v, const unsigned char *buf, es_size_t lenBuf)
 {
-	int r;
-	es_size_t i;
-	unsigned char *c;
+	assert(buf != NULL);
+	return bufcmp(v.buf, v.len, buf, lenBuf, 0);
+}
+
 
+int
+es_strbufcmp(es_str_t *s, const unsigned char *buf, es_size_t lenBuf)
+{
 	ASSERT_STR(s);
+	return es_viewbufcmp(es_viewFromStr(s), buf, lenBuf);
+}
+
+
+int
+es_viewcasebufcmp(es_strview_t v, const unsigned char *buf, es_size_t lenBuf)
+{
 	assert(buf != NULL);
-	c = es_getBufAddr(s);
-	r = 0;	/* assume: strings equal, will be reset if not */
-	for(i = 0 ; i < s->lenStr ; ++i) {
-		if(i == lenBuf) {
-			r = 1;
-			break;
-		}
-		if(tolower(c[i]) != tolower(buf[i])) {
-			r = tolower(c[i]) - tolower(buf[i]);
-			break;
-		}
-	}
-	if(r == 0 && s->lenStr < lenBuf)
-		r = -1;
-	return r;
+	return bufcmp(v.buf, v.len, buf, lenBuf, 1);
 }
+
+
 int
-es_strncmp(es_str_t *s1, es_str_t *s2, es_size_t len)
+es_strcasebufcmp(es_str_t *s, const unsigned char *buf, es_size_t lenBuf)
 {
-	int r;
-	es_size_t i;
-	unsigned char *c1, *c2;
+	ASSERT_STR(s);
+	return es_viewcasebufcmp(es_viewFromStr(s), buf, lenBuf);
+}
+
 
+/* the strings are treated as if they were truncated to len */
+int
+es_strncmp(es_str_t *s1, es_str_t *s2, es_size_t len)
+{
 	ASSERT_STR(s1);
 	ASSERT_STR(s2);
-	c1 = es_getBufAddr(s1);
-	c2 = es_getBufAddr(s2);
-	r = 0;	/* assume: strings equal, will be reset if not */
-	for(i = 0 ; i < len ; ++i) {
-		if(i >= s1->lenStr) {
-			if(i >= s2->lenStr) {
-				break; /* we are done, match ready */
-			} else {
-				r = -1; /* first string smaller --> less */
-				break;
-			}
-		} else {
-			if(i >= s2->lenStr) {
-				r = 1; /* first string smaller --> greater */
-				break;
-			} else {
-				if(c1[i] != c2[i]) {
-					r = c1[i] - c2[i];
-					break;
-				}
-			}
-		}
-	}
-	return r;
+	return bufcmp(es_getBufAddr(s1), (s1->lenStr < len) ? s1->lenStr : len,
+		      es_getBufAddr(s2), (s2->lenStr < len) ? s2->lenStr : len, 0);
 }
 
 
-/* The following is the case-insensitive version of es_strContains. It is
- * a separate function for speed puprposes. However, the code is almost
- * identical to es_strContains, so when that one is updated, changes should
- * be copied over to here as well. The only difference is the tolower()
- * call, so change propagation is easy ;)
- */
 int
 es_strncasecmp(es_str_t *s1, es_str_t *s2, es_size_t len)
 {
-	int r;
-	es_size_t i;
-	unsigned char *c1, *c2;
+	ASSERT_STR(s1);
+	ASSERT_STR(s2);
+	return bufcmp(es_getBufAddr(s1), (s1->lenStr < len) ? s1->lenStr : len,
+		      es_getBufAddr(s2), (s2->lenStr < len) ? s2->lenStr : len, 1);
+}
+
+
+int
+es_strequal(es_str_t *s1, es_str_t *s2)
+{
+#	ifdef ENABLE_HASH_CACHE
+	const es_strhdr_t *h1, *h2;
+#	endif
 
 	ASSERT_STR(s1);
 	ASSERT_STR(s2);
-	c1 = es_getBufAddr(s1);
-	c2 = es_getBufAddr(s2);
-	r = 0;	/* assume: strings equal, will be reset if not */
-	for(i = 0 ; i < len ; ++i) {
-		if(i >= s1->lenStr) {
-			if(i >= s1->lenStr) {
-				break; /* we are done, match ready */
-			} else {
-				r = -1; /* first string smaller --> less */
-				break;
-			}
-		} else {
-			if(i >= s1->lenStr) {
-				r = 1; /* first string smaller --> greater */
-				break;
-			} else {
-				if(tolower(c1[i]) != tolower(c2[i])) {
-					r = tolower(c1[i]) - tolower(c2[i]);
-					break;
-				}
-			}
-		}
-	}
-	return r;
+	if(s1->lenStr != s2->lenStr)
+		return 0;
+#	ifdef ENABLE_HASH_CACHE
+	/* different cached hashes (for the same seed) prove inequality */
+	h1 = es_int_hdr(s1);
+	h2 = es_int_hdr(s2);
+	if((h1->flags & h2->flags & ES_STRF_HASHED) && h1->hashSeed == h2->hashSeed
+	   && h1->hash != h2->hash)
+		return 0;
+#	endif
+	return memcmp(es_getBufAddr(s1), es_getBufAddr(s2), s1->lenStr) == 0;
 }
 
 
 int
-es_strContains(es_str_t *s1, es_str_t *s2)
+es_viewequal(es_strview_t v1, es_strview_t v2)
 {
-	es_size_t i, j;
-	es_size_t max;
-	unsigned char *c1, *c2;
-	int r;
-	
-	r = -1;
-	if(s2->lenStr > s1->lenStr) {
-		/* can not be contained ;) */
-		goto done;
-	}
+	return v1.len == v2.len && memcmp(v1.buf, v2.buf, v1.len) == 0;
+}
 
-	c1 = es_getBufAddr(s1);
-	c2 = es_getBufAddr(s2);
-	max = s1->lenStr - s2->lenStr + 1;
-	for(i = 0 ; i < max ; ++i) {
-		for(j = 0 ; j < s2->lenStr; ++j) {
-			if(c1[i+j] != c2[j])
-				break;
-		}
-		if(j == s2->lenStr) {
-			r = i;
-			break;
-		}
-	}
 
-done:	return r;
+int
+es_strContains(es_str_t *s1, es_str_t *s2)
+{
+	return es_int_findBuf(es_getBufAddr(s1), s1->lenStr,
+		es_getBufAddr(s2), s2->lenStr);
 }
 
 
-/* The following is the case-insensitive version of es_strContains. It is
- * a separate function for speed puprposes. However, the code is almost
- * identical to es_strContains, so when that one is updated, changes should
- * be copied over to here as well. The only difference is the tolower()
- * call, so change propagation is easy ;)
- */
 int
 es_strCaseContains(es_str_t *s1, es_str_t *s2)
 {
-	es_size_t i, j;
-	es_size_t max;
-	unsigned char *c1, *c2;
-	int r;
-	
-	r = -1;
-	if(s2->lenStr > s1->lenStr) {
-		/* can not be contained ;) */
-		goto done;
-	}
+	return es_int_findBufCase(es_getBufAddr(s1), s1->lenStr,
+		es_getBufAddr(s2), s2->lenStr);
+}
 
-	c1 = es_getBufAddr(s1);
-	c2 = es_getBufAddr(s2);
-	max = s1->lenStr - s2->lenStr + 1;
-	for(i = 0 ; i < max ; ++i) {
-		for(j = 0 ; j < s2->lenStr; ++j) {
-			if(tolower(c1[i+j]) != tolower(c2[j]))
-				break;
-		}
-		if(j == s2->lenStr) {
-			r = i;
-			break;
-		}
-	}
 
-done:	return r;
+int
+es_viewContains(es_strview_t v1, es_strview_t v2)
+{
+	return es_int_findBuf(v1.buf, v1.len, v2.buf, v2.len);
+}
+
+
+int
+es_viewCaseContains(es_strview_t v1, es_strview_t v2)
+{
+	return es_int_findBufCase(v1.buf, v1.len, v2.buf, v2.len);
 }
 
 
@@ -456,18 +753,54 @@ es_addChar(es_str_t **ps, const unsigned char c)
 {
 	int r = 0;
 
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
 	if((*ps)->lenStr >= (*ps)->lenBuf) {
 		if((r = es_extendBuf(ps, 1)) != 0) goto done;
 	}
 
 	/* ok, when we reach this, we have sufficient memory */
 	*(es_getBufAddr(*ps) + (*ps)->lenStr++) = c;
+	ES_INVALIDATE_HASH(*ps);
 
 done:
 	return r;
 }
 
 
+int
+es_addNumber(es_str_t **ps, long long num)
+{
+	/* negating as unsigned handles the most negative number, too */
+	if(num < 0)
+		return addNumber(ps, -(unsigned long long) num, 1, 0, 0);
+	return addNumber(ps, (unsigned long long) num, 0, 0, 0);
+}
+
+
+int
+es_addUNumber(es_str_t **ps, unsigned long long num)
+{
+	return addNumber(ps, num, 0, 0, 0);
+}
+
+
+int
+es_addHexNumber(es_str_t **ps, unsigned long long num)
+{
+	return addNumber(ps, num, 0, 1, 0);
+}
+
+
+int
+es_addNumberPadded(es_str_t **ps, long long num, es_size_t minDigits)
+{
+	if(num < 0)
+		return addNumber(ps, -(unsigned long long) num, 1, 0, minDigits);
+	return addNumber(ps, (unsigned long long) num, 0, 0, minDigits);
+}
+
+
 int
 es_addBuf(es_str_t **ps1, const char *buf, es_size_t lenBuf)
 {
@@ -480,6 +813,9 @@ es_addBuf(es_str_t **ps1, const char *buf, es_size_t lenBuf)
 		r = 0;
 		goto done;
 	}
+	if((r = ES_UNSHARE(ps1)) != 0)
+		goto done;
+	s1 = *ps1;
 
 	newlen = s1->lenStr + lenBuf;
 	if(newlen < s1->lenStr) {
@@ -495,6 +831,7 @@ es_addBuf(es_str_t **ps1, const char *buf, es_size_t lenBuf)
 	/* do the actual copy, we now *have* the space required */
 	memcpy(es_getBufAddr(s1)+s1->lenStr, buf, lenBuf);
 	s1->lenStr = newlen;
+	ES_INVALIDATE_HASH(s1);
 	r = 0; /* all well */
 
 done:
@@ -503,36 +840,36 @@ done:
 
 
 char *
-es_str2cstr(es_str_t *s, const char *nulEsc)
+es_view2cstr(es_strview_t v, const char *nulEsc)
 {
 	char *cstr;
 	size_t lenEsc;
 	int nbrNUL;
 	es_size_t i;
 	size_t iDst;
-	unsigned char *c;
+	const unsigned char *c;
 
 	/* detect number of NULs inside string */
-	c = es_getBufAddr(s);
+	c = v.buf;
 	nbrNUL = 0;
-	for(i = 0 ; i < s->lenStr ; ++i) {
+	for(i = 0 ; i < v.len ; ++i) {
 		if(c[i] == 0x00)
 			++nbrNUL;
 	}
 
 	if(nbrNUL == 0) {
 		/* no special handling needed */
-		if((cstr = malloc(s->lenStr + 1)) == NULL) goto done;
-		if(s->lenStr > 0)
-			memcpy(cstr, c, s->lenStr);
-		cstr[s->lenStr] = '\0';
+		if((cstr = malloc(v.len + 1)) == NULL) goto done;
+		if(v.len > 0)
+			memcpy(cstr, c, v.len);
+		cstr[v.len] = '\0';
 	} else {
 		/* we have NUL bytes present and need to process them
 		 * during creation of the C string.
 		 */
 		lenEsc = (nulEsc == NULL) ? 0 : strlen(nulEsc);
 		size_t nbrNUL_sz = (size_t)nbrNUL;
-		size_t lenStr_sz = (size_t)s->lenStr;
+		size_t lenStr_sz = (size_t)v.len;
 		size_t allocSize = lenStr_sz + 1;
 		if (lenEsc > 1) {
 			if (nbrNUL_sz > (((size_t)-1) - allocSize) / (lenEsc - 1)) {
@@ -543,7 +880,7 @@ es_str2cstr(es_str_t *s, const char *nulEsc)
 		}
 		if((cstr = malloc(allocSize)) == NULL)
 			goto done;
-		for(i = iDst = 0 ; i < s->lenStr ; ++i) {
+		for(i = iDst = 0 ; i < v.len ; ++i) {
 			if(c[i] == 0x00) {
 				if(lenEsc == 1) {
 					cstr[iDst++] = *nulEsc;
@@ -562,133 +899,11 @@ done:
 	return cstr;
 }
 
-/*helpers to es_str2num */
-/* startindex is provided for decimal to cover '-' */
-static inline long long
-es_str2num_dec(es_str_t *s, unsigned i, int bNegative, int *bSuccess)
-{
-	long long num;
-	unsigned char *c;
-	int digit_val;
-	long long max_div_10 = LLONG_MAX / 10;
-	int max_mod_10 = LLONG_MAX % 10;
-	long long min_div_10 = LLONG_MIN / 10;
-	int min_mod_10 = LLONG_MIN % 10;
 
-	num = 0;
-	c = es_getBufAddr(s);
-	while(i < s->lenStr && isdigit(c[i])) {
-		digit_val = c[i] - '0';
-		if (bNegative) {
-			if (num < min_div_10 || (num == min_div_10 && -digit_val < min_mod_10)) {
-				num = LLONG_MIN;
-				if (bSuccess != NULL) *bSuccess = 0;
-				while (++i < s->lenStr && isdigit(c[i]));
-				break;
-			}
-			num = num * 10 - digit_val;
-		} else {
-			if (num > max_div_10 || (num == max_div_10 && digit_val > max_mod_10)) {
-				num = LLONG_MAX;
-				if (bSuccess != NULL) *bSuccess = 0;
-				while (++i < s->lenStr && isdigit(c[i]));
-				break;
-			}
-			num = num * 10 + digit_val;
-		}
-		++i;
-	}
-	if(bSuccess != NULL && *bSuccess != 0)
-		*bSuccess = (i == s->lenStr) ? 1 : 0;
-	return num;
-}
-static inline long long
-es_str2num_oct(es_str_t *s, int *bSuccess)
-{
-	long long num;
-	unsigned char *c;
-	unsigned i;
-	int digit_val;
-	long long max_div_8 = LLONG_MAX / 8;
-	int max_mod_8 = LLONG_MAX % 8;
-
-	i = 0;
-	num = 0;
-	c = es_getBufAddr(s);
-	while(i < s->lenStr && (c[i] >= '0' && c[i] <= '7')) {
-		digit_val = c[i] - '0';
-		if (num > max_div_8 || (num == max_div_8 && digit_val > max_mod_8)) {
-			num = LLONG_MAX;
-			if (bSuccess != NULL) *bSuccess = 0;
-			while (++i < s->lenStr && (c[i] >= '0' && c[i] <= '7'));
-			break;
-		}
-		num = num * 8 + digit_val;
-		++i;
-	}
-	if(bSuccess != NULL && *bSuccess != 0)
-		*bSuccess = (i == s->lenStr) ? 1 : 0;
-	return num;
-}
-static inline long long
-es_str2num_hex(es_str_t *s, int *bSuccess)
-{
-	long long num;
-	unsigned char *c;
-	unsigned i;
-	int digit_val;
-	long long max_div_16 = LLONG_MAX / 16;
-	int max_mod_16 = LLONG_MAX % 16;
-
-	i = 2;
-	num = 0;
-	c = es_getBufAddr(s);
-	while(i < s->lenStr && isxdigit(c[i])) {
-		digit_val = isdigit(c[i]) ? (c[i] - '0') : (tolower(c[i]) - 'a' + 10);
-		if (num > max_div_16 || (num == max_div_16 && digit_val > max_mod_16)) {
-			num = LLONG_MAX;
-			if (bSuccess != NULL) *bSuccess = 0;
-			while (++i < s->lenStr && isxdigit(c[i]));
-			break;
-		}
-		num = num * 16 + digit_val;
-		++i;
-	}
-	if(bSuccess != NULL && *bSuccess != 0)
-		*bSuccess = (i == s->lenStr && i > 2) ? 1 : 0;
-	return num;
-}
-/*end helpers to es_str2num */
-
-long long
-es_str2num(es_str_t *s, int *bSuccess)
+char *
+es_str2cstr(es_str_t *s, const char *nulEsc)
 {
-	long long num;
-	unsigned char *c;
-	if(s->lenStr == 0) {
-		num = 0;
-		if(bSuccess != NULL)
-			*bSuccess = 0;
-		goto done;
-	}
-
-	if (bSuccess != NULL)
-		*bSuccess = 1; /* initialize as success */
-
-	c = es_getBufAddr(s);
-	if(c[0] == '-') {
-		num = es_str2num_dec(s, 1, 1, bSuccess);
-	} else if(c[0] == '0') {
-		if(s->lenStr > 1 && c[1] == 'x') {
-			num = es_str2num_hex(s, bSuccess);
-		} else {
-			num = es_str2num_oct(s, bSuccess);
-		}
-	} else { /* decimal */
-		num = es_str2num_dec(s, 0, 0, bSuccess);
-	}
-
-done:	return num;
+	return es_view2cstr(es_viewFromStr(s), nulEsc);
 }
 
 
@@ -709,117 +924,165 @@ static inline int hexDigitVal(char c)
 	return r;
 }
 
-/* Handle the actual unescaping.
- * a helper to es_unescapeStr(), to help make the function easier to read.
+/* Handle a single escape sequence.
+ * A helper to unescapeBuf(). src[i] must be the backslash. The result
+ * character is stored in *out, which may point into src, but only at
+ * or before src+i. We read all source bytes before writing it.
+ * @returns number of source bytes consumed
  */
-static inline void
-doUnescape(unsigned char *c, es_size_t lenStr, es_size_t *iSrc, es_size_t iDst)
+static inline es_size_t
+doUnescape(const unsigned char *src, es_size_t len, es_size_t i, unsigned char *out)
 {
-	if(c[*iSrc] == '\\') {
-		if(++(*iSrc) == lenStr) {
-			/* error, incomplete escape, treat as single char */
-			c[iDst] = '\\';
+	unsigned char c;
+
+	if(i + 1 == len) {
+		/* error, incomplete escape, treat as single char */
+		*out = '\\';
+		return 1;
+	}
+	switch(src[i + 1]) {
+	case '0':
+		c = '\0';
+		break;
+	case 'a':
+		c = '\007';
+		break;
+	case 'b':
+		c = '\b';
+		break;
+	case 'f':
+		c = '\014';
+		break;
+	case 'n':
+		c = '\n';
+		break;
+	case 'r':
+		c = '\r';
+		break;
+	case 't':
+		c = '\t';
+		break;
+	case '\'':
+		c = '\'';
+		break;
+	case '"':
+		c = '"';
+		break;
+	case '?':
+		c = '?';
+		break;
+	case '\\':
+		c = '\\';
+		break;
+	case 'x':
+		if(    i + 3 >= len
+		   || !isxdigit(src[i + 2])
+		   || !isxdigit(src[i + 3])) {
+			/* error, incomplete escape, use as is */
+			*out = '\\';
+			return 1;
 		}
-		/* regular case, unescape */
-		switch(c[*iSrc]) {
-		case '0':
-			c[iDst] = '\0';
-			break;
-		case 'a':
-			c[iDst] = '\007';
-			break;
-		case 'b':
-			c[iDst] = '\b';
-			break;
-		case 'f':
-			c[iDst] = '\014';
-			break;
-		case 'n':
-			c[iDst] = '\n';
-			break;
-		case 'r':
-			c[iDst] = '\r';
-			break;
-		case 't':
-			c[iDst] = '\t';
-			break;
-		case '\'':
-			c[iDst] = '\'';
-			break;
-		case '"':
-			c[iDst] = '"';
-			break;
-		case '?':
-			c[iDst] = '?';
-			break;
-		case '\\':
-			c[iDst] = '\\';
-			break;
-		case 'x':
-			if((*iSrc)+1 == lenStr) {
-				/* just end run, leave as is */
-				*iSrc += 1;
-				goto done;
-			}
-			if(    (*iSrc)+2 >= lenStr
-			   || !isxdigit(c[(*iSrc)+1])
-			   || !isxdigit(c[(*iSrc)+2])) {
-				/* error, incomplete escape, use as is */
-				c[iDst] = '\\';
-				--(*iSrc);
-				goto done;
-			}
-			c[iDst] = (hexDigitVal(c[(*iSrc)+1]) << 4) +
-				  hexDigitVal(c[(*iSrc)+2]);
-			*iSrc += 2;
-			break;
-		default:
-			/* error, incomplete escape, use as is.  Ideally we
-			   should reject it instead, to allow for future
-			   enhancements, but that would break ABI of
-			   es_unescapeStr. */
-			c[iDst] = '\\';
-			--(*iSrc);
-			break;
+		*out = (hexDigitVal(src[i + 2]) << 4) + hexDigitVal(src[i + 3]);
+		return 4;
+	default:
+		/* error, incomplete escape, use as is.  Ideally we
+		   should reject it instead, to allow for future
+		   enhancements, but that would break ABI of
+		   es_unescapeStr. */
+		*out = '\\';
+		return 1;
+	}
+	*out = c;
+	return 2;
+}
+
+/* Unescape src into dst, which may be the same buffer (but must not
+ * overlap otherwise). Runs without escapes are located with memchr(),
+ * which the C library implements with SIMD instructions on all major
+ * platforms, and copied in bulk.
+ * @returns length of unescaped data
+ */
+static es_size_t
+unescapeBuf(const unsigned char *src, es_size_t len, unsigned char *dst)
+{
+	const unsigned char *bs;
+	es_size_t iSrc = 0, iDst = 0;
+	es_size_t run;
+
+	while(iSrc < len) {
+		bs = memchr(src + iSrc, '\\', len - iSrc);
+		run = (bs == NULL) ? len - iSrc : (es_size_t) (bs - (src + iSrc));
+		if(run > 0) {
+			if(dst + iDst != src + iSrc)
+				memmove(dst + iDst, src + iSrc, run);
+			iSrc += run;
+			iDst += run;
 		}
-	} else {
-		/* regular character */
-		c[iDst] = c[*iSrc];
+		if(bs == NULL)
+			break;
+		iSrc += doUnescape(src, len, iSrc, dst + iDst);
+		++iDst;
 	}
-done:	return;
+	return iDst;
 }
 
 void
 es_unescapeStr(es_str_t *s)
 {
-	es_size_t iSrc, iDst;
 	unsigned char *c;
+	es_size_t len;
 	assert(s != NULL);
+	ES_REQUIRE_EXCLUSIVE(s);
 
 	c = es_getBufAddr(s);
-	/* scan for first escape sequence (if we are luky, there is none!) */
-	iSrc = 0;
-	while(iSrc < s->lenStr && c[iSrc] != '\\')
-		++iSrc;
-	/* now we have a sequence or end of string. In any case, we process
-	 * all remaining characters (maybe 0!) and unescape.
-	 */
-	if(iSrc != s->lenStr) {
-		iDst = iSrc;
-		while(iSrc < s->lenStr) {
-			doUnescape(c, s->lenStr, &iSrc, iDst);
-			++iSrc;
-			++iDst;
-		}
-		s->lenStr = iDst;
-	}
+	/* if we are lucky, there is no escape sequence at all */
+	if(memchr(c, '\\', s->lenStr) == NULL)
+		return;
+	len = unescapeBuf(c, s->lenStr, c);
+	s->lenStr = len;
+	ES_INVALIDATE_HASH(s);
 }
 
-void
-es_tolower(es_str_t *s)
+int
+es_unescapeStrCOW(es_str_t **ps)
 {
-	es_size_t i;
+	int r;
+
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
+	es_unescapeStr(*ps);
+
+done:
+	return r;
+}
+
+int
+es_addUnescaped(es_str_t **ps, const char *buf, es_size_t lenBuf)
+{
+	int r;
+	es_str_t *s;
 
-	for(i = 0 ; i < s->lenStr ; ++i)
-		es_getBufAddr(s)[i] = tolower(es_getBufAddr(s)[i]);
+	if(lenBuf == 0) {
+		r = 0;
+		goto done;
+	}
+	if((r = ES_UNSHARE(ps)) != 0)
+		goto done;
+	s = *ps;
+	/* the unescaped data is never longer than the original */
+	if(s->lenStr + lenBuf < s->lenStr) {
+		r = ENOMEM;
+		goto done;
+	}
+	if(s->lenBuf < s->lenStr + lenBuf) {
+		if((r = es_extendBuf(ps, s->lenStr + lenBuf - s->lenBuf)) != 0)
+			goto done;
+		s = *ps;
+	}
+	s->lenStr += unescapeBuf((const unsigned char*) buf, lenBuf,
+		es_getBufAddr(s) + s->lenStr);
+	ES_INVALIDATE_HASH(s);
+
+done:
+	return r;
 }
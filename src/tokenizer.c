@@ -0,0 +1,363 @@
+/**
+ * @file tokenizer.c
+ * Implements zero-copy splitting of data into fields.
+ *
+ * Finding the end of a field means finding the next byte out of the
+ * delimiter set. For one delimiter, this is memchr(). For up to three
+ * delimiters, 16 bytes are compared at once (SSE2). Larger sets use a
+ * nibble table lookup ("shufti") on 32 bytes at once if AVX2 is
+ * available, and a byte table otherwise.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+
+#ifdef ES_USE_SSE2
+#	include <emmintrin.h>
+#endif
+#ifdef ES_USE_AVX2
+#	include <immintrin.h>
+#endif
+
+struct es_tokenizer_s {
+	int flags;
+	unsigned char isDelim[256];
+	int nDelims;		/**< number of distinct delimiter bytes */
+	unsigned char delimBytes[3]; /**< the delimiters if nDelims <= 3 */
+	unsigned char loNibble[16]; /**< shufti tables, see mpm.c */
+	unsigned char hiNibble[16];
+	int bShuftiExact;	/**< shufti has no false positives */
+};
+
+
+es_tokenizer_t *
+es_newTokenizer(const unsigned char *delims, es_size_t nDelims, int flags)
+{
+	es_tokenizer_t *t = NULL;
+	es_size_t i;
+	int c, nHi;
+	int hiBucket[16];
+
+	if(nDelims == 0)
+		goto done;
+	if((t = calloc(1, sizeof(es_tokenizer_t))) == NULL)
+		goto done;
+	t->flags = flags;
+	for(i = 0 ; i < nDelims ; ++i)
+		t->isDelim[delims[i]] = 1;
+
+	/* each distinct high nibble gets its own bucket, so the shufti test
+	 * is exact for up to 8 of them
+	 */
+	for(c = 0 ; c < 16 ; ++c)
+		hiBucket[c] = -1;
+	nHi = 0;
+	for(c = 0 ; c < 256 ; ++c) {
+		if(!t->isDelim[c])
+			continue;
+		if(t->nDelims < 3)
+			t->delimBytes[t->nDelims] = (unsigned char) c;
+		++t->nDelims;
+		if(hiBucket[c >> 4] == -1)
+			hiBucket[c >> 4] = nHi++ % 8;
+		t->hiNibble[c >> 4] |= 1 << hiBucket[c >> 4];
+		t->loNibble[c & 0x0f] |= 1 << hiBucket[c >> 4];
+	}
+	t->bShuftiExact = (nHi <= 8);
+	if(t->nDelims == 1) /* the SSE2 code always compares against two bytes */
+		t->delimBytes[1] = t->delimBytes[0];
+
+done:
+	return t;
+}
+
+
+void
+es_deleteTokenizer(es_tokenizer_t *t)
+{
+	free(t);
+}
+
+
+#ifdef ES_USE_SSE2
+/* delimiter mask of 16 bytes, for nDelims <= 3 */
+static inline unsigned
+delimMask_sse2(const es_tokenizer_t *t, const unsigned char *p)
+{
+	const __m128i v = _mm_loadu_si128((const __m128i*) p);
+
+	return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+		_mm_cmpeq_epi8(v, _mm_set1_epi8((char) t->delimBytes[0])),
+		_mm_cmpeq_epi8(v, _mm_set1_epi8((char) t->delimBytes[1]))),
+		_mm_cmpeq_epi8(v, _mm_set1_epi8((char) t->delimBytes[t->nDelims - 1]))));
+}
+#endif /* #ifdef ES_USE_SSE2 */
+
+
+#ifdef ES_USE_AVX2
+/* candidate mask of 32 bytes; exact only if t->bShuftiExact */
+__attribute__((target("avx2")))
+static inline unsigned
+delimMask_avx2(const es_tokenizer_t *t, const unsigned char *p)
+{
+	const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) t->loNibble));
+	const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) t->hiNibble));
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	const __m256i v = _mm256_loadu_si256((const __m256i*) p);
+	const __m256i hit = _mm256_and_si256(
+		_mm256_shuffle_epi8(lo, _mm256_and_si256(v, nibble)),
+		_mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+
+	return ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hit, _mm256_setzero_si256()));
+}
+
+__attribute__((target("avx2")))
+static es_size_t
+nextDelim_avx2(const es_tokenizer_t *t, const unsigned char *buf, es_size_t i, es_size_t len)
+{
+	unsigned mask;
+
+	for( ; (size_t) i + 32 <= len ; i += 32) {
+		for(mask = delimMask_avx2(t, buf + i) ; mask != 0 ; mask &= mask - 1)
+			if(t->isDelim[buf[i + __builtin_ctz(mask)]])
+				return i + __builtin_ctz(mask);
+	}
+	while(i < len && !t->isDelim[buf[i]])
+		++i;
+	return i;
+}
+
+/* see nthDelim(), only for exact shufti tables */
+__attribute__((target("avx2")))
+static es_size_t
+nthDelim_avx2(const es_tokenizer_t *t, const unsigned char *buf, es_size_t len, es_size_t n)
+{
+	es_size_t i;
+	unsigned mask, cnt;
+
+	for(i = 0 ; (size_t) i + 32 <= len ; i += 32) {
+		mask = delimMask_avx2(t, buf + i);
+		cnt = __builtin_popcount(mask);
+		if(cnt > n) {
+			for( ; n > 0 ; --n)
+				mask &= mask - 1;
+			return i + __builtin_ctz(mask);
+		}
+		n -= cnt;
+	}
+	for( ; i < len ; ++i) {
+		if(t->isDelim[buf[i]]) {
+			if(n == 0)
+				return i;
+			--n;
+		}
+	}
+	return len;
+}
+#endif /* #ifdef ES_USE_AVX2 */
+
+
+/* index of the next delimiter at or after i, len if there is none */
+static inline es_size_t
+nextDelim(const es_tokenizer_t *t, const unsigned char *buf, es_size_t i, es_size_t len)
+{
+	const unsigned char *p;
+
+	if(i == len) /* buf may be NULL for an empty view */
+		return len;
+	if(t->nDelims == 1) {
+		p = memchr(buf + i, t->delimBytes[0], len - i);
+		return (p == NULL) ? len : (es_size_t) (p - buf);
+	}
+#	ifdef ES_USE_SSE2
+	if(t->nDelims <= 3) {
+		unsigned mask;
+		for( ; (size_t) i + 16 <= len ; i += 16) {
+			if((mask = delimMask_sse2(t, buf + i)) != 0)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#	endif
+#	ifdef ES_USE_AVX2
+	if(t->nDelims > 3 && es_int_haveAVX2())
+		return nextDelim_avx2(t, buf, i, len);
+#	endif
+	while(i < len && !t->isDelim[buf[i]])
+		++i;
+	return i;
+}
+
+
+/* index of delimiter n (0-based), len if there are not that many */
+static es_size_t
+nthDelim(const es_tokenizer_t *t, const unsigned char *buf, es_size_t len, es_size_t n)
+{
+	es_size_t i = 0;
+
+#	ifdef ES_USE_AVX2
+	if(t->nDelims > 3 && t->bShuftiExact && es_int_haveAVX2())
+		return nthDelim_avx2(t, buf, len, n);
+#	endif
+#	ifdef ES_USE_SSE2
+	if(t->nDelims <= 3) {
+		unsigned mask, cnt;
+		for( ; (size_t) i + 16 <= len ; i += 16) {
+			mask = delimMask_sse2(t, buf + i);
+			cnt = __builtin_popcount(mask);
+			if(cnt > n) {
+				for( ; n > 0 ; --n)
+					mask &= mask - 1;
+				return i + __builtin_ctz(mask);
+			}
+			n -= cnt;
+		}
+	}
+#	endif
+	for( ; i < len ; ++i) {
+		if(t->isDelim[buf[i]]) {
+			if(n == 0)
+				return i;
+			--n;
+		}
+	}
+	return len;
+}
+
+
+/* index of the quote closing a quoted field whose contents start at i,
+ * len if it is unterminated
+ */
+static es_size_t
+closingQuote(const es_tokenizer_t *t, const unsigned char *buf, es_size_t i, es_size_t len)
+{
+	const unsigned char *p;
+
+	if(t->flags & ES_TOK_QUOTES_BSLASH) {
+		for( ; i < len ; ++i) {
+			if(buf[i] == '\\')
+				++i;
+			else if(buf[i] == '"')
+				break;
+		}
+		return (i < len) ? i : len;
+	}
+	while(i < len) {
+		if((p = memchr(buf + i, '"', len - i)) == NULL)
+			return len;
+		i = p - buf;
+		if(i + 1 == len || buf[i + 1] != '"')
+			break;
+		i += 2; /* doubled quote is data */
+	}
+	return i;
+}
+
+
+void
+es_fieldIterInit(es_fielditer_t *it, es_tokenizer_t *t, es_strview_t v)
+{
+	it->tok = t;
+	it->buf = v.buf;
+	it->len = v.len;
+	it->pos = 0;
+	it->bDone = 0;
+	it->bQuoted = 0;
+}
+
+
+int
+es_fieldNext(es_fielditer_t *it, es_size_t *pOffs, es_size_t *pLen)
+{
+	const es_tokenizer_t *t = it->tok;
+	const unsigned char *buf = it->buf;
+	const es_size_t len = it->len;
+	es_size_t i, end;
+
+	if(it->bDone)
+		return 0;
+	i = it->pos;
+	if(t->flags & ES_TOK_MERGE_DELIMS) {
+		while(i < len && t->isDelim[buf[i]])
+			++i;
+		if(i == len) {
+			it->bDone = 1;
+			return 0;
+		}
+	}
+
+	if((t->flags & (ES_TOK_QUOTES | ES_TOK_QUOTES_BSLASH)) && i < len && buf[i] == '"') {
+		end = closingQuote(t, buf, i + 1, len);
+		*pOffs = i + 1;
+		*pLen = end - (i + 1);
+		it->bQuoted = 1;
+		i = (end < len) ? end + 1 : len;
+		if(i < len && !t->isDelim[buf[i]]) /* junk after the quotes */
+			i = nextDelim(t, buf, i, len);
+	} else {
+		end = nextDelim(t, buf, i, len);
+		*pOffs = i;
+		*pLen = end - i;
+		it->bQuoted = 0;
+		i = end;
+	}
+
+	if(i == len)
+		it->bDone = 1;
+	else
+		it->pos = i + 1;
+	return 1;
+}
+
+
+int
+es_fieldGet(es_tokenizer_t *t, es_strview_t v, es_size_t n,
+	es_size_t *pOffs, es_size_t *pLen)
+{
+	es_fielditer_t it;
+	es_size_t start;
+
+	if(t->flags & (ES_TOK_MERGE_DELIMS | ES_TOK_QUOTES | ES_TOK_QUOTES_BSLASH)) {
+		es_fieldIterInit(&it, t, v);
+		do {
+			if(!es_fieldNext(&it, pOffs, pLen))
+				return ENOENT;
+		} while(n-- > 0);
+		return 0;
+	}
+
+	if(n == 0) {
+		start = 0;
+	} else {
+		if((start = nthDelim(t, v.buf, v.len, n - 1)) == v.len)
+			return ENOENT;
+		++start;
+	}
+	*pOffs = start;
+	*pLen = nextDelim(t, v.buf, start, v.len) - start;
+	return 0;
+}
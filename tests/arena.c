@@ -0,0 +1,140 @@
+/**
+ * @file arena.c
+ * Tests for the string arena.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+#define NSTRS 20
+
+static unsigned seed = 1;
+
+static unsigned
+rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+/* Grow many arena strings in turn, so that they are moved inside their
+ * chunk, to new chunks and to dedicated large chunks. Each one is
+ * mirrored by a heap string with the same content.
+ */
+static void
+checkInterleavedGrowth(es_size_t chunkSize)
+{
+	es_arena_t *a;
+	es_str_t *s[NSTRS], *ref[NSTRS];
+	char buf[600];
+	int round, i, k, ok = 1;
+	es_size_t len;
+
+	a = es_newArena(chunkSize);
+	CHECK(a != NULL);
+	for(round = 0 ; round < 3 ; ++round) {
+		for(k = 0 ; k < NSTRS ; ++k) {
+			s[k] = es_newStrInArena(a, rnd() % 64);
+			ref[k] = es_newStr(1);
+			CHECK(s[k] != NULL);
+		}
+		for(i = 0 ; i < 2000 ; ++i) {
+			k = rnd() % NSTRS;
+			len = (rnd() % 8 == 0) ? rnd() % sizeof(buf) : rnd() % 20;
+			memset(buf, 'a' + k, len);
+			if(len > 0)
+				buf[len - 1] = '0' + i % 10;
+			ok &= es_addBuf(&s[k], buf, len) == 0;
+			ok &= es_addBuf(&ref[k], buf, len) == 0;
+		}
+		for(k = 0 ; k < NSTRS ; ++k) {
+			ok &= es_strbufcmp(s[k], es_getBufAddr(ref[k]), es_strlen(ref[k])) == 0
+			      && es_strlen(s[k]) == es_strlen(ref[k]);
+			es_deleteStr(ref[k]);
+		}
+		es_resetArena(a);
+	}
+	CHECK(ok);
+	es_deleteArena(a);
+}
+
+static void
+checkPlacement(void)
+{
+	es_arena_t *a = es_newArena(1024);
+	es_str_t *s1, *s2, *s3, *dup;
+	unsigned char *addr;
+
+	/* the most recent allocation grows in place */
+	s1 = es_newStrInArena(a, 8);
+	es_addBufConstcstr(&s1, "12345678");
+	addr = es_getBufAddr(s1);
+	CHECK(es_addBufConstcstr(&s1, "more data") == 0);
+	CHECK(es_getBufAddr(s1) == addr);
+	CHECK_STR(s1, "12345678more data");
+
+	/* deleting the most recent allocation gives its space back */
+	s2 = es_newStrFromBufInArena(a, "temporary", 9);
+	CHECK_STR(s2, "temporary");
+	addr = es_getBufAddr(s2);
+	es_deleteStr(s2);
+	s2 = es_newStrInArena(a, 8);
+	CHECK(es_getBufAddr(s2) == addr);
+
+	/* an older string must move, but keeps its content */
+	CHECK(es_addBufConstcstr(&s1, ", moved") == 0);
+	CHECK_STR(s1, "12345678more data, moved");
+
+	/* strings larger than half a chunk get their own chunk */
+	s3 = es_newStrInArena(a, 4000);
+	CHECK(s3 != NULL && s3->lenBuf >= 4000);
+	memset(es_getBufAddr(s3), 'x', 4000);
+	s3->lenStr = 4000;
+
+	/* copies live on the heap and survive the arena */
+	dup = es_strdup(s1);
+	es_deleteStr(es_strshare(s1)); /* a share of an arena string is a copy */
+	es_resetArena(a);
+	CHECK_STR(dup, "12345678more data, moved");
+	es_deleteStr(dup);
+
+	/* the arena is usable after a reset */
+	s1 = es_newStrFromBufInArena(a, "", 0);
+	CHECK(s1 != NULL && es_strlen(s1) == 0);
+	CHECK(es_addBufConstcstr(&s1, "again") == 0);
+	CHECK_STR(s1, "again");
+	es_deleteArena(a);
+	es_deleteArena(NULL);
+}
+
+int
+main(void)
+{
+	checkPlacement();
+	checkInterleavedGrowth(0);
+	checkInterleavedGrowth(256);
+	return CHECK_RESULT();
+}
@@ -0,0 +1,127 @@
+/**
+ * @file benchcorpus.c
+ * Tests for the benchmark corpus generator.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "libestr.h"
+#include "check.h"
+#include "../bench/corpus.h"
+
+#define NMSGS 200
+
+/* the lengths and string objects match the C strings */
+static void
+checkConsistent(const corpus_t *c)
+{
+	size_t total = 0;
+	char *num;
+	int i;
+	int ok = 1;
+
+	CHECK(c->nMsgs == NMSGS);
+	for(i = 0 ; i < c->nMsgs ; ++i) {
+		total += c->lens[i];
+		ok &= strlen(c->msgs[i]) == c->lens[i];
+		ok &= es_strlen(c->strs[i]) == c->lens[i];
+		ok &= memcmp(es_getBufAddr(c->strs[i]), c->msgs[i], c->lens[i]) == 0;
+		/* the number is embedded in the message */
+		num = es_str2cstr(c->nums[i], NULL);
+		ok &= num != NULL && strstr(c->msgs[i], num) != NULL;
+		free(num);
+	}
+	CHECK(ok);
+	CHECK(total == c->totalBytes);
+}
+
+/* message syntax per format; JSON escapes must be valid */
+static void
+checkFormat(const corpus_t *c, corpusFormat_t fmt)
+{
+	const char *m, *p;
+	int i;
+	int ok = 1;
+
+	for(i = 0 ; i < c->nMsgs ; ++i) {
+		m = c->msgs[i];
+		switch(fmt) {
+		case CORPUS_RFC3164:
+			ok &= m[0] == '<' && strstr(m, "]:") != NULL;
+			break;
+		case CORPUS_RFC5424:
+			ok &= m[0] == '<' && strstr(m, ">1 2026-") != NULL
+			      && strstr(m, "[exampleSDID@32473 ") != NULL;
+			break;
+		case CORPUS_JSON:
+			ok &= m[0] == '{' && strcmp(m + c->lens[i] - 2, "\"}") == 0;
+			for(p = strchr(m, '\\') ; p != NULL ; p = strchr(p + 2, '\\'))
+				ok &= strchr("\\\"tn", p[1]) != NULL;
+			break;
+		}
+	}
+	CHECK(ok);
+}
+
+static void
+checkCorpus(corpusFormat_t fmt, const char *name)
+{
+	corpus_t c1, c2, big;
+	int i;
+	int ok = 1;
+
+	CHECK(corpusGenerate(&c1, fmt, "small", 0, NMSGS) == 0);
+	CHECK(corpusGenerate(&c2, fmt, "small", 0, NMSGS) == 0);
+	CHECK(strcmp(c1.name, name) == 0);
+	/* a fixed seed: every run sees the same data */
+	CHECK(c1.totalBytes == c2.totalBytes);
+	for(i = 0 ; i < NMSGS ; ++i)
+		ok &= strcmp(c1.msgs[i], c2.msgs[i]) == 0;
+	CHECK(ok);
+	checkConsistent(&c1);
+	checkFormat(&c1, fmt);
+
+	/* the minimum size is reached, the format kept */
+	CHECK(corpusGenerate(&big, fmt, "large", 2048, NMSGS) == 0);
+	for(i = 0 ; i < NMSGS ; ++i)
+		ok &= big.lens[i] >= 2048;
+	CHECK(ok);
+	checkConsistent(&big);
+	checkFormat(&big, fmt);
+
+	corpusFree(&c1);
+	corpusFree(&c2);
+	corpusFree(&big);
+	CHECK(big.nMsgs == 0 && big.msgs == NULL);
+}
+
+int
+main(void)
+{
+	checkCorpus(CORPUS_RFC3164, "rfc3164-small");
+	checkCorpus(CORPUS_RFC5424, "rfc5424-small");
+	checkCorpus(CORPUS_JSON, "json-small");
+	return CHECK_RESULT();
+}
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Smoke test for the thread scaling benchmark: a short run of every
+# mode with two thread counts must produce one sane result line each.
+#
+# This file is part of libestr.
+# Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+# Released under the LGPL v2.1, see the file "COPYING".
+scale=../bench/estrscale
+test -x $scale || exit 77
+
+out=$($scale -t 20 -T 1,3 -B 4 -m malloc,pool,arena) || exit 1
+for mode in malloc pool arena ; do
+	# the pool may not be supported on this platform
+	if test $mode = pool && ! echo "$out" | grep -q '^pool,' ; then
+		continue
+	fi
+	for threads in 1 3 ; do
+		# mode,threads,ops,... with a non-zero ops count
+		echo "$out" | grep -q "^$mode,$threads,[1-9][0-9]*," || {
+			echo "no result for $mode with $threads threads:"
+			echo "$out"
+			exit 1
+		}
+	done
+done
+# efficiency is relative to the first run of each mode
+echo "$out" | grep -q '^malloc,1,[0-9]*,[0-9.]*,[0-9]*,[0-9]*,1\.000,' || exit 1
+
+$scale -j -t 10 -T 2 -m arena | grep -q '^{"mode":"arena","threads":2,' || exit 1
+# bad arguments are rejected
+$scale -B 0 >/dev/null 2>&1 && exit 1
+$scale -T 0 -t 1 >/dev/null 2>&1 && exit 1
+exit 0
@@ -0,0 +1,106 @@
+/**
+ * @file case.c
+ * Tests for ASCII case conversion.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+static unsigned char
+refLower(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+}
+
+static unsigned char
+refUpper(unsigned char c)
+{
+	return (c >= 'a' && c <= 'z') ? c - 0x20 : c;
+}
+
+/* Inputs of 0..100 bytes with all byte values, so that the 16 and 32
+ * byte blocks, the trailing partial blocks and the bytes next to the
+ * letter ranges ('@', '[', '`', '{' and the high bytes) are covered.
+ * The appending variants write to an odd offset.
+ */
+static void
+checkAllBytes(void)
+{
+	unsigned char in[101], lower[101], upper[101];
+	es_str_t *s;
+	size_t len, i, start;
+	int ok = 1;
+
+	for(start = 0 ; start < 256 ; start += 37) {
+		for(len = 0 ; len < sizeof(in) ; ++len) {
+			for(i = 0 ; i < len ; ++i) {
+				in[i] = (unsigned char) (start + i * 7);
+				lower[i] = refLower(in[i]);
+				upper[i] = refUpper(in[i]);
+			}
+			s = es_newStrFromBuf((char*) in, len);
+			es_tolower(s);
+			ok &= es_strlen(s) == len && memcmp(es_getBufAddr(s), lower, len) == 0;
+			es_toupper(s);
+			ok &= es_strlen(s) == len && memcmp(es_getBufAddr(s), upper, len) == 0;
+			es_deleteStr(s);
+
+			s = es_newStrFromCStr("x", 1);
+			ok &= es_addLower(&s, (char*) in, len) == 0;
+			ok &= es_addUpper(&s, (char*) in, len) == 0;
+			ok &= es_strlen(s) == 1 + 2 * len
+			      && memcmp(es_getBufAddr(s) + 1, lower, len) == 0
+			      && memcmp(es_getBufAddr(s) + 1 + len, upper, len) == 0;
+			es_deleteStr(s);
+		}
+	}
+	CHECK(ok);
+}
+
+static void
+checkCOW(void)
+{
+	es_str_t *s = es_newStrFromCStr("MiXeD", 5);
+	es_str_t *copy = es_strshare(s);
+
+	CHECK(es_tolowerCOW(&s) == 0);
+	CHECK_STR(s, "mixed");
+	CHECK_STR(copy, "MiXeD");
+	CHECK(es_toupperCOW(&copy) == 0); /* no other owner any more */
+	CHECK_STR(copy, "MIXED");
+	CHECK(es_addUpper(&s, "", 0) == 0);
+	CHECK_STR(s, "mixed");
+	es_deleteStr(copy);
+	es_deleteStr(s);
+}
+
+int
+main(void)
+{
+	checkAllBytes();
+	checkCOW();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,50 @@
+/**
+ * @file check.h
+ * Helpers shared by the test programs.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#ifndef CHECK_H_INCLUDED
+#define CHECK_H_INCLUDED
+#include <stdio.h>
+#include <string.h>
+
+static int nErrors = 0;
+
+/* report a failed condition, but keep going to find all of them */
+#define CHECK(cond) \
+	do { \
+		if(!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			++nErrors; \
+		} \
+	} while(0)
+
+/* check that a string has exactly the given contents */
+#define CHECK_STR(s, cstr) \
+	CHECK((s) != NULL && es_strlen(s) == strlen(cstr) \
+	      && memcmp(es_getBufAddr(s), (cstr), strlen(cstr)) == 0)
+
+/* exit status for automake's test driver */
+#define CHECK_RESULT() (nErrors == 0 ? 0 : 1)
+
+#endif /* #ifndef CHECK_H_INCLUDED */
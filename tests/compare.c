@@ -0,0 +1,163 @@
+/**
+ * @file compare.c
+ * Tests for string comparisons.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+static unsigned seed = 1;
+
+static unsigned
+rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+static unsigned char
+fold(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+}
+
+/* the original byte loops, whose exact results must be kept */
+static int
+refBufcmp(const unsigned char *c, size_t lenC, const unsigned char *buf, size_t lenBuf, int bCase)
+{
+	size_t i;
+	unsigned char a, b;
+
+	for(i = 0 ; i < lenC ; ++i) {
+		if(i == lenBuf)
+			return 1;
+		a = bCase ? fold(c[i]) : c[i];
+		b = bCase ? fold(buf[i]) : buf[i];
+		if(a != b)
+			return a - b;
+	}
+	return (lenC < lenBuf) ? -1 : 0;
+}
+
+static int
+refNcmp(const unsigned char *c1, size_t len1, const unsigned char *c2, size_t len2, size_t n,
+	int bCase)
+{
+	size_t i;
+	unsigned char a, b;
+
+	for(i = 0 ; i < n ; ++i) {
+		if(i >= len1)
+			return (i >= len2) ? 0 : -1;
+		if(i >= len2)
+			return 1;
+		a = bCase ? fold(c1[i]) : c1[i];
+		b = bCase ? fold(c2[i]) : c2[i];
+		if(a != b)
+			return a - b;
+	}
+	return 0;
+}
+
+/* Pairs with a common prefix of 0..100 bytes (crossing the 16 byte and
+ * 8 byte steps), followed by a difference in value or case, or with
+ * one string being a prefix of the other.
+ */
+static void
+checkAgainstReference(void)
+{
+	unsigned char b1[120], b2[120];
+	es_str_t *s1, *s2;
+	size_t len1, len2, common, i, n;
+	int round, ok = 1;
+
+	for(round = 0 ; round < 100000 ; ++round) {
+		common = rnd() % 101;
+		len1 = common + rnd() % 4;
+		len2 = common + rnd() % 4;
+		for(i = 0 ; i < common ; ++i) {
+			b1[i] = rnd() & 0xff;
+			b2[i] = b1[i];
+			/* same letter, but maybe a different case */
+			if(fold(b1[i]) >= 'a' && fold(b1[i]) <= 'z' && (rnd() & 1))
+				b2[i] ^= 0x20;
+		}
+		for(i = common ; i < len1 ; ++i)
+			b1[i] = "aAbB\x7f\x80"[rnd() % 6];
+		for(i = common ; i < len2 ; ++i)
+			b2[i] = "aAbB\x7f\x80"[rnd() % 6];
+		s1 = es_newStrFromBuf((char*) b1, len1);
+		s2 = es_newStrFromBuf((char*) b2, len2);
+		ok &= es_strbufcmp(s1, b2, len2) == refBufcmp(b1, len1, b2, len2, 0);
+		ok &= es_strcasebufcmp(s1, b2, len2) == refBufcmp(b1, len1, b2, len2, 1);
+		ok &= es_strcmp(s1, s2) == refBufcmp(b1, len1, b2, len2, 0);
+		ok &= es_strcasecmp(s1, s2) == refBufcmp(b1, len1, b2, len2, 1);
+		ok &= es_strequal(s1, s2) == (len1 == len2 && memcmp(b1, b2, len1) == 0);
+		n = rnd() % 110;
+		ok &= es_strncmp(s1, s2, n) == refNcmp(b1, len1, b2, len2, n, 0);
+		ok &= es_strncasecmp(s1, s2, n) == refNcmp(b1, len1, b2, len2, n, 1);
+		es_deleteStr(s1);
+		es_deleteStr(s2);
+	}
+	CHECK(ok);
+}
+
+static void
+checkSpecial(void)
+{
+	es_str_t *a = es_newStrFromCStr("abc", 3);
+	es_str_t *b = es_newStrFromCStr("ABC", 3);
+	es_str_t *empty = es_newStr(0);
+
+	CHECK(es_strcmp(a, b) == 'a' - 'A');
+	CHECK(es_strcasecmp(a, b) == 0);
+	CHECK(es_strconstcmp(a, "abcd") == -1);
+	CHECK(es_strconstcmp(a, "ab") == 1);
+	CHECK(es_strbufcmp(empty, (const unsigned char*) "", 0) == 0);
+	CHECK(es_strncmp(a, empty, 0) == 0);
+	CHECK(es_strncasecmp(empty, b, 3) == -1);
+	CHECK(es_strequal(a, a));
+	CHECK(!es_strequal(a, b));
+	CHECK(es_strequal(empty, empty));
+
+	/* strings with computed (possibly cached) hashes */
+	es_strhash(a, 0);
+	es_strhash(b, 0);
+	CHECK(!es_strequal(a, b));
+	es_tolower(b);
+	CHECK(es_strequal(a, b));
+	es_deleteStr(a);
+	es_deleteStr(b);
+	es_deleteStr(empty);
+}
+
+int
+main(void)
+{
+	checkAgainstReference();
+	checkSpecial();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,157 @@
+/**
+ * @file cow.c
+ * Tests for copy-on-write string sharing.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "libestr.h"
+#include "check.h"
+
+/* in COW mode, es_strdup() shares; modifying the copy must not change
+ * the original
+ */
+static void
+checkDupModify(void)
+{
+	es_str_t *s, *d;
+
+	s = es_newStrFromCStr("Hello\\tWorld", 12);
+	d = es_strdup(s);
+	CHECK(d == s); /* shared, not copied */
+
+	CHECK(es_tolowerCOW(&d) == 0);
+	CHECK(d != s);
+	CHECK_STR(d, "hello\\tworld");
+	CHECK_STR(s, "Hello\\tWorld");
+
+	es_deleteStr(d);
+	d = es_strdup(s);
+	CHECK(es_toupperCOW(&d) == 0);
+	CHECK_STR(d, "HELLO\\TWORLD");
+	CHECK_STR(s, "Hello\\tWorld");
+
+	es_deleteStr(d);
+	d = es_strdup(s);
+	CHECK(es_unescapeStrCOW(&d) == 0);
+	CHECK_STR(d, "Hello\tWorld");
+	CHECK_STR(s, "Hello\\tWorld");
+
+	es_deleteStr(d);
+	d = es_strdup(s);
+	CHECK(es_addBufConstcstr(&d, "!") == 0);
+	CHECK_STR(d, "Hello\\tWorld!");
+	CHECK_STR(s, "Hello\\tWorld");
+
+	/* the last owner may modify in place, no copy needed */
+	es_deleteStr(d);
+	d = es_strdup(s);
+	es_deleteStr(s);
+	s = d;
+	CHECK(es_tolowerCOW(&d) == 0);
+	CHECK(d == s);
+	CHECK_STR(d, "hello\\tworld");
+	es_tolower(d); /* exclusive again, so this is fine */
+	es_deleteStr(d);
+}
+
+/* es_strshare() works independent of the COW mode, and the explicit
+ * es_unshareStr() gives the caller a private copy
+ */
+static void
+checkShareUnshare(void)
+{
+	es_str_t *s, *d;
+
+	s = es_newStrFromCStr("abc", 3);
+	d = es_strshare(s);
+	CHECK(d == s);
+	CHECK(es_unshareStr(&d) == 0);
+	CHECK(d != s);
+	es_toupper(d);
+	CHECK_STR(d, "ABC");
+	CHECK_STR(s, "abc");
+	es_deleteStr(s);
+	es_deleteStr(d);
+}
+
+/* arena strings can not be shared, they are always copied */
+static void
+checkArena(void)
+{
+	es_arena_t *a;
+	es_str_t *s, *d;
+
+	a = es_newArena(0);
+	CHECK(a != NULL);
+	if(a == NULL)
+		return;
+	s = es_newStrFromBufInArena(a, "arena", 5);
+	d = es_strshare(s);
+	CHECK(d != s);
+	es_toupper(d);
+	CHECK_STR(d, "ARENA");
+	CHECK_STR(s, "arena");
+	es_deleteStr(d);
+	es_deleteArena(a);
+}
+
+/* in-place modification of a shared string must not go unnoticed */
+static void
+checkInPlaceAborts(void)
+{
+	es_str_t *s, *d;
+	pid_t pid;
+	int status;
+
+	s = es_newStrFromCStr("abc", 3);
+	d = es_strshare(s);
+	fflush(stderr);
+	if((pid = fork()) == 0) {
+		fclose(stderr); /* the abort message is expected */
+		es_tolower(d);
+		_exit(0);
+	}
+	CHECK(pid != -1 && waitpid(pid, &status, 0) == pid
+	      && WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+	CHECK_STR(s, "abc");
+	es_deleteStr(d);
+	es_deleteStr(s);
+}
+
+int
+main(void)
+{
+	checkShareUnshare();
+	checkArena();
+	checkInPlaceAborts();
+	es_setCOWMode(1);
+	checkDupModify();
+	es_setCOWMode(0);
+	return CHECK_RESULT();
+}
@@ -0,0 +1,145 @@
+/**
+ * @file glob.c
+ * Tests for wildcard pattern matching.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#define _GNU_SOURCE /* FNM_CASEFOLD */
+#include "config.h"
+#include <stdlib.h>
+#include <fnmatch.h>
+
+#include "libestr.h"
+#include "check.h"
+
+static int
+match(const char *pat, const char *subj, int bCaseInsensitive)
+{
+	es_glob_t *g;
+	int r;
+
+	if((g = es_newGlobFromBuf((const unsigned char*) pat, strlen(pat), bCaseInsensitive)) == NULL)
+		return -1;
+	r = es_globMatchBuf(g, (const unsigned char*) subj, strlen(subj));
+	es_deleteGlob(g);
+	return r;
+}
+
+static void
+checkBasic(void)
+{
+	CHECK(match("", "", 0) == 1);
+	CHECK(match("", "a", 0) == 0);
+	CHECK(match("*", "", 0) == 1);
+	CHECK(match("a*b*c", "axxbyyc", 0) == 1);
+	CHECK(match("a*b*c", "axxbyyc!", 0) == 0);
+	CHECK(match("*.log", "/var/log/messages.log", 0) == 1);
+	CHECK(match("?", "", 0) == 0);
+	CHECK(match("[a-c]x", "bx", 0) == 1);
+	CHECK(match("[!a-c]x", "bx", 0) == 0);
+	CHECK(match("[^a-c]x", "dx", 0) == 1);
+	CHECK(match("[]]", "]", 0) == 1);
+	CHECK(match("[!]]", "]", 0) == 0);
+	CHECK(match("[a-]", "-", 0) == 1);
+	CHECK(match("[ab", "[ab", 0) == 1); /* unterminated: literal '[' */
+	CHECK(match("\\*", "*", 0) == 1);
+	CHECK(match("\\*", "a", 0) == 0);
+	CHECK(match("a\\", "a\\", 0) == 1); /* trailing backslash matches itself */
+	CHECK(match("*a\\", "xa\\", 0) == 1);
+	CHECK(match("ABC", "abc", 0) == 0);
+	CHECK(match("ABC", "abc", 1) == 1);
+	CHECK(match("*B*", "abc", 1) == 1);
+}
+
+/* a case-insensitive class holds the folded bytes and range ends, the
+ * same as fnmatch() with FNM_CASEFOLD
+ */
+static void
+checkCaseFoldRanges(void)
+{
+	CHECK(match("[?-[A[]", "c", 1) == 0);
+	CHECK(match("[?-[A[]", "a", 1) == 1);
+	CHECK(match("[?-[A[]", "@", 1) == 1);
+	CHECK(match("?[bA-a]*", "xa", 1) == 1);
+	CHECK(match("?[bA-a]*", "xA", 1) == 1);
+	CHECK(match("?[bA-a]*", "xB", 1) == 1);
+	CHECK(match("?[bA-a]*", "xC", 1) == 0);
+	CHECK(match("?[bA-a]*", "x_", 1) == 0);
+	CHECK(match("[Z-a]", "z", 1) == 0); /* "z-a" is empty */
+	CHECK(match("[!Z-a]", "Q", 1) == 1);
+	CHECK(match("[a-Z]", "z", 0) == 0);
+	CHECK(match("[A-z]", "_", 1) == 0); /* "a-z" */
+	CHECK(match("[A-z]", "_", 0) == 1);
+}
+
+/* compare random patterns over a small alphabet against fnmatch() */
+static void
+checkFnmatch(void)
+{
+#ifdef FNM_CASEFOLD
+	static const char patChars[] = "aAbBzZ-!^[]\\*?/@`{";
+	static const char subjChars[] = "aAbBzZ-[]\\/@`{";
+	char pat[12], subj[10];
+	unsigned seed = 1;
+	int it, k, lenPat, lenSubj, bCI, nBad = 0;
+
+	for(it = 0 ; it < 200000 ; ++it) {
+		seed = seed * 1103515245 + 12345;
+		lenPat = (seed >> 8) % 10;
+		lenSubj = (seed >> 16) % 8;
+		bCI = (seed >> 24) & 1;
+		for(k = 0 ; k < lenPat ; ++k) {
+			seed = seed * 1103515245 + 12345;
+			pat[k] = patChars[(seed >> 16) % (sizeof(patChars) - 1)];
+		}
+		for(k = 0 ; k < lenSubj ; ++k) {
+			seed = seed * 1103515245 + 12345;
+			subj[k] = subjChars[(seed >> 16) % (sizeof(subjChars) - 1)];
+		}
+		pat[lenPat] = subj[lenSubj] = '\0';
+		/* fnmatch() fails a trailing backslash and a range that runs
+		 * into the pattern end; ours are literals. Named classes are
+		 * not supported.
+		 */
+		if(lenPat > 0 && (pat[lenPat - 1] == '\\' || pat[lenPat - 1] == '-'))
+			continue;
+		if(strstr(pat, "[:") != NULL || strstr(pat, "[=") != NULL
+		   || strstr(pat, "[.") != NULL)
+			continue;
+		if(match(pat, subj, bCI) != (fnmatch(pat, subj, bCI ? FNM_CASEFOLD : 0) == 0)) {
+			if(nBad++ < 10)
+				printf("mismatch: pattern '%s', subject '%s', case-insensitive %d\n",
+				       pat, subj, bCI);
+		}
+	}
+	CHECK(nBad == 0);
+#endif
+}
+
+int
+main(void)
+{
+	checkBasic();
+	checkCaseFoldRanges();
+	checkFnmatch();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,214 @@
+/**
+ * @file growth.c
+ * Regression checks for buffer size computation under growth policies.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "libestr.h"
+#include "libestr_int.h"
+#include "check.h"
+
+/* the rounded size must fit the request, or be 0; it must not wrap
+ * (or hang) for sizes close to the es_size_t limit
+ */
+static void
+checkRoundSize(const es_growthPolicy_t *p)
+{
+	es_size_t size, r;
+	unsigned k;
+
+	for(k = 0 ; k < 4096 ; ++k) {
+		size = (es_size_t)-1 - k;
+		r = es_int_roundSize(p, size);
+		CHECK(r == 0 || (r >= size && r % 8 == 0));
+	}
+	CHECK(es_int_roundSize(p, 0x90000000) >= 0x90000000);
+	for(size = 1 ; size < 65536 ; ++size) {
+		r = es_int_roundSize(p, size);
+		CHECK(r >= size && r % 8 == 0);
+	}
+}
+
+/* extending an empty buffer by nothing is not an error */
+static void
+checkEmpty(void)
+{
+	es_str_t *s;
+
+	s = es_newStr(0);
+	CHECK(s != NULL);
+	if(s != NULL)
+		CHECK(es_extendBuf(&s, 0) == 0);
+	es_deleteStr(s);
+}
+
+/* setting, getting and validating the policy */
+static void
+checkPolicy(void)
+{
+	const es_growthPolicy_t bad1 = { 99, 0, 0 };
+	const es_growthPolicy_t bad2 = { 1001, 0, 0 };
+	const es_growthPolicy_t p = { 150, 4096, 1 };
+	es_growthPolicy_t got;
+
+	CHECK(es_setGrowthPolicy(&bad1) == EINVAL);
+	CHECK(es_setGrowthPolicy(&bad2) == EINVAL);
+	CHECK(es_setGrowthPolicy(&p) == 0);
+	es_getGrowthPolicy(&got);
+	CHECK(got.factor == 150 && got.maxIncrement == 4096 && got.bRoundToBins == 1);
+	CHECK(es_setGrowthPolicy(NULL) == 0);
+	es_getGrowthPolicy(&got);
+	CHECK(got.factor == 200 && got.maxIncrement == 0 && got.bRoundToBins == 0);
+}
+
+/* new buffer size after extending a string with a 64 byte buffer */
+static es_size_t
+extendedSize(const es_growthPolicy_t *p, es_size_t minNeeded)
+{
+	es_str_t *s;
+	es_size_t lenBuf;
+
+	es_setGrowthPolicy(p);
+	s = es_newStr(64);
+	CHECK(s->lenBuf == 64);
+	es_addBufConstcstr(&s, "some data");
+	CHECK(es_extendBuf(&s, minNeeded) == 0);
+	CHECK_STR(s, "some data");
+	lenBuf = s->lenBuf;
+	es_deleteStr(s);
+	es_setGrowthPolicy(NULL);
+	return lenBuf;
+}
+
+static void
+checkExtend(void)
+{
+	const es_growthPolicy_t dbl = { 200, 0, 0 };
+	const es_growthPolicy_t half = { 150, 0, 0 };
+	const es_growthPolicy_t capped = { 200, 16, 0 };
+	const es_growthPolicy_t exact = { 100, 0, 0 };
+
+	CHECK(extendedSize(&dbl, 1) == 128);
+	CHECK(extendedSize(&half, 1) == 96);
+	CHECK(extendedSize(&capped, 1) == 80);
+	CHECK(extendedSize(&capped, 100) == 168);	/* more needed than the cap */
+	CHECK(extendedSize(&exact, 3) == 72);		/* rounded to 8 */
+}
+
+static void
+checkReserve(void)
+{
+	es_str_t *s, *copy;
+	unsigned char *addr;
+
+	s = es_newStrFromCStr("0123456789", 10);
+	CHECK(es_reserve(&s, 100) == 0);
+	CHECK(s->lenBuf == 112); /* no factor, only rounding */
+	addr = es_getBufAddr(s);
+	CHECK(es_reserve(&s, 50) == 0); /* enough space already */
+	CHECK(es_getBufAddr(s) == addr && s->lenBuf == 112);
+	CHECK(es_reserve(&s, (es_size_t) -1) == ENOMEM);
+	CHECK_STR(s, "0123456789");
+
+	/* a shared string is unshared first */
+	copy = es_strshare(s);
+	CHECK(es_reserve(&s, 0) == 0);
+	CHECK(s != copy);
+	CHECK(es_addBufConstcstr(&s, "!") == 0);
+	CHECK_STR(copy, "0123456789");
+	CHECK_STR(s, "0123456789!");
+	es_deleteStr(copy);
+	es_deleteStr(s);
+}
+
+static void
+checkShrink(void)
+{
+	const es_growthPolicy_t exact = { 100, 0, 0 };
+	es_str_t *s, *copy, *old;
+	es_arena_t *a;
+	es_size_t lenBuf;
+
+	s = es_newStr(1000);
+	es_addBufConstcstr(&s, "short");
+	CHECK(es_shrinkToFit(&s) == 0);
+	CHECK(s->lenBuf == 8);
+	CHECK_STR(s, "short");
+	es_emptyStr(s);
+	CHECK(es_shrinkToFit(&s) == 0);
+	CHECK(es_addBufConstcstr(&s, "usable") == 0);
+	CHECK_STR(s, "usable");
+
+	/* shared strings are left alone */
+	es_reserve(&s, 100);
+	lenBuf = s->lenBuf;
+	copy = es_strshare(s);
+	CHECK(es_shrinkToFit(&s) == 0);
+	CHECK(s == copy && s->lenBuf == lenBuf);
+	es_deleteStr(copy);
+	es_deleteStr(s);
+
+	/* in an arena, only the most recent allocation can shrink */
+	a = es_newArena(0);
+	CHECK(es_arenaSetGrowthPolicy(a, &exact) == 0);
+	old = es_newStrInArena(a, 200);
+	es_addBufConstcstr(&old, "old");
+	s = es_newStrInArena(a, 200);
+	es_addBufConstcstr(&s, "new");
+	CHECK(es_shrinkToFit(&old) == 0);
+	CHECK(old->lenBuf == 200);
+	CHECK(es_shrinkToFit(&s) == 0);
+	CHECK(s->lenBuf == 8);
+	/* ...and the space is reused, with the arena's policy */
+	CHECK(es_addBufConstcstr(&s, "er and longer") == 0);
+	CHECK(s->lenBuf == 16);
+	CHECK_STR(s, "newer and longer");
+	CHECK_STR(old, "old");
+	CHECK(es_arenaSetGrowthPolicy(a, &(es_growthPolicy_t) { 50, 0, 0 }) == EINVAL);
+	es_deleteArena(a);
+}
+
+int
+main(void)
+{
+	const es_growthPolicy_t bins = { 200, 0, 1 };
+	const es_growthPolicy_t round8 = { 200, 0, 0 };
+
+	alarm(10); /* a hang is a failure, too */
+	es_exitPool(); /* the pool would round to its size classes */
+	checkRoundSize(&round8);
+	checkRoundSize(&bins);
+	checkEmpty();
+	CHECK(es_setGrowthPolicy(&bins) == 0);
+	checkEmpty();
+	CHECK(es_setGrowthPolicy(NULL) == 0);
+	checkPolicy();
+	checkExtend();
+	checkReserve();
+	checkShrink();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,172 @@
+/**
+ * @file hash.c
+ * Tests for string hashing and the hash cache.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+/* straightforward XXH64, as in the specification, to check against */
+#define P1 11400714785074694791ULL
+#define P2 14029467366897019727ULL
+#define P3 1609587929392839161ULL
+#define P4 9650029242287828579ULL
+#define P5 2870177450012600261ULL
+
+static unsigned long long
+rotl(unsigned long long x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static unsigned long long
+rd(const unsigned char *p, int n)
+{
+	unsigned long long v = 0;
+	while(n-- > 0)
+		v = (v << 8) | p[n];
+	return v;
+}
+
+static unsigned long long
+round64(unsigned long long acc, unsigned long long in)
+{
+	return rotl(acc + in * P2, 31) * P1;
+}
+
+static unsigned long long
+refHash(const unsigned char *p, size_t len, unsigned long long seed)
+{
+	unsigned long long h, v[4];
+	size_t i = 0;
+	int j;
+
+	if(len >= 32) {
+		v[0] = seed + P1 + P2;
+		v[1] = seed + P2;
+		v[2] = seed;
+		v[3] = seed - P1;
+		for( ; i + 32 <= len ; i += 32)
+			for(j = 0 ; j < 4 ; ++j)
+				v[j] = round64(v[j], rd(p + i + 8 * j, 8));
+		h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+		for(j = 0 ; j < 4 ; ++j)
+			h = (h ^ round64(0, v[j])) * P1 + P4;
+	} else {
+		h = seed + P5;
+	}
+	h += len;
+	for( ; i + 8 <= len ; i += 8)
+		h = rotl(h ^ round64(0, rd(p + i, 8)), 27) * P1 + P4;
+	if(i + 4 <= len) {
+		h = rotl(h ^ (rd(p + i, 4) * P1), 23) * P2 + P3;
+		i += 4;
+	}
+	for( ; i < len ; ++i)
+		h = rotl(h ^ (p[i] * P5), 11) * P1;
+	h ^= h >> 33;
+	h *= P2;
+	h ^= h >> 29;
+	h *= P3;
+	h ^= h >> 32;
+	return h;
+}
+
+/* all lengths around the 32 byte blocks, with misaligned starts */
+static void
+checkReference(void)
+{
+	unsigned char buf[300];
+	size_t len, offs;
+	int i;
+
+	for(i = 0 ; i < (int) sizeof(buf) ; ++i)
+		buf[i] = (unsigned char) (i * 131 + 7);
+	CHECK(es_hashBuf(buf, 0, 0) == 0xEF46DB3751D8E999ULL);
+	CHECK(es_hashBuf((unsigned char*) "abc", 3, 0) == 0x44BC2CF5AD770999ULL);
+	for(offs = 0 ; offs < 8 ; ++offs)
+		for(len = 0 ; len + offs <= 200 ; ++len) {
+			CHECK(es_hashBuf(buf + offs, len, 0) == refHash(buf + offs, len, 0));
+			CHECK(es_hashBuf(buf + offs, len, 42) == refHash(buf + offs, len, 42));
+		}
+}
+
+/* string and view hashes are the buffer hash; the cache (if enabled)
+ * must never return a stale value
+ */
+static void
+checkStrHash(void)
+{
+	es_str_t *a, *b, *e;
+
+	a = es_newStrFromCStr("Hello, World", 12);
+	b = es_newStrFromCStr("Hello, World", 12);
+	e = es_newStr(16);
+	CHECK(es_strhash(a, 1) == es_hashBuf((unsigned char*) "Hello, World", 12, 1));
+	CHECK(es_strhash(a, 1) == es_strhash(a, 1));
+	CHECK(es_strhash(a, 2) == es_hashBuf((unsigned char*) "Hello, World", 12, 2));
+	CHECK(es_viewhash(es_viewFromStr(a), 5) == es_strhash(a, 5));
+
+	es_tolower(a);
+	CHECK(es_strhash(a, 2) == es_hashBuf((unsigned char*) "hello, world", 12, 2));
+	CHECK(es_strequal(a, b) == 0);
+	CHECK(es_addBufConstcstr(&a, "!") == 0);
+	CHECK(es_strhash(a, 2) == es_hashBuf((unsigned char*) "hello, world!", 13, 2));
+
+	/* emptied strings hash (and compare) like fresh empty ones */
+	es_strhash(a, 0);
+	es_strhash(b, 0);
+	es_emptyStr(a);
+	es_emptyStr(b);
+	CHECK(es_strequal(a, b) == 1);
+	CHECK(es_strhash(a, 0) == es_strhash(e, 0));
+
+	/* direct writes plus es_strInvalidateHash() */
+	es_addBufConstcstr(&a, "x");
+	es_strhash(a, 0);
+	es_getBufAddr(a)[0] = 'y';
+	es_strInvalidateHash(a);
+	CHECK(es_strhash(a, 0) == es_hashBuf((unsigned char*) "y", 1, 0));
+
+	/* equal strings with cached hashes are still equal */
+	es_addBufConstcstr(&b, "y");
+	es_strhash(b, 0);
+	CHECK(es_strequal(a, b) == 1);
+	es_strhash(b, 7);
+	CHECK(es_strequal(a, b) == 1);
+
+	es_deleteStr(a);
+	es_deleteStr(b);
+	es_deleteStr(e);
+}
+
+int
+main(void)
+{
+	checkReference();
+	checkStrHash();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,158 @@
+/**
+ * @file intern.c
+ * Tests for string interning.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "libestr.h"
+#include "check.h"
+
+#define NVALUES 1000
+#define NTHREADS 4
+
+static es_internTable_t *table;
+static es_str_t *canon[NVALUES];
+
+static int
+valueOf(int i, char *buf)
+{
+	return sprintf(buf, "host-%d.example.net", i);
+}
+
+/* equal contents give the same object, different ones do not */
+static void
+checkCanonical(void)
+{
+	char buf[64];
+	es_str_t *s, *c;
+	int i, len;
+
+	for(i = 0 ; i < NVALUES ; ++i) {
+		len = valueOf(i, buf);
+		canon[i] = es_internBuf(table, (unsigned char*) buf, len);
+		CHECK(canon[i] != NULL);
+	}
+	for(i = 0 ; i < NVALUES ; ++i) {
+		len = valueOf(i, buf);
+		s = es_newStrFromCStr(buf, len);
+		c = es_intern(table, s);
+		CHECK(c == canon[i]);
+		CHECK(c != s);
+		es_deleteStr(s);
+	}
+	CHECK(canon[0] != canon[1]);
+	c = es_internBuf(table, (unsigned char*) "", 0);
+	CHECK(c != NULL && es_strlen(c) == 0);
+	CHECK(es_internBuf(table, (unsigned char*) "", 0) == c);
+}
+
+/* modifying via an updatable pointer gives the caller a private copy;
+ * the table entry must stay intact
+ */
+static void
+checkReadOnly(void)
+{
+	es_str_t *s;
+
+	s = canon[7];
+	CHECK(es_addBufConstcstr(&s, "-modified") == 0);
+	CHECK(s != canon[7]);
+	CHECK_STR(s, "host-7.example.net-modified");
+	CHECK_STR(canon[7], "host-7.example.net");
+	es_deleteStr(s);
+
+	s = canon[8];
+	CHECK(es_toupperCOW(&s) == 0);
+	CHECK(s != canon[8]);
+	CHECK_STR(canon[8], "host-8.example.net");
+	es_deleteStr(s);
+
+	s = canon[9];
+	CHECK(es_unshareStr(&s) == 0);
+	CHECK(s != canon[9]);
+	es_deleteStr(s);
+
+	/* es_deleteStr() and es_strshare() on interned strings are no-ops */
+	es_deleteStr(canon[10]);
+	CHECK(es_strshare(canon[10]) == canon[10]);
+	es_deleteStr(canon[10]);
+	CHECK_STR(canon[10], "host-10.example.net");
+	CHECK(es_internBuf(table, (unsigned char*) "host-7.example.net", 18) == canon[7]);
+}
+
+/* concurrent lookups and inserts must agree on the canonical objects */
+static void *
+worker(void *arg)
+{
+	char buf[64];
+	es_str_t *c;
+	int i, len;
+	long nBad = 0;
+
+	for(i = 0 ; i < 4 * NVALUES ; ++i) {
+		len = valueOf(i, buf);
+		c = es_internBuf(table, (unsigned char*) buf, len);
+		if(c == NULL || (i < NVALUES && c != canon[i])
+		   || es_strlen(c) != (es_size_t) len)
+			++nBad;
+	}
+	(void) arg;
+	return (void*) nBad;
+}
+
+static void
+checkThreads(void)
+{
+	pthread_t thrd[NTHREADS];
+	void *nBad;
+	char buf[64];
+	int i, len;
+
+	for(i = 0 ; i < NTHREADS ; ++i)
+		CHECK(pthread_create(&thrd[i], NULL, worker, NULL) == 0);
+	for(i = 0 ; i < NTHREADS ; ++i) {
+		pthread_join(thrd[i], &nBad);
+		CHECK(nBad == NULL);
+	}
+	/* values inserted by the threads are unique, too */
+	len = valueOf(3 * NVALUES, buf);
+	CHECK(es_internBuf(table, (unsigned char*) buf, len)
+	      == es_internBuf(table, (unsigned char*) buf, len));
+}
+
+int
+main(void)
+{
+	table = es_newInternTable(0); /* start small, so the table grows */
+	CHECK(table != NULL);
+	if(table == NULL)
+		return CHECK_RESULT();
+	checkCanonical();
+	checkReadOnly();
+	checkThreads();
+	es_deleteInternTable(table);
+	return CHECK_RESULT();
+}
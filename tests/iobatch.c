@@ -0,0 +1,179 @@
+/**
+ * @file iobatch.c
+ * Tests for scatter/gather output batches.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "libestr.h"
+#include "check.h"
+
+/* read everything written to a temporary file so far */
+static size_t
+readBack(int fd, char *buf, size_t size)
+{
+	ssize_t n;
+	size_t len = 0;
+
+	lseek(fd, 0, SEEK_SET);
+	while(len < size && (n = read(fd, buf + len, size - len)) > 0)
+		len += n;
+	return len;
+}
+
+static void
+checkFlush(int fd)
+{
+	es_iobatch_t *b;
+	es_rope_t *rope;
+	es_str_t *s;
+	char buf[256];
+	size_t len;
+
+	b = es_newIOBatch(1); /* must grow */
+	rope = es_newRope(4);
+	s = es_newStrFromCStr("string", 6);
+	es_ropeAddBufConstcstr(rope, "rope-data");
+	CHECK(es_iobatchLen(b) == 0);
+	CHECK(es_iobatchFlush(b, fd) == 0); /* empty batch */
+	CHECK(es_iobatchAddBufConstcstr(b, "<") == 0);
+	CHECK(es_iobatchAddStr(b, s) == 0);
+	CHECK(es_iobatchAddBuf(b, "", 0) == 0);
+	CHECK(es_iobatchAddRope(b, rope) == 0);
+	CHECK(es_iobatchAddBufConstcstr(b, ">\n") == 0);
+	CHECK(es_iobatchLen(b) == 18);
+	CHECK(es_iobatchFlush(b, fd) == 0);
+	CHECK(es_iobatchLen(b) == 0);
+	len = readBack(fd, buf, sizeof(buf));
+	CHECK(len == 18 && memcmp(buf, "<stringrope-data>\n", 18) == 0);
+
+	/* a reset batch discards its entries */
+	es_iobatchAddBufConstcstr(b, "discarded");
+	es_resetIOBatch(b);
+	CHECK(es_iobatchLen(b) == 0);
+	CHECK(es_iobatchFlush(b, fd) == 0);
+	CHECK(readBack(fd, buf, sizeof(buf)) == 18);
+
+	/* bad descriptor: error reported, data kept */
+	es_iobatchAddBufConstcstr(b, "kept");
+	CHECK(es_iobatchFlush(b, -1) == EBADF);
+	CHECK(es_iobatchLen(b) == 4);
+
+	es_deleteStr(s);
+	es_deleteRope(rope);
+	es_deleteIOBatch(b);
+}
+
+/* more entries than one writev() call accepts */
+static void
+checkManyEntries(int fd)
+{
+	static const char digits[] = "0123456789";
+	es_iobatch_t *b;
+	char *buf;
+	int i;
+	const int n = 5000;
+
+	b = es_newIOBatch(0);
+	for(i = 0 ; i < n ; ++i)
+		CHECK(es_iobatchAddBuf(b, digits + i % 10, 1) == 0);
+	CHECK(ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0);
+	CHECK(es_iobatchFlush(b, fd) == 0);
+	buf = malloc(n + 1);
+	CHECK(readBack(fd, buf, n + 1) == (size_t) n);
+	for(i = 0 ; i < n ; ++i)
+		if(buf[i] != digits[i % 10])
+			break;
+	CHECK(i == n);
+	free(buf);
+	es_deleteIOBatch(b);
+}
+
+/* partial writes to a non-blocking pipe: EAGAIN keeps the rest, and
+ * retries continue exactly where the last write stopped
+ */
+static void
+checkPartial(void)
+{
+	es_iobatch_t *b;
+	char *data, *got;
+	int fds[2];
+	int i, r, nRetries = 0;
+	ssize_t n;
+	size_t len = 0;
+	const size_t size = 1024 * 1024;
+
+	CHECK(pipe(fds) == 0);
+	fcntl(fds[0], F_SETFL, O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, O_NONBLOCK);
+	data = malloc(size);
+	got = malloc(size);
+	for(i = 0 ; i < (int) size ; ++i)
+		data[i] = (char) (i * 7 + i / 4096);
+	b = es_newIOBatch(0);
+	for(i = 0 ; i < (int) size ; i += 1000)
+		es_iobatchAddBuf(b, data + i, (size - i < 1000) ? size - i : 1000);
+
+	while((r = es_iobatchFlush(b, fds[1])) == EAGAIN) {
+		++nRetries;
+		CHECK(es_iobatchLen(b) > 0);
+		while((n = read(fds[0], got + len, size - len)) > 0)
+			len += n;
+		/* everything written so far has been read back */
+		CHECK(len == size - es_iobatchLen(b));
+	}
+	CHECK(r == 0);
+	CHECK(nRetries > 0); /* 1 MiB does not fit into a pipe buffer */
+	CHECK(es_iobatchLen(b) == 0);
+	while((n = read(fds[0], got + len, size - len)) > 0)
+		len += n;
+	CHECK(len == size && memcmp(data, got, size) == 0);
+
+	es_deleteIOBatch(b);
+	free(data);
+	free(got);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+int
+main(void)
+{
+	char name[] = "/tmp/estrtestXXXXXX";
+	int fd;
+
+	if((fd = mkstemp(name)) == -1) {
+		perror("mkstemp");
+		return 1;
+	}
+	unlink(name);
+	checkFlush(fd);
+	checkManyEntries(fd);
+	close(fd);
+	checkPartial();
+	return CHECK_RESULT();
+}
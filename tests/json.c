@@ -0,0 +1,193 @@
+/**
+ * @file json.c
+ * Tests for JSON string escaping.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+/* straightforward reference for es_addJSONEscaped(); returns the
+ * escaped length (out must have room for 6 * len bytes)
+ */
+static size_t
+refEscape(char *out, const unsigned char *buf, size_t len)
+{
+	size_t i, n = 0;
+
+	for(i = 0 ; i < len ; ++i) {
+		switch(buf[i]) {
+		case '"':  n += sprintf(out + n, "\\\""); break;
+		case '\\': n += sprintf(out + n, "\\\\"); break;
+		case '\b': n += sprintf(out + n, "\\b"); break;
+		case '\f': n += sprintf(out + n, "\\f"); break;
+		case '\n': n += sprintf(out + n, "\\n"); break;
+		case '\r': n += sprintf(out + n, "\\r"); break;
+		case '\t': n += sprintf(out + n, "\\t"); break;
+		default:
+			if(buf[i] < 0x20)
+				n += sprintf(out + n, "\\u%04x", buf[i]);
+			else
+				out[n++] = buf[i];
+		}
+	}
+	return n;
+}
+
+static int
+checkEscaped(const char *prefix, const unsigned char *buf, size_t len)
+{
+	es_str_t *s;
+	char *exp;
+	size_t lenPrefix = strlen(prefix), lenExp;
+	int ok;
+
+	exp = malloc(lenPrefix + 6 * len + 1);
+	memcpy(exp, prefix, lenPrefix);
+	lenExp = lenPrefix + refEscape(exp + lenPrefix, buf, len);
+	s = es_newStrFromCStr(prefix, lenPrefix);
+	ok = es_addJSONEscaped(&s, (const char*) buf, len) == 0
+	     && es_strlen(s) == lenExp
+	     && memcmp(es_getBufAddr(s), exp, lenExp) == 0;
+	es_deleteStr(s);
+	free(exp);
+	return ok;
+}
+
+static void
+checkBasic(void)
+{
+	es_str_t *s = es_newStr(1);
+	unsigned char all[256];
+	int i;
+
+	CHECK(es_addJSONEscaped(&s, "", 0) == 0);
+	CHECK(es_strlen(s) == 0);
+	CHECK(es_addBufConstcstr(&s, "x") == 0);
+	CHECK(es_addJSONEscaped(&s, "a\"b\\c\n\x01\x7f", 8) == 0);
+	CHECK_STR(s, "xa\\\"b\\\\c\\n\\u0001\x7f");
+	es_deleteStr(s);
+
+	for(i = 0 ; i < 256 ; ++i)
+		all[i] = (unsigned char) i;
+	CHECK(checkEscaped("", all, sizeof(all)));
+	CHECK(checkEscaped("prefix", all, 32)); /* nothing but escapes */
+}
+
+/* single special bytes at every position of inputs around the 16 and
+ * 32 byte block sizes, including the trailing partial blocks
+ */
+static void
+checkBlocks(void)
+{
+	static const unsigned char specials[] = { '"', '\\', '\n', 0x00, 0x1f, 0x80 };
+	unsigned char buf[100];
+	size_t len, pos, k;
+	int ok = 1;
+
+	for(len = 1 ; len <= sizeof(buf) ; ++len) {
+		memset(buf, 'a', len);
+		ok &= checkEscaped("", buf, len);
+		for(pos = 0 ; pos < len ; ++pos) {
+			for(k = 0 ; k < sizeof(specials) ; ++k) {
+				buf[pos] = specials[k];
+				ok &= checkEscaped("p", buf, len);
+			}
+			buf[pos] = ' ';
+			ok &= checkEscaped("", buf, len);
+			buf[pos] = 'a';
+		}
+	}
+	CHECK(ok);
+}
+
+static void
+checkUTF8(void)
+{
+	es_str_t *s = es_newStr(1);
+
+	/* valid sequences are copied, including at the very end */
+	CHECK(es_addJSONEscapedUTF8(&s, "\xc3\xa4\"\xe2\x82\xac\xf0\x9f\x98\x80", 10) == 0);
+	CHECK_STR(s, "\xc3\xa4\\\"\xe2\x82\xac\xf0\x9f\x98\x80");
+	es_emptyStr(s);
+	/* stray continuation, truncated, overlong, surrogate, > U+10FFFF */
+	CHECK(es_addJSONEscapedUTF8(&s, "\x80|\xe2\x82|\xc0\xaf|\xed\xa0\x80|\xf4\x90\x80\x80", 16) == 0);
+	CHECK_STR(s, "\\ufffd|\\ufffd\\ufffd|\\ufffd\\ufffd|\\ufffd\\ufffd\\ufffd|"
+		  "\\ufffd\\ufffd\\ufffd\\ufffd");
+	es_emptyStr(s);
+	CHECK(es_addJSONEscapedUTF8(&s, "\n\xc3", 2) == 0); /* truncated at end */
+	CHECK_STR(s, "\\n\\ufffd");
+	es_deleteStr(s);
+}
+
+/* the destination is grown at most once and to the exact size, no
+ * matter how many escapes follow; checked with a policy that grows by
+ * the amount needed only
+ */
+static void
+checkSingleGrow(void)
+{
+	const es_growthPolicy_t tight = { 100, 1, 0 };
+	es_stats_t st1, st2;
+	es_str_t *s, *copy;
+	char buf[4099];
+	int bStats;
+
+	CHECK(es_setGrowthPolicy(&tight) == 0);
+	memset(buf, 'a', sizeof(buf));
+	buf[0] = buf[1000] = '\n';
+	memset(buf + 2000, 0x01, 2000);
+	s = es_newStr(1);
+	bStats = es_getStats(&st1) == 0;
+	CHECK(es_addJSONEscaped(&s, buf, sizeof(buf)) == 0);
+	CHECK(es_strlen(s) == 2 + 2 + 6 * 2000 + sizeof(buf) - 2002);
+	CHECK(s->lenBuf - es_strlen(s) < 8);
+	if(bStats) {
+		es_getStats(&st2);
+		CHECK(st2.nRealloc - st1.nRealloc == 1);
+	}
+	es_deleteStr(s);
+	CHECK(es_setGrowthPolicy(NULL) == 0);
+
+	/* a shared destination is unshared first, the other copy is unchanged */
+	s = es_newStrFromCStr("shared", 6);
+	copy = es_strshare(s);
+	CHECK(es_addJSONEscaped(&s, "\t", 1) == 0);
+	CHECK_STR(s, "shared\\t");
+	CHECK_STR(copy, "shared");
+	es_deleteStr(copy);
+	es_deleteStr(s);
+}
+
+
+int
+main(void)
+{
+	checkBasic();
+	checkBlocks();
+	checkUTF8();
+	checkSingleGrow();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,153 @@
+/**
+ * @file kwtab.c
+ * Tests for keyword tables.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <errno.h>
+
+#include "libestr.h"
+#include "check.h"
+
+#define NKEYS 3000
+#define MAXKEYLEN 30
+
+static unsigned seed = 1;
+
+static unsigned
+rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+static int
+lookup(es_kwtab_t *t, const char *s)
+{
+	return es_kwtabLookupBuf(t, (const unsigned char*) s, strlen(s));
+}
+
+static void
+checkSeverities(void)
+{
+	static const char *names[] = { "emerg", "alert", "crit", "err", "warning",
+		"notice", "info", "debug" };
+	es_kwtab_t *t = es_newKwTab(1);
+	es_str_t *s;
+	int i;
+
+	CHECK(lookup(t, "emerg") == -1); /* not compiled */
+	CHECK(es_kwtabCompile(t) == 0);
+	CHECK(lookup(t, "emerg") == -1); /* empty */
+	for(i = 0 ; i < 8 ; ++i)
+		CHECK(es_kwtabAddBuf(t, (const unsigned char*) names[i], strlen(names[i])) == 0);
+	CHECK(lookup(t, "emerg") == -1); /* must be compiled again */
+	CHECK(es_kwtabCompile(t) == 0);
+	for(i = 0 ; i < 8 ; ++i)
+		CHECK(lookup(t, names[i]) == i);
+	CHECK(lookup(t, "WARNING") == 4);
+	CHECK(lookup(t, "Debug") == 7);
+	CHECK(lookup(t, "warn") == -1);
+	CHECK(lookup(t, "errr") == -1);
+	CHECK(lookup(t, "") == -1);
+	s = es_newStrFromCStr("NOTICE", 6);
+	CHECK(es_kwtabLookup(t, s) == 5);
+	es_deleteStr(s);
+
+	/* duplicates are detected, ignoring case if the table does */
+	CHECK(es_kwtabAddBuf(t, (const unsigned char*) "Crit", 4) == 0);
+	CHECK(es_kwtabCompile(t) == EEXIST);
+	es_deleteKwTab(t);
+	es_deleteKwTab(NULL);
+}
+
+/* many random keywords with all byte values; lookups of each keyword
+ * and of near misses (one byte changed, one byte shorter or longer)
+ */
+static void
+checkRandom(int bCaseInsensitive)
+{
+	static unsigned char keys[NKEYS][MAXKEYLEN + 1];
+	static size_t lens[NKEYS];
+	unsigned char buf[MAXKEYLEN + 1];
+	es_kwtab_t *t = es_newKwTab(bCaseInsensitive);
+	size_t i, j;
+	int k, r, ok = 1;
+
+	for(k = 0 ; k < NKEYS ; ++k) {
+		/* unique by construction: the keyword number is in the first bytes */
+		lens[k] = 4 + rnd() % (MAXKEYLEN - 3);
+		snprintf((char*) keys[k], sizeof(keys[k]), "%04d", k);
+		for(i = 4 ; i < lens[k] ; ++i)
+			keys[k][i] = rnd() & 0xff;
+		CHECK(es_kwtabAddBuf(t, keys[k], lens[k]) == 0);
+	}
+	CHECK(es_kwtabCompile(t) == 0);
+	for(k = 0 ; k < NKEYS ; ++k) {
+		memcpy(buf, keys[k], lens[k]);
+		if(bCaseInsensitive)
+			for(i = 0 ; i < lens[k] ; ++i)
+				if((buf[i] | 0x20) >= 'a' && (buf[i] | 0x20) <= 'z' && (rnd() & 1))
+					buf[i] ^= 0x20;
+		ok &= es_kwtabLookupBuf(t, buf, lens[k]) == k;
+		ok &= es_kwtabLookupBuf(t, buf, lens[k] - 1) != k;
+		buf[lens[k]] = 'x';
+		ok &= es_kwtabLookupBuf(t, buf, lens[k] + 1) != k;
+		j = rnd() % lens[k];
+		buf[j] ^= (bCaseInsensitive && (buf[j] | 0x20) >= 'a' && (buf[j] | 0x20) <= 'z')
+			  ? 0x01 : 0x20; /* never just a case change */
+		r = es_kwtabLookupBuf(t, buf, lens[k]);
+		ok &= r != k;
+	}
+	CHECK(ok);
+	es_deleteKwTab(t);
+}
+
+/* only ASCII letters are folded, not the bytes next to them */
+static void
+checkFolding(void)
+{
+	es_kwtab_t *t = es_newKwTab(1);
+
+	es_kwtabAddBuf(t, (const unsigned char*) "@[\xc4", 3);
+	es_kwtabAddBuf(t, (const unsigned char*) "a-very-long-keyword-Z", 21);
+	CHECK(es_kwtabCompile(t) == 0);
+	CHECK(lookup(t, "@[\xc4") == 0);
+	CHECK(lookup(t, "`[\xc4") == -1);
+	CHECK(lookup(t, "@{\xc4") == -1);
+	CHECK(lookup(t, "@[\xe4") == -1);
+	CHECK(lookup(t, "A-VERY-LONG-KEYWORD-z") == 1);
+	CHECK(lookup(t, "a-very-long-keyword-\x1a") == -1);
+	es_deleteKwTab(t);
+}
+
+int
+main(void)
+{
+	checkSeverities();
+	checkRandom(0);
+	checkRandom(1);
+	checkFolding();
+	return CHECK_RESULT();
+}
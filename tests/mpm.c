@@ -0,0 +1,217 @@
+/**
+ * @file mpm.c
+ * Tests for the multi-pattern matcher.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+#define MAX_NEEDLES 64
+#define MAX_NEEDLE_LEN 8
+#define MAX_MATCHES 8192
+
+struct match {
+	unsigned id;
+	es_size_t offset;
+};
+
+struct matchList {
+	int n;
+	int stopAfter;	/**< return nonzero after this many matches, 0 = never */
+	struct match m[MAX_MATCHES];
+};
+
+static unsigned seed = 1;
+
+static unsigned
+rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+static unsigned char
+fold(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+}
+
+static int
+collect(void *usrptr, unsigned id, es_size_t offset)
+{
+	struct matchList *l = usrptr;
+
+	if(l->n < MAX_MATCHES) {
+		l->m[l->n].id = id;
+		l->m[l->n].offset = offset;
+	}
+	++l->n;
+	return l->stopAfter != 0 && l->n >= l->stopAfter;
+}
+
+static int
+matchesAt(const unsigned char *p, const unsigned char *needle, size_t len, int bCaseInsensitive)
+{
+	size_t j;
+
+	for(j = 0 ; j < len ; ++j)
+		if(bCaseInsensitive ? fold(p[j]) != fold(needle[j]) : p[j] != needle[j])
+			return 0;
+	return 1;
+}
+
+/* naive reference: by end position, longer needles first */
+static void
+refSearch(const unsigned char *hay, size_t lenHay, unsigned char needles[][MAX_NEEDLE_LEN],
+	  const size_t *lens, int nNeedles, int bCaseInsensitive, struct matchList *l)
+{
+	size_t end, len;
+	int k;
+
+	l->n = 0;
+	for(end = 1 ; end <= lenHay ; ++end) {
+		for(len = MAX_NEEDLE_LEN ; len > 0 ; --len) {
+			if(len > end)
+				continue;
+			for(k = 0 ; k < nNeedles ; ++k) {
+				if(lens[k] == len
+				   && matchesAt(hay + end - len, needles[k], len, bCaseInsensitive)
+				   && l->n < MAX_MATCHES) {
+					l->m[l->n].id = k;
+					l->m[l->n].offset = end - len;
+					++l->n;
+				}
+			}
+		}
+	}
+}
+
+/* random needle sets of different sizes and alphabets, so that the
+ * memchr, SSE2/AVX2 and no-prefilter paths are all used
+ */
+static void
+checkAgainstReference(const char *alphabet, size_t nAlpha, int nNeedles, int bCaseInsensitive)
+{
+	static struct matchList got, exp;
+	unsigned char needles[MAX_NEEDLES][MAX_NEEDLE_LEN];
+	size_t lens[MAX_NEEDLES];
+	unsigned char hay[300];
+	es_mpm_t *m;
+	size_t lenHay, i, pos;
+	int round, k, j, ok = 1;
+
+	for(round = 0 ; round < 50 ; ++round) {
+		m = es_newMPM(bCaseInsensitive);
+		for(k = 0 ; k < nNeedles ; ++k) {
+			do { /* duplicates would make the reporting order ambiguous */
+				lens[k] = 1 + rnd() % (nAlpha < 4 ? MAX_NEEDLE_LEN : 3);
+				for(i = 0 ; i < lens[k] ; ++i)
+					needles[k][i] = alphabet ? (unsigned char) alphabet[rnd() % nAlpha] : rnd() & 0xff;
+				for(j = 0 ; j < k ; ++j)
+					if(lens[j] == lens[k] && matchesAt(needles[j], needles[k], lens[k],
+									bCaseInsensitive))
+						break;
+			} while(j < k);
+			CHECK(es_mpmAddBuf(m, needles[k], lens[k], k) == 0);
+		}
+		CHECK(es_mpmCompile(m) == 0);
+		for(lenHay = 0 ; lenHay <= sizeof(hay) ; lenHay += 1 + rnd() % 50) {
+			for(i = 0 ; i < lenHay ; ++i)
+				hay[i] = alphabet ? (unsigned char) alphabet[rnd() % nAlpha] : rnd() & 0xff;
+			for(j = 0 ; j < 3 ; ++j) {
+				k = rnd() % nNeedles;
+				if(lens[k] <= lenHay) {
+					pos = rnd() % (lenHay - lens[k] + 1);
+					memcpy(hay + pos, needles[k], lens[k]);
+				}
+			}
+			refSearch(hay, lenHay, needles, lens, nNeedles, bCaseInsensitive, &exp);
+			got.n = 0;
+			got.stopAfter = 0;
+			ok &= es_mpmSearchBuf(m, hay, lenHay, collect, &got) == exp.n;
+			ok &= got.n == exp.n
+			      && memcmp(got.m, exp.m, (exp.n < MAX_MATCHES ? exp.n : MAX_MATCHES)
+					* sizeof(struct match)) == 0;
+			/* without callback, only the first match is reported */
+			ok &= es_mpmSearchBuf(m, hay, lenHay, NULL, NULL) == (exp.n > 0);
+		}
+		es_deleteMPM(m);
+	}
+	CHECK(ok);
+}
+
+static void
+checkApi(void)
+{
+	static struct matchList l;
+	es_str_t *hay = es_newStrFromCStr("he said: she sells his shells", 29);
+	es_str_t *needle = es_newStrFromCStr("he", 2);
+	es_mpm_t *m;
+
+	m = es_newMPM(0);
+	CHECK(es_mpmSearch(m, hay, collect, &l) == -1); /* not compiled */
+	CHECK(es_mpmCompile(m) == 0);
+	CHECK(es_mpmSearch(m, hay, collect, &l) == 0); /* no needles */
+	CHECK(es_mpmAdd(m, needle, 1) == 0);
+	CHECK(es_mpmSearch(m, hay, collect, &l) == -1); /* compile again */
+	CHECK(es_mpmAddBuf(m, (const unsigned char*) "she", 3, 2) == 0);
+	CHECK(es_mpmAddBuf(m, (const unsigned char*) "hells", 5, 1) == 0); /* shared id */
+	CHECK(es_mpmCompile(m) == 0);
+
+	l.n = 0;
+	l.stopAfter = 0;
+	CHECK(es_mpmSearch(m, hay, collect, &l) == 6);
+	CHECK(l.m[0].id == 1 && l.m[0].offset == 0);
+	CHECK(l.m[1].id == 2 && l.m[1].offset == 9);	/* "she" before "he" */
+	CHECK(l.m[2].id == 1 && l.m[2].offset == 10);
+	CHECK(l.m[3].id == 2 && l.m[3].offset == 23);
+	CHECK(l.m[4].id == 1 && l.m[4].offset == 24);
+	CHECK(l.m[5].id == 1 && l.m[5].offset == 24);	/* "hells" */
+
+	/* a nonzero callback result stops the search */
+	l.n = 0;
+	l.stopAfter = 2;
+	CHECK(es_mpmSearch(m, hay, collect, &l) == 2);
+	CHECK(l.n == 2);
+
+	es_deleteMPM(m);
+	es_deleteMPM(NULL);
+	es_deleteStr(needle);
+	es_deleteStr(hay);
+}
+
+int
+main(void)
+{
+	checkApi();
+	checkAgainstReference("ab", 2, 1, 0);
+	checkAgainstReference("ab", 2, 3, 0);
+	checkAgainstReference("abcdefgh", 8, 10, 0);
+	checkAgainstReference(NULL, 256, 60, 0);
+	checkAgainstReference("abAB", 4, 3, 1);
+	checkAgainstReference("abcdABCD@[", 10, 12, 1);
+	return CHECK_RESULT();
+}
@@ -0,0 +1,168 @@
+/**
+ * @file needle.c
+ * Tests for precompiled needles.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+static unsigned seed = 1;
+
+static unsigned
+rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+static unsigned char
+fold(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+}
+
+/* straightforward reference search */
+static int
+refSearch(const unsigned char *hay, size_t lenHay, const unsigned char *needle, size_t lenNeedle,
+	  int bCaseInsensitive)
+{
+	size_t i, j;
+
+	for(i = 0 ; i + lenNeedle <= lenHay ; ++i) {
+		for(j = 0 ; j < lenNeedle ; ++j) {
+			if(bCaseInsensitive ? fold(hay[i + j]) != fold(needle[j])
+					    : hay[i + j] != needle[j])
+				break;
+		}
+		if(j == lenNeedle)
+			return (int) i;
+	}
+	return -1;
+}
+
+/* fill a needle of the given kind: random, or periodic with a short
+ * period (the hard cases for Two-Way)
+ */
+static void
+makeNeedle(unsigned char *needle, size_t len, int kind, const char *alphabet, unsigned nAlpha)
+{
+	size_t i, period = (kind == 0) ? len : (size_t) kind;
+
+	for(i = 0 ; i < len ; ++i)
+		needle[i] = (i < period) ? alphabet[rnd() % nAlpha] : needle[i - period];
+}
+
+/* needles of 1..100 bytes (short ones use the vectorized engine, long
+ * ones Two-Way), planted and not planted in random haystacks; periodic
+ * needles produce many partial matches
+ */
+static void
+checkAgainstReference(int bCaseInsensitive)
+{
+	const char *alphabet = bCaseInsensitive ? "abAB" : "ab";
+	const unsigned nAlpha = bCaseInsensitive ? 4 : 2;
+	unsigned char hay[400], needle[100];
+	es_needle_t *n;
+	size_t lenNeedle, lenHay, pos, i;
+	int kind, r, ok = 1;
+
+	for(lenNeedle = 1 ; lenNeedle <= sizeof(needle) ; ++lenNeedle) {
+		for(kind = 0 ; kind < 4 ; ++kind) {
+			makeNeedle(needle, lenNeedle, kind, alphabet, nAlpha);
+			n = es_newNeedleFromBuf(needle, lenNeedle, bCaseInsensitive);
+			CHECK(n != NULL);
+			if(n == NULL)
+				continue;
+			for(lenHay = 0 ; lenHay <= sizeof(hay) ; lenHay += 1 + rnd() % 37) {
+				for(i = 0 ; i < lenHay ; ++i)
+					hay[i] = alphabet[rnd() % nAlpha];
+				/* unplanted: near misses only */
+				r = es_bufContainsNeedle(hay, lenHay, n);
+				ok &= r == refSearch(hay, lenHay, needle, lenNeedle, bCaseInsensitive);
+				if(lenNeedle > lenHay)
+					continue;
+				pos = rnd() % (lenHay - lenNeedle + 1);
+				memcpy(hay + pos, needle, lenNeedle);
+				if(bCaseInsensitive)
+					for(i = pos ; i < pos + lenNeedle ; i += 3)
+						hay[i] ^= 0x20;
+				r = es_bufContainsNeedle(hay, lenHay, n);
+				ok &= r == refSearch(hay, lenHay, needle, lenNeedle, bCaseInsensitive);
+				ok &= r >= 0 && r <= (int) pos;
+			}
+			es_deleteNeedle(n);
+		}
+	}
+	CHECK(ok);
+}
+
+/* results are the same as those of the plain search functions */
+static void
+checkApi(void)
+{
+	es_str_t *hay = es_newStrFromCStr("The quick brown fox jumps over the lazy dog, "
+		"the QUICK brown fox jumps over the lazy dog", 88);
+	es_str_t *pat;
+	es_needle_t *n;
+
+	pat = es_newStrFromCStr("", 0);
+	n = es_newNeedle(pat, 0);
+	CHECK(es_strContainsNeedle(hay, n) == 0);
+	CHECK(es_bufContainsNeedle(NULL, 0, n) == 0);
+	es_deleteNeedle(n);
+	es_deleteStr(pat);
+
+	pat = es_newStrFromCStr("quick brown fox jumps over the lazy dog", 39);
+	n = es_newNeedle(pat, 0);
+	CHECK(es_strContainsNeedle(hay, n) == 4);
+	CHECK(es_strContainsNeedle(hay, n) == es_strContains(hay, pat));
+	/* searching from an offset */
+	CHECK(es_bufContainsNeedle(es_getBufAddr(hay) + 5, 83, n) == -1);
+	es_deleteNeedle(n);
+	n = es_newNeedle(pat, 1);
+	CHECK(es_bufContainsNeedle(es_getBufAddr(hay) + 5, 83, n) == 44);
+	CHECK(es_strContainsNeedle(hay, n) == es_strCaseContains(hay, pat));
+	es_deleteNeedle(n);
+	es_deleteStr(pat);
+
+	/* the needle does not depend on the string it was made from */
+	pat = es_newStrFromCStr("lazy", 4);
+	n = es_newNeedle(pat, 0);
+	es_deleteStr(pat);
+	CHECK(es_strContainsNeedle(hay, n) == 35);
+	es_deleteNeedle(n);
+	es_deleteNeedle(NULL);
+	es_deleteStr(hay);
+}
+
+int
+main(void)
+{
+	checkAgainstReference(0);
+	checkAgainstReference(1);
+	checkApi();
+	return CHECK_RESULT();
+}
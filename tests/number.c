@@ -0,0 +1,157 @@
+/**
+ * @file number.c
+ * Tests for number formatting.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+
+#include "libestr.h"
+#include "check.h"
+
+#define NVALS 200
+
+static unsigned long long vals[NVALS];
+
+/* powers of two and ten and their neighbours, and the limits */
+static void
+makeValues(void)
+{
+	unsigned long long p;
+	int n = 0;
+
+	vals[n++] = 0;
+	vals[n++] = ULLONG_MAX;
+	vals[n++] = LLONG_MAX;
+	vals[n++] = (unsigned long long) LLONG_MAX + 1;
+	for(p = 10 ; p < ULLONG_MAX / 10 ; p *= 10) {
+		vals[n++] = p - 1;
+		vals[n++] = p;
+		vals[n++] = p + 1;
+	}
+	for(p = 16 ; p != 0 ; p <<= 4) {
+		vals[n++] = p - 1;
+		vals[n++] = p;
+	}
+	while(n < NVALS) {
+		vals[n] = vals[n - 1] * 6364136223846793005ULL + 1442695040888963407ULL;
+		vals[n] >>= n % 64;
+		++n;
+	}
+}
+
+/* es_str_t contents must equal the snprintf() result (after a prefix) */
+__attribute__((format(printf, 3, 4)))
+static int
+equals(es_str_t *s, const char *prefix, const char *fmt, ...)
+{
+	char buf[128];
+	size_t lenPrefix = strlen(prefix);
+	va_list ap;
+	int len;
+
+	strcpy(buf, prefix);
+	va_start(ap, fmt);
+	len = vsnprintf(buf + lenPrefix, sizeof(buf) - lenPrefix, fmt, ap) + lenPrefix;
+	va_end(ap);
+	return es_strlen(s) == (es_size_t) len && memcmp(es_getBufAddr(s), buf, len) == 0;
+}
+
+static void
+checkAgainstPrintf(void)
+{
+	es_str_t *s;
+	long long v;
+	int i, minDigits, ok = 1;
+
+	for(i = 0 ; i < NVALS ; ++i) {
+		v = (long long) vals[i];
+		/* an almost full destination, so that appending must grow it */
+		s = es_newStr(1);
+		es_addBufConstcstr(&s, "pfx");
+		ok &= es_addNumber(&s, v) == 0 && equals(s, "pfx", "%lld", v);
+		es_emptyStr(s);
+		if(v != LLONG_MIN)
+			ok &= es_addNumber(&s, -v) == 0 && equals(s, "", "%lld", -v);
+		es_emptyStr(s);
+		ok &= es_addUNumber(&s, vals[i]) == 0 && equals(s, "", "%llu", vals[i]);
+		es_emptyStr(s);
+		ok &= es_addHexNumber(&s, vals[i]) == 0 && equals(s, "", "%llx", vals[i]);
+		for(minDigits = 1 ; minDigits <= 25 ; ++minDigits) {
+			es_emptyStr(s);
+			ok &= es_addNumberPadded(&s, v, minDigits) == 0
+			      && equals(s, "", "%.*lld", minDigits, v);
+		}
+		/* unlike printf's "%.0lld", zero is printed as "0" */
+		es_emptyStr(s);
+		ok &= es_addNumberPadded(&s, v, 0) == 0 && equals(s, "", "%lld", v);
+		es_deleteStr(s);
+
+		s = es_newStrFromNumber(v);
+		ok &= equals(s, "", "%lld", v);
+		es_deleteStr(s);
+	}
+	CHECK(ok);
+}
+
+static void
+checkSpecial(void)
+{
+	es_str_t *s = es_newStrFromCStr("x", 1);
+	es_str_t *copy;
+	es_arena_t *a;
+
+	CHECK(es_addNumber(&s, LLONG_MIN) == 0);
+	CHECK_STR(s, "x-9223372036854775808");
+
+	/* padding that can not be represented fails and leaves s alone */
+	CHECK(es_addNumberPadded(&s, -1, (es_size_t) -1) == ENOMEM);
+	CHECK(es_addNumberPadded(&s, 1, (es_size_t) -1) == ENOMEM);
+	CHECK_STR(s, "x-9223372036854775808");
+
+	/* shared destinations are unshared */
+	copy = es_strshare(s);
+	CHECK(es_addHexNumber(&s, 0xbeef) == 0);
+	CHECK_STR(s, "x-9223372036854775808beef");
+	CHECK_STR(copy, "x-9223372036854775808");
+	es_deleteStr(copy);
+	es_deleteStr(s);
+
+	a = es_newArena(0);
+	s = es_newStrInArena(a, 0);
+	CHECK(es_addNumberPadded(&s, -42, 5) == 0);
+	CHECK_STR(s, "-00042");
+	es_deleteArena(a);
+}
+
+int
+main(void)
+{
+	makeValues();
+	checkAgainstPrintf();
+	checkSpecial();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,255 @@
+/**
+ * @file parse.c
+ * Tests for number parsing.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <locale.h>
+
+#include "libestr.h"
+#include "check.h"
+
+static unsigned seed = 1;
+
+static unsigned
+rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+static void
+randomString(char *buf, size_t maxLen, const char *alphabet, size_t *pLen)
+{
+	size_t i, len = rnd() % (maxLen + 1);
+
+	for(i = 0 ; i < len ; ++i)
+		buf[i] = alphabet[rnd() % strlen(alphabet)];
+	buf[len] = '\0';
+	*pLen = len;
+}
+
+/* es_str2num() as it was before parsing was rewritten, which must
+ * still give the same results
+ */
+static long long
+refStr2num(const unsigned char *c, size_t len, int *bSuccess)
+{
+	unsigned long long mag = 0;
+	size_t i = 0;
+	unsigned base = 10, d;
+	int bNegative = 0, bOverflow = 0;
+	unsigned long long max;
+
+	if(len == 0) {
+		*bSuccess = 0;
+		return 0;
+	}
+	if(c[0] == '-') {
+		bNegative = 1;
+		i = 1;
+	} else if(c[0] == '0') {
+		if(len > 1 && c[1] == 'x') {
+			base = 16;
+			i = 2;
+		} else {
+			base = 8;
+		}
+	}
+	max = bNegative ? (unsigned long long) LLONG_MAX + 1 : LLONG_MAX;
+	for( ; i < len ; ++i) {
+		if(c[i] >= '0' && c[i] <= '9')
+			d = c[i] - '0';
+		else if(c[i] >= 'a' && c[i] <= 'f')
+			d = c[i] - 'a' + 10;
+		else if(c[i] >= 'A' && c[i] <= 'F')
+			d = c[i] - 'A' + 10;
+		else
+			break;
+		if(d >= base)
+			break;
+		if(!bOverflow && (mag > (max - d) / base))
+			bOverflow = 1;
+		if(!bOverflow)
+			mag = mag * base + d;
+	}
+	*bSuccess = !bOverflow && i == len && !(base == 16 && len == 2);
+	if(bOverflow)
+		return bNegative ? LLONG_MIN : LLONG_MAX;
+	return bNegative ? (long long) -mag : (long long) mag;
+}
+
+static void
+checkStr2num(void)
+{
+	char buf[32];
+	es_str_t *s;
+	size_t len;
+	long long v, exp;
+	int bSuccess, bExp, round, ok = 1;
+
+	for(round = 0 ; round < 200000 ; ++round) {
+		randomString(buf, 24, (round & 1) ? "0123456789-" : "0123456789-xaFg8 ", &len);
+		s = es_newStrFromCStr(buf, len);
+		v = es_str2num(s, &bSuccess);
+		exp = refStr2num((unsigned char*) buf, len, &bExp);
+		ok &= v == exp && bSuccess == bExp;
+		es_deleteStr(s);
+	}
+	CHECK(ok);
+}
+
+/* unsigned parsing is strtoull() with base 0, minus signs and "0X" */
+static void
+checkParseUNum(void)
+{
+	char buf[32], *end;
+	unsigned long long v, exp;
+	es_size_t lenUsed;
+	size_t len;
+	int r, round, ok = 1;
+
+	for(round = 0 ; round < 200000 ; ++round) {
+		randomString(buf, 25, (round & 1) ? "0123456789" : "0123456789xabfgAF:/", &len);
+		if(len == 0 || buf[0] < '0' || buf[0] > '9')
+			continue;
+		r = es_viewParseUNum(es_viewFromBuf((unsigned char*) buf, len), &v, &lenUsed);
+		errno = 0;
+		exp = strtoull(buf, &end, 0);
+		ok &= v == exp && lenUsed == (es_size_t) (end - buf)
+		      && (r == ERANGE) == (errno == ERANGE) && (r == 0 || r == ERANGE);
+	}
+	CHECK(ok);
+}
+
+/* doubles are the same as with strtod() in the C locale */
+static void
+checkParseDouble(void)
+{
+	char buf[40], *end;
+	double v, exp;
+	es_size_t lenUsed;
+	size_t len;
+	int r, round, ok = 1;
+
+	for(round = 0 ; round < 200000 ; ++round) {
+		randomString(buf, (round & 1) ? 35 : 12, (round & 2) ? "0123456789.e-" : "0123456789.eE+-", &len);
+		if(buf[0] == '+')
+			continue; /* accepted by strtod() only */
+		r = es_viewParseDouble(es_viewFromBuf((unsigned char*) buf, len), &v, &lenUsed);
+		exp = strtod(buf, &end);
+		if(end == buf)
+			ok &= r == EINVAL && lenUsed == 0;
+		else
+			ok &= (r == 0 || r == ERANGE) && v == exp && lenUsed == (es_size_t) (end - buf);
+	}
+	CHECK(ok);
+}
+
+static void
+checkSpecial(void)
+{
+	static const char *longDigits = "123456789012345678901234567890";
+	long long v;
+	unsigned long long u;
+	double d;
+	es_size_t lenUsed, n;
+	char buf[40];
+	int bSuccess;
+
+	/* digits ending right before and after the 8 byte blocks, followed
+	 * by the bytes next to '0' and '9'
+	 */
+	for(n = 1 ; n <= 19 ; ++n) {
+		memcpy(buf, longDigits, n);
+		buf[n] = (n & 1) ? ':' : '/';
+		buf[n + 1] = '\0';
+		CHECK(es_viewParseUNum(es_viewFromBuf((unsigned char*) buf, n + 1), &u, &lenUsed) == 0);
+		CHECK(lenUsed == n && u == strtoull(buf, NULL, 10));
+	}
+
+	CHECK(es_viewParseNum(es_viewFromBuf((unsigned char*) "250ms", 5), &v, &lenUsed) == 0);
+	CHECK(v == 250 && lenUsed == 3);
+	CHECK(es_viewParseNum(es_viewFromBuf((unsigned char*) "ms", 2), &v, &lenUsed) == EINVAL);
+	CHECK(v == 0 && lenUsed == 0);
+	CHECK(es_viewParseNum(es_viewFromBuf((unsigned char*) "-", 1), &v, &lenUsed) == EINVAL);
+	CHECK(es_viewParseNum(es_viewFromBuf((unsigned char*) "-9223372036854775808", 20), &v, NULL) == 0);
+	CHECK(v == LLONG_MIN);
+	CHECK(es_viewParseNum(es_viewFromBuf((unsigned char*) "-9223372036854775809x", 21), &v, &lenUsed)
+	      == ERANGE);
+	CHECK(v == LLONG_MIN && lenUsed == 20);
+	CHECK(es_viewParseNum(es_viewFromBuf((unsigned char*) "0xffffffffffffffff", 18), &v, NULL) == ERANGE);
+	CHECK(v == LLONG_MAX);
+	CHECK(es_viewParseUNum(es_viewFromBuf((unsigned char*) "18446744073709551615", 20), &u, NULL) == 0);
+	CHECK(u == ULLONG_MAX);
+	CHECK(es_viewParseUNum(es_viewFromBuf((unsigned char*) "000000000000000000000000017", 27), &u, NULL) == 0);
+	CHECK(u == 017); /* octal, leading zeros do not overflow */
+	CHECK(es_viewParseUNum(es_viewFromBuf((unsigned char*) "-1", 2), &u, NULL) == EINVAL);
+
+	CHECK(es_viewParseDouble(es_viewFromBuf((unsigned char*) "1e", 2), &d, &lenUsed) == 0);
+	CHECK(d == 1.0 && lenUsed == 1); /* the marker without digits is not consumed */
+	CHECK(es_viewParseDouble(es_viewFromBuf((unsigned char*) "1e999", 5), &d, NULL) == ERANGE);
+	CHECK(d > 1e308);
+	CHECK(es_viewParseDouble(es_viewFromBuf((unsigned char*) "-1e999", 6), &d, NULL) == ERANGE);
+	CHECK(d < -1e308);
+	CHECK(es_viewParseDouble(es_viewFromBuf((unsigned char*) "inf", 3), &d, NULL) == EINVAL);
+
+	/* a lone "-" has always been accepted as 0 */
+	CHECK(es_view2num(es_viewFromBuf((unsigned char*) "-", 1), &bSuccess) == 0 && bSuccess);
+}
+
+/* the decimal point is '.' in all locales */
+static void
+checkLocale(void)
+{
+	static const char *locales[] = { "de_DE.UTF-8", "de_DE", "fr_FR.UTF-8", "fr_FR" };
+	const char *num = "3.14159265358979323846264338327950288"; /* needs strtod() */
+	double d;
+	int bSuccess;
+	size_t i;
+
+	for(i = 0 ; i < sizeof(locales) / sizeof(locales[0]) ; ++i)
+		if(setlocale(LC_NUMERIC, locales[i]) != NULL)
+			break;
+	if(i == sizeof(locales) / sizeof(locales[0]))
+		return; /* no locale with a different decimal point installed */
+	d = es_view2double(es_viewFromBuf((const unsigned char*) num, strlen(num)), &bSuccess);
+	CHECK(bSuccess && d > 3.1415926535 && d < 3.1415926536);
+	d = es_view2double(es_viewFromBuf((const unsigned char*) "2.5", 3), &bSuccess);
+	CHECK(bSuccess && d == 2.5);
+	setlocale(LC_NUMERIC, "C");
+}
+
+int
+main(void)
+{
+	checkStr2num();
+	checkParseUNum();
+	checkParseDouble();
+	checkSpecial();
+	checkLocale();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,153 @@
+/**
+ * @file pool.c
+ * Tests for the per-thread string pool.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "libestr.h"
+#include "check.h"
+
+#define NTHREADS 4
+#define NSTRS 64
+
+/* blocks are reused and buffers are rounded to the size classes */
+static void
+checkReuse(void)
+{
+	es_str_t *s, *big;
+	void *addr;
+	es_size_t hint;
+
+	for(hint = 1 ; hint <= 4096 ; hint += 37) {
+		s = es_newStr(hint);
+		CHECK(s != NULL && s->lenBuf >= hint);
+		addr = s;
+		es_deleteStr(s);
+		s = es_newStr(hint);
+		CHECK(s == addr); /* taken from the cache */
+		es_deleteStr(s);
+	}
+	/* large strings are not pooled, but work as usual */
+	big = es_newStr(100000);
+	CHECK(big != NULL && big->lenBuf >= 100000);
+	es_deleteStr(big);
+}
+
+/* content is kept while a string grows through the size classes */
+static void
+checkGrowth(void)
+{
+	es_str_t *s = es_newStr(1);
+	char buf[10];
+	int i, ok = 1;
+
+	for(i = 0 ; i < 1000 ; ++i) {
+		snprintf(buf, sizeof(buf), "%04d:", i);
+		ok &= es_addBuf(&s, buf, 5) == 0;
+	}
+	CHECK(ok && es_strlen(s) == 5000);
+	for(i = 0 ; i < 1000 ; ++i) {
+		snprintf(buf, sizeof(buf), "%04d:", i);
+		ok &= memcmp(es_getBufAddr(s) + 5 * i, buf, 5) == 0;
+	}
+	CHECK(ok);
+	es_deleteStr(s);
+}
+
+/* Each thread deletes strings created by its neighbour, so blocks move
+ * between thread caches. Threads exit with full caches, which must be
+ * freed (checked by leak detectors).
+ */
+static es_str_t *handover[NTHREADS][NSTRS];
+static pthread_barrier_t barrier;
+
+static void *
+worker(void *arg)
+{
+	const int me = (int) (long) arg;
+	const int other = (me + 1) % NTHREADS;
+	char buf[32];
+	int round, k, bad = 0;
+	size_t len;
+
+	for(round = 0 ; round < 100 ; ++round) {
+		for(k = 0 ; k < NSTRS ; ++k) {
+			len = snprintf(buf, sizeof(buf), "%d/%d/%d", me, round, k);
+			handover[me][k] = es_newStr(k * 40);
+			if(es_addBuf(&handover[me][k], buf, len) != 0)
+				++bad;
+		}
+		pthread_barrier_wait(&barrier);
+		for(k = 0 ; k < NSTRS ; ++k) {
+			len = snprintf(buf, sizeof(buf), "%d/%d/%d", other, round, k);
+			if(es_strbufcmp(handover[other][k], (unsigned char*) buf, len) != 0)
+				++bad;
+			es_deleteStr(handover[other][k]);
+		}
+		pthread_barrier_wait(&barrier);
+	}
+	return (void*) (long) bad;
+}
+
+static void
+checkThreads(void)
+{
+	pthread_t thrd[NTHREADS];
+	void *nBad;
+	long i;
+
+	pthread_barrier_init(&barrier, NULL, NTHREADS);
+	for(i = 0 ; i < NTHREADS ; ++i)
+		CHECK(pthread_create(&thrd[i], NULL, worker, (void*) i) == 0);
+	for(i = 0 ; i < NTHREADS ; ++i) {
+		pthread_join(thrd[i], &nBad);
+		CHECK(nBad == NULL);
+	}
+	pthread_barrier_destroy(&barrier);
+}
+
+int
+main(void)
+{
+	es_str_t *s;
+
+	if(es_initPool() == ENOTSUP) {
+		printf("pool not supported on this platform, skipping\n");
+		return 77; /* automake's SKIP */
+	}
+	checkReuse();
+	checkGrowth();
+	checkThreads();
+
+	/* strings from the pool can still be deleted after it is disabled */
+	s = es_newStrFromCStr("pooled", 6);
+	es_exitPool();
+	CHECK_STR(s, "pooled");
+	es_deleteStr(s);
+	checkGrowth();
+	return CHECK_RESULT();
+}
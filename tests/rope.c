@@ -0,0 +1,155 @@
+/**
+ * @file rope.c
+ * Tests for the rope string builder.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <sys/uio.h>
+
+#include "libestr.h"
+#include "check.h"
+
+#define CHUNK 16
+
+/* check flatten and iovec export against the expected contents */
+static void
+checkContents(es_rope_t *rope, const char *expect)
+{
+	struct iovec iov[64];
+	es_str_t *s;
+	size_t offs = 0;
+	int i, n;
+
+	CHECK(es_ropeLen(rope) == strlen(expect));
+	s = es_ropeFlatten(rope);
+	CHECK_STR(s, expect);
+	es_deleteStr(s);
+
+	n = es_ropeIovec(rope, iov, 64);
+	CHECK(n <= es_ropeNumChunks(rope));
+	for(i = 0 ; i < n ; ++i) {
+		CHECK(iov[i].iov_len > 0);
+		CHECK(offs + iov[i].iov_len <= strlen(expect)
+		      && memcmp(iov[i].iov_base, expect + offs, iov[i].iov_len) == 0);
+		offs += iov[i].iov_len;
+	}
+	CHECK(offs == strlen(expect));
+}
+
+static void
+checkAddBuf(void)
+{
+	es_rope_t *rope;
+	struct iovec iov[2];
+
+	rope = es_newRope(CHUNK);
+	checkContents(rope, "");
+	CHECK(es_ropeAddBuf(rope, "", 0) == 0);
+	checkContents(rope, "");
+	/* exactly one chunk, then spanning several, then a partial one */
+	CHECK(es_ropeAddBuf(rope, "0123456789abcdef", 16) == 0);
+	CHECK(es_ropeAddBuf(rope, "ghijklmnopqrstuvwxyzGHIJKLMNOPQRSTUVWXYZ", 40) == 0);
+	CHECK(es_ropeAddBufConstcstr(rope, "!") == 0);
+	checkContents(rope, "0123456789abcdefghijklmnopqrstuvwxyzGHIJKLMNOPQRSTUVWXYZ!");
+	CHECK(es_ropeNumChunks(rope) == 4);
+	/* too small iovec array */
+	CHECK(es_ropeIovec(rope, iov, 2) == 2);
+
+	/* a reset rope is empty, but reusable */
+	es_resetRope(rope);
+	checkContents(rope, "");
+	CHECK(es_ropeAddBufConstcstr(rope, "again") == 0);
+	checkContents(rope, "again");
+	es_deleteRope(rope);
+}
+
+/* without COW mode, added strings are copied and the caller can do
+ * whatever it likes with its string afterwards
+ */
+static void
+checkAddStrCopy(void)
+{
+	es_rope_t *rope;
+	es_str_t *small, *large;
+
+	rope = es_newRope(CHUNK);
+	small = es_newStrFromCStr("ab", 2);
+	large = es_newStrFromCStr("LARGE STRING", 12);
+	CHECK(es_ropeAddStr(rope, small) == 0);
+	CHECK(es_ropeAddStr(rope, large) == 0);
+	es_tolower(large);
+	es_emptyStr(small);
+	checkContents(rope, "abLARGE STRING");
+	es_deleteStr(large);
+	es_deleteStr(small);
+	checkContents(rope, "abLARGE STRING");
+	es_deleteRope(rope);
+}
+
+/* with COW mode, large strings are shared; the rope keeps the contents
+ * and length they had when they were added
+ */
+static void
+checkAddStrShared(void)
+{
+	es_rope_t *rope;
+	es_str_t *large, *orig;
+
+	es_setCOWMode(1);
+	rope = es_newRope(CHUNK);
+	orig = large = es_newStrFromCStr("LARGE STRING", 12);
+	CHECK(es_ropeAddStr(rope, large) == 0);
+	CHECK(es_ropeAddBufConstcstr(rope, "|") == 0);
+	CHECK(es_tolowerCOW(&large) == 0);
+	CHECK(large != orig);
+	CHECK_STR(large, "large string");
+	checkContents(rope, "LARGE STRING|");
+	es_deleteStr(large);
+
+	/* the rope owns a reference, so the string outlives the caller's */
+	large = es_newStrFromCStr("ANOTHER ONE", 11);
+	CHECK(es_ropeAddStr(rope, large) == 0);
+	es_deleteStr(large);
+	checkContents(rope, "LARGE STRING|ANOTHER ONE");
+
+	/* a direct (rule-breaking) length change must not make flatten
+	 * return uninitialized data
+	 */
+	large = es_newStrFromCStr("SHRINKING STR", 13);
+	CHECK(es_ropeAddStr(rope, large) == 0);
+	large->lenStr = 2;
+	checkContents(rope, "LARGE STRING|ANOTHER ONESHRINKING STR");
+	es_deleteStr(large);
+	es_deleteRope(rope);
+	es_setCOWMode(0);
+}
+
+int
+main(void)
+{
+	checkAddBuf();
+	checkAddStrCopy();
+	checkAddStrShared();
+	return CHECK_RESULT();
+}
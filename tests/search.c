@@ -0,0 +1,177 @@
+/**
+ * @file search.c
+ * Tests for substring searches.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+/* straightforward reference search */
+static int
+refContains(const unsigned char *hay, size_t lenHay, const unsigned char *needle, size_t lenNeedle)
+{
+	size_t i;
+
+	for(i = 0 ; i + lenNeedle <= lenHay ; ++i)
+		if(memcmp(hay + i, needle, lenNeedle) == 0)
+			return (int) i;
+	return -1;
+}
+
+/* reference for the case-insensitive search, ASCII letters only */
+static int
+refCaseContains(const unsigned char *hay, size_t lenHay, const unsigned char *needle, size_t lenNeedle)
+{
+	size_t i, j;
+	unsigned char a, b;
+
+	for(i = 0 ; i + lenNeedle <= lenHay ; ++i) {
+		for(j = 0 ; j < lenNeedle ; ++j) {
+			a = hay[i + j];
+			b = needle[j];
+			if(a >= 'A' && a <= 'Z')
+				a += 0x20;
+			if(b >= 'A' && b <= 'Z')
+				b += 0x20;
+			if(a != b)
+				break;
+		}
+		if(j == lenNeedle)
+			return (int) i;
+	}
+	return -1;
+}
+
+static int
+search(const unsigned char *hay, size_t lenHay, const unsigned char *needle, size_t lenNeedle,
+       int bCaseInsensitive)
+{
+	es_str_t *s1 = es_newStrFromBuf((char*) hay, lenHay);
+	es_str_t *s2 = es_newStrFromBuf((char*) needle, lenNeedle);
+	int r;
+
+	r = bCaseInsensitive ? es_strCaseContains(s1, s2) : es_strContains(s1, s2);
+	es_deleteStr(s1);
+	es_deleteStr(s2);
+	return r;
+}
+
+static int
+contains(const unsigned char *hay, size_t lenHay, const unsigned char *needle, size_t lenNeedle)
+{
+	return search(hay, lenHay, needle, lenNeedle, 0);
+}
+
+static int
+caseContains(const char *hay, const char *needle)
+{
+	return search((const unsigned char*) hay, strlen(hay),
+		      (const unsigned char*) needle, strlen(needle), 1);
+}
+
+static void
+checkEdgeCases(void)
+{
+	CHECK(contains((const unsigned char*) "", 0, (const unsigned char*) "", 0) == 0);
+	CHECK(contains((const unsigned char*) "abc", 3, (const unsigned char*) "", 0) == 0);
+	CHECK(contains((const unsigned char*) "", 0, (const unsigned char*) "a", 1) == -1);
+	CHECK(contains((const unsigned char*) "ab", 2, (const unsigned char*) "abc", 3) == -1);
+	CHECK(contains((const unsigned char*) "abc", 3, (const unsigned char*) "abc", 3) == 0);
+	CHECK(contains((const unsigned char*) "abc", 3, (const unsigned char*) "c", 1) == 2);
+	CHECK(contains((const unsigned char*) "a\0b\0c", 5, (const unsigned char*) "b\0c", 3) == 2);
+	CHECK(contains((const unsigned char*) "\xff\x80\xff", 3, (const unsigned char*) "\x80\xff", 2) == 1);
+}
+
+/* needles planted at every position of haystacks around the 16 and 32
+ * byte block sizes, over a small alphabet so that there are many
+ * candidates which only fail late (first and last byte match). For the
+ * case-insensitive search, the haystack uses random case.
+ */
+static void
+checkPlanted(int bCaseInsensitive)
+{
+	const char *alphabet = bCaseInsensitive ? "abAB" : "ab";
+	const unsigned mask = bCaseInsensitive ? 3 : 1;
+	unsigned char hay[100], needle[40];
+	size_t lenHay, lenNeedle, pos, i;
+	unsigned seed = 1;
+	int r, ok = 1;
+
+	for(lenHay = 0 ; lenHay <= sizeof(hay) ; ++lenHay) {
+		for(lenNeedle = 1 ; lenNeedle <= sizeof(needle) && lenNeedle <= lenHay ; ++lenNeedle) {
+			for(i = 0 ; i < lenNeedle ; ++i) {
+				seed = seed * 1103515245 + 12345;
+				needle[i] = alphabet[(seed >> 16) & mask];
+			}
+			for(pos = 0 ; pos + lenNeedle <= lenHay ; ++pos) {
+				for(i = 0 ; i < lenHay ; ++i) {
+					seed = seed * 1103515245 + 12345;
+					hay[i] = alphabet[(seed >> 16) & mask];
+				}
+				memcpy(hay + pos, needle, lenNeedle);
+				if(bCaseInsensitive)
+					for(i = pos ; i < pos + lenNeedle ; i += 2)
+						hay[i] ^= 0x20;
+				r = search(hay, lenHay, needle, lenNeedle, bCaseInsensitive);
+				ok &= r == (bCaseInsensitive ? refCaseContains(hay, lenHay, needle, lenNeedle)
+							     : refContains(hay, lenHay, needle, lenNeedle));
+				ok &= r >= 0 && r <= (int) pos;
+			}
+			/* not contained at all (only a near miss at the end) */
+			memset(hay, 'a', lenHay);
+			memset(needle, 'a', lenNeedle);
+			needle[lenNeedle - 1] = 'b';
+			ok &= search(hay, lenHay, needle, lenNeedle, bCaseInsensitive) == -1;
+		}
+	}
+	CHECK(ok);
+}
+
+/* only ASCII letters are folded, independent of the locale */
+static void
+checkCaseFolding(void)
+{
+	CHECK(caseContains("", "") == 0);
+	CHECK(caseContains("Hello World", "WORLD") == 6);
+	CHECK(caseContains("Hello World", "hello w") == 0);
+	CHECK(caseContains("Hello World", "worlds") == -1);
+	CHECK(caseContains("x\xc4y", "X\xe4Y") == -1); /* Latin-1 A/a umlaut */
+	CHECK(caseContains("x\xc4y", "X\xc4Y") == 0);
+	CHECK(caseContains("[@`{", "[@`{") == 0);
+	CHECK(caseContains("@", "`") == -1); /* 0x40 and 0x60 are not letters */
+	CHECK(caseContains("[", "{") == -1);
+}
+
+
+int
+main(void)
+{
+	checkEdgeCases();
+	checkPlanted(0);
+	checkPlanted(1);
+	checkCaseFolding();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,170 @@
+/**
+ * @file stats.c
+ * Tests for the allocation statistics.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "libestr.h"
+#include "check.h"
+
+/* difference of two snapshots, histograms included */
+static void
+diffStats(es_stats_t *d, const es_stats_t *before, const es_stats_t *after)
+{
+	int i;
+
+	d->nAlloc = after->nAlloc - before->nAlloc;
+	d->nFree = after->nFree - before->nFree;
+	d->bytesLive = after->bytesLive - before->bytesLive;
+	d->nRealloc = after->nRealloc - before->nRealloc;
+	d->bytesCopied = after->bytesCopied - before->bytesCopied;
+	for(i = 0 ; i < ES_STATS_NBUCKETS ; ++i) {
+		d->slackHist[i] = after->slackHist[i] - before->slackHist[i];
+		d->growthHist[i] = after->growthHist[i] - before->growthHist[i];
+	}
+}
+
+static void
+checkCounts(void)
+{
+	es_stats_t before, after, d;
+	es_str_t *s, *full, *half;
+	es_size_t lenBuf;
+	int i;
+
+	es_getStats(&before);
+	s = es_newStr(16);
+	lenBuf = s->lenBuf;
+	es_getStats(&after);
+	diffStats(&d, &before, &after);
+	CHECK(d.nAlloc == 1 && d.nFree == 0 && d.nRealloc == 0);
+	CHECK(d.bytesLive == (long long) lenBuf);
+
+	/* grow a few times; bytesLive follows the buffer */
+	for(i = 0 ; i < 10 ; ++i)
+		es_addBufConstcstr(&s, "0123456789abcdef");
+	es_getStats(&after);
+	diffStats(&d, &before, &after);
+	CHECK(d.nRealloc >= 1);
+	CHECK(d.bytesLive == (long long) s->lenBuf);
+	es_deleteStr(s);
+	es_getStats(&after);
+	diffStats(&d, &before, &after);
+	CHECK(d.nAlloc == 1 && d.nFree == 1 && d.bytesLive == 0);
+	CHECK(d.growthHist[0] == 0);
+	CHECK(d.growthHist[d.nRealloc < ES_STATS_NBUCKETS ? d.nRealloc : ES_STATS_NBUCKETS - 1] == 1);
+
+	/* slack buckets: a full, a half used and an empty buffer */
+	es_getStats(&before);
+	full = es_newStr(64);
+	half = es_newStr(64);
+	s = es_newStr(64);
+	while(full->lenStr < full->lenBuf)
+		es_addChar(&full, 'x');
+	while(half->lenStr < half->lenBuf / 2)
+		es_addChar(&half, 'x');
+	es_deleteStr(full);
+	es_deleteStr(half);
+	es_deleteStr(s);
+	es_getStats(&after);
+	diffStats(&d, &before, &after);
+	CHECK(d.nRealloc == 0);
+	CHECK(d.slackHist[0] == 1);
+	CHECK(d.slackHist[ES_STATS_NBUCKETS / 2] == 1);
+	CHECK(d.slackHist[ES_STATS_NBUCKETS - 1] == 1);
+	CHECK(d.growthHist[0] == 3);
+}
+
+/* strings inside an arena are not counted */
+static void
+checkArena(void)
+{
+	es_stats_t before, after;
+	es_arena_t *a;
+	es_str_t *s;
+	int i;
+
+	es_getStats(&before);
+	a = es_newArena(0);
+	s = es_newStrInArena(a, 8);
+	for(i = 0 ; i < 100 ; ++i)
+		es_addBufConstcstr(&s, "grow");
+	es_deleteStr(s);
+	es_deleteArena(a);
+	es_getStats(&after);
+	CHECK(after.nAlloc == before.nAlloc && after.nFree == before.nFree);
+	CHECK(after.nRealloc == before.nRealloc && after.bytesLive == before.bytesLive);
+}
+
+static void *
+worker(void *arg)
+{
+	int i;
+
+	(void) arg;
+	for(i = 0 ; i < 100 ; ++i)
+		es_deleteStr(es_newStr(32));
+	return NULL;
+}
+
+/* counts of terminated threads are kept */
+static void
+checkThreads(void)
+{
+	es_stats_t before, after;
+	pthread_t thrd[4];
+	int i;
+
+	es_getStats(&before);
+	for(i = 0 ; i < 4 ; ++i)
+		CHECK(pthread_create(&thrd[i], NULL, worker, NULL) == 0);
+	for(i = 0 ; i < 4 ; ++i)
+		pthread_join(thrd[i], NULL);
+	es_getStats(&after);
+	CHECK(after.nAlloc - before.nAlloc == 400);
+	CHECK(after.nFree - before.nFree == 400);
+	CHECK(after.bytesLive == before.bytesLive);
+}
+
+int
+main(void)
+{
+	es_stats_t st, zero;
+
+	memset(&st, 0xff, sizeof(st));
+	memset(&zero, 0, sizeof(zero));
+	if(es_getStats(&st) == ENOTSUP) {
+		CHECK(memcmp(&st, &zero, sizeof(st)) == 0);
+		return CHECK_RESULT();
+	}
+	es_exitPool(); /* keep buffer sizes as requested */
+	checkCounts();
+	checkArena();
+	checkThreads();
+	return CHECK_RESULT();
+}
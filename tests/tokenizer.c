@@ -0,0 +1,254 @@
+/**
+ * @file tokenizer.c
+ * Tests for the tokenizer and field iterator.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libestr.h"
+#include "check.h"
+
+#define MAXLEN 100
+#define MAXFIELDS (MAXLEN + 1)
+
+static unsigned seed = 42;
+
+static unsigned
+rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+/* split with a plain byte loop; returns the number of fields */
+static int
+refSplit(const unsigned char *isDelim, const unsigned char *buf, es_size_t len,
+	 int bMerge, es_size_t *offs, es_size_t *lens)
+{
+	es_size_t i = 0, start;
+	int n = 0;
+
+	while(1) {
+		if(bMerge) {
+			while(i < len && isDelim[buf[i]])
+				++i;
+			if(i == len)
+				return n;
+		}
+		start = i;
+		while(i < len && !isDelim[buf[i]])
+			++i;
+		offs[n] = start;
+		lens[n++] = i - start;
+		if(i == len)
+			return n;
+		++i;
+	}
+}
+
+/* compare iteration and es_fieldGet() against the reference */
+static int
+compareSplit(es_tokenizer_t *t, const unsigned char *isDelim,
+	     const unsigned char *buf, es_size_t len, int bMerge)
+{
+	es_size_t refOffs[MAXFIELDS], refLens[MAXFIELDS];
+	es_size_t offs, flen;
+	es_fielditer_t it;
+	int nRef, n;
+	int ok = 1;
+
+	nRef = refSplit(isDelim, buf, len, bMerge, refOffs, refLens);
+	es_fieldIterInit(&it, t, es_viewFromBuf(buf, len));
+	for(n = 0 ; es_fieldNext(&it, &offs, &flen) ; ++n) {
+		ok &= n < nRef && offs == refOffs[n] && flen == refLens[n];
+		ok &= !es_fieldIsQuoted(&it);
+		if(!ok)
+			return 0;
+	}
+	ok &= n == nRef;
+	ok &= !es_fieldNext(&it, &offs, &flen); /* stays done */
+	for(n = 0 ; n < nRef ; ++n) {
+		ok &= es_fieldGet(t, es_viewFromBuf(buf, len), n, &offs, &flen) == 0;
+		ok &= offs == refOffs[n] && flen == refLens[n];
+	}
+	ok &= es_fieldGet(t, es_viewFromBuf(buf, len), nRef, &offs, &flen) == ENOENT;
+	return ok;
+}
+
+/* Random data over all delimiter set sizes, so that the memchr, SSE2 and
+ * AVX2 (exact and inexact shufti tables) paths are all taken. Lengths
+ * cross the 16 and 32 byte block boundaries. The data also contains
+ * bytes that share a nibble with a delimiter, i.e. shufti candidates.
+ */
+static void
+checkRandom(int bMerge)
+{
+	static const es_size_t setSizes[] = { 1, 2, 3, 4, 8, 12, 40 };
+	unsigned char delims[64], alphabet[80], isDelim[256];
+	unsigned char buf[MAXLEN];
+	es_tokenizer_t *t;
+	es_size_t len, nAlpha;
+	unsigned i, k, round;
+	int ok = 1;
+
+	for(k = 0 ; k < sizeof(setSizes) / sizeof(setSizes[0]) ; ++k) {
+		for(round = 0 ; round < 20 ; ++round) {
+			memset(isDelim, 0, sizeof(isDelim));
+			for(i = 0 ; i < setSizes[k] ; ++i) {
+				delims[i] = (unsigned char) rnd();
+				isDelim[delims[i]] = 1;
+			}
+			nAlpha = 0;
+			for(i = 0 ; i < setSizes[k] && nAlpha < sizeof(alphabet) - 3 ; ++i) {
+				alphabet[nAlpha++] = delims[i];
+				alphabet[nAlpha++] = delims[i] ^ 0x01; /* same high nibble */
+				alphabet[nAlpha++] = delims[i] ^ 0x10; /* same low nibble */
+			}
+			alphabet[nAlpha++] = 'a';
+			t = es_newTokenizer(delims, setSizes[k], bMerge ? ES_TOK_MERGE_DELIMS : 0);
+			CHECK(t != NULL);
+			for(len = 0 ; len <= MAXLEN ; ++len) {
+				for(i = 0 ; i < len ; ++i)
+					buf[i] = alphabet[rnd() % nAlpha];
+				ok &= compareSplit(t, isDelim, buf, len, bMerge);
+			}
+			/* sparse delimiters: fields across many blocks */
+			for(i = 0 ; i < MAXLEN ; ++i)
+				buf[i] = (rnd() % 40 == 0) ? delims[rnd() % setSizes[k]] : 'a';
+			ok &= compareSplit(t, isDelim, buf, MAXLEN, bMerge);
+			es_deleteTokenizer(t);
+		}
+	}
+	CHECK(ok);
+}
+
+/* expect the fields of data, separated by '|' in exp */
+static int
+fieldsAre(es_tokenizer_t *t, const char *data, const char *exp)
+{
+	es_fielditer_t it;
+	es_size_t offs, flen, expLen;
+	const char *end;
+
+	es_fieldIterInit(&it, t, es_viewFromBuf((const unsigned char*) data, strlen(data)));
+	while(es_fieldNext(&it, &offs, &flen)) {
+		if(exp == NULL)
+			return 0;
+		end = strchr(exp, '|');
+		expLen = (end == NULL) ? strlen(exp) : (es_size_t) (end - exp);
+		if(flen != expLen || memcmp(data + offs, exp, flen) != 0)
+			return 0;
+		exp = (end == NULL) ? NULL : end + 1;
+	}
+	return exp == NULL;
+}
+
+static void
+checkEdgeCases(void)
+{
+	es_tokenizer_t *t, *merge;
+	es_size_t offs, flen;
+
+	CHECK(es_newTokenizer((const unsigned char*) ",", 0, 0) == NULL);
+	es_deleteTokenizer(NULL);
+
+	/* duplicate delimiter bytes are one delimiter */
+	t = es_newTokenizer((const unsigned char*) ",,,,", 4, 0);
+	merge = es_newTokenizer((const unsigned char*) " \t", 2, ES_TOK_MERGE_DELIMS);
+
+	/* empty data is one empty field, or none at all when merging */
+	CHECK(fieldsAre(t, "", ""));
+	CHECK(es_fieldGet(t, es_viewFromBuf(NULL, 0), 0, &offs, &flen) == 0);
+	CHECK(offs == 0 && flen == 0);
+	CHECK(es_fieldGet(t, es_viewFromBuf(NULL, 0), 1, &offs, &flen) == ENOENT);
+	CHECK(fieldsAre(merge, "", NULL));
+	CHECK(fieldsAre(merge, " \t ", NULL));
+	CHECK(es_fieldGet(merge, es_viewFromBuf((const unsigned char*) "  ", 2), 0,
+			  &offs, &flen) == ENOENT);
+
+	CHECK(fieldsAre(t, ",", "|"));
+	CHECK(fieldsAre(t, "a,,b,", "a||b|"));
+	CHECK(es_fieldGet(t, es_viewFromBuf((const unsigned char*) "a,,b,", 5), 3,
+			  &offs, &flen) == 0);
+	CHECK(offs == 5 && flen == 0);
+	CHECK(fieldsAre(merge, "\t one  two\t\tthree ", "one|two|three"));
+	CHECK(es_fieldGet(merge, es_viewFromBuf((const unsigned char*) " a  b", 5), 1,
+			  &offs, &flen) == 0);
+	CHECK(offs == 4 && flen == 1);
+
+	es_deleteTokenizer(t);
+	es_deleteTokenizer(merge);
+}
+
+static void
+checkQuotes(void)
+{
+	es_tokenizer_t *csv, *sd;
+	es_fielditer_t it;
+	es_size_t offs, flen;
+	const char *data = "a,\"b,c\",d";
+
+	csv = es_newTokenizer((const unsigned char*) ",", 1, ES_TOK_QUOTES);
+	sd = es_newTokenizer((const unsigned char*) " ", 1, ES_TOK_QUOTES_BSLASH);
+
+	CHECK(fieldsAre(csv, "a,\"b,c\",\"d\"\"e\",f", "a|b,c|d\"\"e|f"));
+	CHECK(fieldsAre(csv, "\"\",x", "|x"));
+	CHECK(fieldsAre(csv, "\"a\"junk,b", "a|b"));	/* junk after the quote */
+	CHECK(fieldsAre(csv, "\"a\"junk", "a"));
+	CHECK(fieldsAre(csv, "\"open,end", "open,end"));	/* unterminated */
+	CHECK(fieldsAre(csv, "\"x\"\"", "x\"\""));
+	CHECK(fieldsAre(csv, "a\"b\",c", "a\"b\"|c"));	/* quote inside a field */
+	CHECK(fieldsAre(sd, "\"a\\\"b c\" d", "a\\\"b c|d"));
+	CHECK(fieldsAre(sd, "\"trailing\\", "trailing\\"));
+	CHECK(fieldsAre(sd, "\"a\"\" b", "a|b"));	/* no doubling here */
+
+	es_fieldIterInit(&it, csv, es_viewFromBuf((const unsigned char*) data, strlen(data)));
+	CHECK(es_fieldNext(&it, &offs, &flen) && !es_fieldIsQuoted(&it));
+	CHECK(es_fieldNext(&it, &offs, &flen) && es_fieldIsQuoted(&it));
+	CHECK(offs == 3 && flen == 3);
+	CHECK(es_fieldNext(&it, &offs, &flen) && !es_fieldIsQuoted(&it));
+	CHECK(!es_fieldNext(&it, &offs, &flen));
+
+	/* es_fieldGet() honours the quotes */
+	CHECK(es_fieldGet(csv, es_viewFromBuf((const unsigned char*) data, strlen(data)), 2,
+			  &offs, &flen) == 0);
+	CHECK(offs == 8 && flen == 1);
+	CHECK(es_fieldGet(csv, es_viewFromBuf((const unsigned char*) data, strlen(data)), 3,
+			  &offs, &flen) == ENOENT);
+
+	es_deleteTokenizer(csv);
+	es_deleteTokenizer(sd);
+}
+
+int
+main(void)
+{
+	checkRandom(0);
+	checkRandom(1);
+	checkEdgeCases();
+	checkQuotes();
+	return CHECK_RESULT();
+}
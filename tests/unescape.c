@@ -0,0 +1,165 @@
+/**
+ * @file unescape.c
+ * Tests for unescaping.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+static int
+hexVal(unsigned char c)
+{
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/* straightforward reference, one byte at a time */
+static size_t
+refUnescape(const unsigned char *src, size_t len, unsigned char *dst)
+{
+	static const char from[] = "0abfnrt'\"?\\";
+	static const char to[] = "\0\a\b\f\n\r\t'\"?\\";
+	const char *p;
+	size_t i = 0, n = 0;
+
+	while(i < len) {
+		if(src[i] != '\\' || i + 1 == len) {
+			dst[n++] = src[i++];
+		} else if((p = memchr(from, src[i + 1], sizeof(from) - 1)) != NULL) {
+			dst[n++] = to[p - from];
+			i += 2;
+		} else if(src[i + 1] == 'x' && i + 3 < len
+			  && hexVal(src[i + 2]) >= 0 && hexVal(src[i + 3]) >= 0) {
+			dst[n++] = hexVal(src[i + 2]) * 16 + hexVal(src[i + 3]);
+			i += 4;
+		} else {
+			dst[n++] = src[i++]; /* undefined: kept as is */
+		}
+	}
+	return n;
+}
+
+static void
+checkCases(void)
+{
+	static const struct {
+		const char *in;
+		size_t lenIn;
+		const char *out;
+		size_t lenOut;
+	} cases[] = {
+		{ "", 0, "", 0 },
+		{ "plain text", 10, "plain text", 10 },
+		{ "a\\tb\\nc", 7, "a\tb\nc", 5 },
+		{ "\\\\", 2, "\\", 1 },
+		{ "\\0", 2, "\0", 1 },
+		{ "\\x41\\x7e", 8, "A~", 2 },
+		{ "\\xfF", 4, "\xff", 1 },
+		{ "end\\", 4, "end\\", 4 },		/* trailing backslash */
+		{ "end\\x", 5, "end\\x", 5 },		/* trailing "\x" */
+		{ "end\\x4", 6, "end\\x4", 6 },
+		{ "\\xg1", 4, "\\xg1", 4 },
+		{ "\\q\\'\\\"\\?", 8, "\\q'\"?", 5 },
+	};
+	es_str_t *s;
+	size_t i;
+
+	for(i = 0 ; i < sizeof(cases) / sizeof(cases[0]) ; ++i) {
+		s = es_newStrFromCStr(cases[i].in, cases[i].lenIn);
+		es_unescapeStr(s);
+		CHECK(es_strlen(s) == cases[i].lenOut
+		      && memcmp(es_getBufAddr(s), cases[i].out, cases[i].lenOut) == 0);
+		es_emptyStr(s);
+		CHECK(es_addUnescaped(&s, cases[i].in, cases[i].lenIn) == 0);
+		CHECK(es_strlen(s) == cases[i].lenOut
+		      && memcmp(es_getBufAddr(s), cases[i].out, cases[i].lenOut) == 0);
+		es_deleteStr(s);
+	}
+}
+
+/* random input with escapes at all positions of the runs between them,
+ * compared against the reference, in place and appended
+ */
+static void
+checkRandom(void)
+{
+	static const char alphabet[] = "ab\\\\\\nt0x4F'g";
+	unsigned char in[200], exp[200];
+	es_str_t *s;
+	unsigned seed = 1;
+	size_t len, lenExp, i;
+	int round, ok = 1;
+
+	for(round = 0 ; round < 20000 ; ++round) {
+		seed = seed * 1103515245 + 12345;
+		len = (seed >> 16) % sizeof(in);
+		for(i = 0 ; i < len ; ++i) {
+			seed = seed * 1103515245 + 12345;
+			in[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+		}
+		lenExp = refUnescape(in, len, exp);
+		s = es_newStrFromBuf((char*) in, len);
+		es_unescapeStr(s);
+		ok &= es_strlen(s) == lenExp && memcmp(es_getBufAddr(s), exp, lenExp) == 0;
+		es_deleteStr(s);
+
+		s = es_newStrFromCStr("pre", 3);
+		ok &= es_addUnescaped(&s, (char*) in, len) == 0;
+		ok &= es_strlen(s) == 3 + lenExp && memcmp(es_getBufAddr(s) + 3, exp, lenExp) == 0;
+		es_deleteStr(s);
+	}
+	CHECK(ok);
+}
+
+/* the COW variant leaves other owners alone */
+static void
+checkShared(void)
+{
+	es_str_t *s = es_newStrFromCStr("a\\tb", 4);
+	es_str_t *copy = es_strshare(s);
+
+	CHECK(es_unescapeStrCOW(&s) == 0);
+	CHECK_STR(s, "a\tb");
+	CHECK_STR(copy, "a\\tb");
+	es_deleteStr(copy);
+	CHECK(es_unescapeStrCOW(&s) == 0); /* not shared any more */
+	CHECK_STR(s, "a\tb");
+	es_deleteStr(s);
+}
+
+int
+main(void)
+{
+	checkCases();
+	checkRandom();
+	checkShared();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,135 @@
+/**
+ * @file view.c
+ * Tests for string views.
+ *//*
+ * libestr - some essentials for string handling (and a bit more)
+ * Copyright 2010 by Rainer Gerhards and Adiscon GmbH.
+ *
+ * This file is part of libestr.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * A copy of the LGPL v2.1 can be found in the file "COPYING" in this distribution.
+ */
+#include "config.h"
+#include <stdlib.h>
+
+#include "libestr.h"
+#include "check.h"
+
+static int
+sign(int i)
+{
+	return (i > 0) - (i < 0);
+}
+
+static void
+checkSubStr(void)
+{
+	es_str_t *s = es_newStrFromCStr("hello world", 11);
+	es_strview_t v;
+
+	v = es_viewFromStr(s);
+	CHECK(v.buf == es_getBufAddr(s) && v.len == 11);
+	v = es_viewFromSubStr(s, 6, 5);
+	CHECK(v.buf == es_getBufAddr(s) + 6 && v.len == 5); /* no copy */
+	CHECK(es_viewconstcmp(v, "world") == 0);
+	v = es_viewFromSubStr(s, 6, 100); /* clamped to the string end */
+	CHECK(v.len == 5);
+	v = es_viewFromSubStr(s, 11, 3);
+	CHECK(v.len == 0);
+	v = es_viewFromSubStr(s, 12, 3); /* start beyond the end: empty */
+	CHECK(v.len == 0);
+	v = es_viewFromBuf(NULL, 0);
+	CHECK(es_viewconstcmp(v, "") == 0);
+	es_deleteStr(s);
+}
+
+/* Operations must stay inside the view. The bytes right behind a view
+ * make a difference if they are read.
+ */
+static void
+checkBounds(void)
+{
+	es_str_t *s = es_newStrFromCStr("12345 abcABC\0x", 14);
+	es_strview_t num = es_viewFromSubStr(s, 0, 3);
+	es_strview_t abc = es_viewFromSubStr(s, 6, 3);
+	es_strview_t all = es_viewFromStr(s);
+	es_str_t *copy;
+	char *cstr;
+	int bSuccess;
+
+	CHECK(es_view2num(num, &bSuccess) == 123 && bSuccess);
+	CHECK(es_view2unum(num, &bSuccess) == 123 && bSuccess);
+	CHECK(es_view2double(num, &bSuccess) == 123.0 && bSuccess);
+	CHECK(es_viewconstcmp(abc, "abc") == 0);
+	CHECK(es_viewconstcmp(abc, "abcA") < 0);
+	CHECK(es_viewcasebufcmp(abc, (const unsigned char*) "ABC", 3) == 0);
+	CHECK(es_viewContains(abc, es_viewFromBuf((const unsigned char*) "cA", 2)) == -1);
+	CHECK(es_viewContains(all, es_viewFromBuf((const unsigned char*) "cA", 2)) == 8);
+	CHECK(es_viewCaseContains(abc, es_viewFromBuf((const unsigned char*) "BC", 2)) == 1);
+	CHECK(es_viewCaseContains(num, es_viewFromBuf((const unsigned char*) "45", 2)) == -1);
+
+	cstr = es_view2cstr(abc, NULL);
+	CHECK(cstr != NULL && strcmp(cstr, "abc") == 0);
+	free(cstr);
+	cstr = es_view2cstr(es_viewFromSubStr(s, 9, 5), "#NUL#");
+	CHECK(cstr != NULL && strcmp(cstr, "ABC#NUL#x") == 0);
+	free(cstr);
+
+	/* a copy outlives the viewed string */
+	copy = es_newStrFromView(abc);
+	es_deleteStr(s);
+	CHECK_STR(copy, "abc");
+	es_deleteStr(copy);
+}
+
+/* comparisons of views agree with those of equivalent strings */
+static void
+checkCompare(void)
+{
+	static const char *words[] = { "", "a", "A", "ab", "aB", "abc", "b", "\xff", "a\0" };
+	es_str_t *s1, *s2;
+	es_strview_t v1, v2;
+	size_t i, j;
+	int ok = 1;
+
+	for(i = 0 ; i < sizeof(words) / sizeof(words[0]) ; ++i) {
+		for(j = 0 ; j < sizeof(words) / sizeof(words[0]) ; ++j) {
+			s1 = es_newStrFromCStr(words[i], strlen(words[i]) + (i == 8));
+			s2 = es_newStrFromCStr(words[j], strlen(words[j]) + (j == 8));
+			v1 = es_viewFromStr(s1);
+			v2 = es_viewFromStr(s2);
+			ok &= sign(es_viewcmp(v1, v2)) == sign(es_strcmp(s1, s2));
+			ok &= sign(es_viewcasecmp(v1, v2)) == sign(es_strcasecmp(s1, s2));
+			ok &= es_viewequal(v1, v2) == es_strequal(s1, s2);
+			ok &= es_viewequal(v1, v2) == (i == j);
+			ok &= es_viewContains(v1, v2) == es_strContains(s1, s2);
+			ok &= es_viewCaseContains(v1, v2) == es_strCaseContains(s1, s2);
+			es_deleteStr(s1);
+			es_deleteStr(s2);
+		}
+	}
+	CHECK(ok);
+}
+
+int
+main(void)
+{
+	checkSubStr();
+	checkBounds();
+	checkCompare();
+	return CHECK_RESULT();
+}